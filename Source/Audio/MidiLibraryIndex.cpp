@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+
+    MidiLibraryIndex.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "MidiLibraryIndex.h"
+#include <set>
+
+#if JUCE_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static constexpr int filesPerParseJob = 64;
+static constexpr int pollIntervalMs = 3000;
+
+//==============================================================================
+MidiLibraryIndex::MidiLibraryIndex()
+    : Thread("MIDI Library Index"),
+      parsePool(jmax(1, SystemStats::getNumCpus() - 1)) {}
+
+MidiLibraryIndex::~MidiLibraryIndex() { close(); }
+
+//==============================================================================
+Array<File> MidiLibraryIndex::openFolder(const File &newFolder) {
+  close();
+
+  folder = newFolder;
+  loadIndex();
+
+  Array<File> files;
+  {
+    const ScopedLock sl(lock);
+    for (auto &[name, info] : entries)
+      if (isListed(info))
+        files.add(folder.getChildFile(name));
+  }
+  files.sort();
+
+  startThread(Thread::Priority::low);
+  return files;
+}
+
+void MidiLibraryIndex::close() {
+  stopThread(4000);
+  cancelPendingUpdate();
+
+  if (indexDirty)
+    saveIndex();
+
+  const ScopedLock sl(lock);
+  entries.clear();
+  pendingAdded.clear();
+  pendingRemoved.clear();
+  folder = File();
+}
+
+bool MidiLibraryIndex::getFileInfo(const File &file, FileInfo &info) const {
+  if (file.getParentDirectory() != folder)
+    return false;
+
+  const ScopedLock sl(lock);
+  auto it = entries.find(file.getFileName());
+  if (it == entries.end())
+    return false;
+
+  info = it->second;
+  return true;
+}
+
+//==============================================================================
+bool MidiLibraryIndex::isListed(const FileInfo &info) const {
+  return info.lengthBeats <= 0.0 || info.lengthBeats >= minimumLengthBeats;
+}
+
+bool MidiLibraryIndex::isMidiFile(const File &file) {
+  return file.hasFileExtension("mid;midi");
+}
+
+bool MidiLibraryIndex::analyseFile(const File &file, FileInfo &info) {
+  FileInputStream stream(file);
+  if (!stream.openedOk())
+    return false;
+
+  MidiFile midiFile;
+  if (!midiFile.readFrom(stream))
+    return false;
+
+  info = {};
+  info.modificationTime = file.getLastModificationTime().toMilliseconds();
+  info.fileSize = file.getSize();
+
+  // Standard MIDI file time format: positive = ticks per quarter note
+  double ticksPerQuarterNote = 960.0;
+  if (midiFile.getTimeFormat() > 0)
+    ticksPerQuarterNote = midiFile.getTimeFormat();
+
+  double lastTick = 0.0;
+  double firstTempoTick = std::numeric_limits<double>::max();
+
+  for (int track = 0; track < midiFile.getNumTracks(); ++track) {
+    auto *trackSeq = midiFile.getTrack(track);
+    for (int i = 0; i < trackSeq->getNumEvents(); ++i) {
+      auto &msg = trackSeq->getEventPointer(i)->message;
+      lastTick = jmax(lastTick, msg.getTimeStamp());
+
+      if (msg.isNoteOn()) {
+        const int note = msg.getNoteNumber();
+        info.lowestNote =
+            info.lowestNote < 0 ? note : jmin(info.lowestNote, note);
+        info.highestNote = jmax(info.highestNote, note);
+        info.channelMask |= static_cast<uint16>(1 << (msg.getChannel() - 1));
+      } else if (msg.isTempoMetaEvent() &&
+                 msg.getTimeStamp() < firstTempoTick) {
+        firstTempoTick = msg.getTimeStamp();
+        info.tempoBpm = 60.0 / msg.getTempoSecondsPerQuarterNote();
+      }
+    }
+  }
+
+  info.lengthBeats = lastTick / ticksPerQuarterNote;
+  return true;
+}
+
+//==============================================================================
+void MidiLibraryIndex::run() {
+  scanFolder();
+
+  if (!threadShouldExit())
+    watchFolder();
+}
+
+void MidiLibraryIndex::handleAsyncUpdate() {
+  Array<File> added, removed;
+  {
+    const ScopedLock sl(lock);
+    added.swapWith(pendingAdded);
+    removed.swapWith(pendingRemoved);
+  }
+
+  if (added.isEmpty() && removed.isEmpty())
+    return;
+
+  added.sort();
+  removed.sort();
+  DBG("MIDI library: " + String(added.size()) + " added, " +
+      String(removed.size()) + " removed");
+
+  if (onFilesChanged)
+    onFilesChanged(added, removed);
+}
+
+//==============================================================================
+void MidiLibraryIndex::scanFolder() {
+  struct Candidate {
+    String name;
+    FileInfo info;
+    bool parsed = false;
+  };
+
+  struct Listed {
+    String name;
+    int64 modificationTime;
+    int64 fileSize;
+  };
+
+  // Only a stat per file here; files whose size and date match the index
+  // are not opened again
+  std::vector<Listed> listing;
+  for (const auto &entry : RangedDirectoryIterator(
+           folder, false, "*.mid;*.midi", File::findFiles)) {
+    if (threadShouldExit())
+      return;
+    listing.push_back({entry.getFile().getFileName(),
+                       entry.getModificationTime().toMilliseconds(),
+                       entry.getFileSize()});
+  }
+
+  // Shared with the parse jobs, which may outlive this call if it returns
+  // early while the pool is still draining
+  auto toParse = std::make_shared<std::vector<Candidate>>();
+  std::set<String> present;
+  {
+    const ScopedLock sl(lock);
+    for (auto &listed : listing) {
+      present.insert(listed.name);
+
+      auto it = entries.find(listed.name);
+      if (it == entries.end() ||
+          it->second.modificationTime != listed.modificationTime ||
+          it->second.fileSize != listed.fileSize)
+        toParse->push_back({listed.name, {}, false});
+    }
+  }
+
+  if (threadShouldExit())
+    return;
+
+  // Pre-parse new and changed files in parallel
+  for (size_t first = 0; first < toParse->size(); first += filesPerParseJob) {
+    parsePool.addJob([toParse, first, dir = folder] {
+      auto &candidates = *toParse;
+      const size_t last = jmin(candidates.size(), first + filesPerParseJob);
+      for (size_t i = first; i < last; ++i)
+        candidates[i].parsed = analyseFile(
+            dir.getChildFile(candidates[i].name), candidates[i].info);
+    });
+  }
+
+  while (parsePool.getNumJobs() > 0) {
+    if (threadShouldExit()) {
+      parsePool.removeAllJobs(true, 5000);
+      return;
+    }
+    wait(5);
+  }
+
+  const ScopedLock sl(lock);
+
+  int numTooShort = 0;
+  for (auto &candidate : *toParse) {
+    if (!candidate.parsed)
+      continue; // Unreadable files stay out of the library
+
+    // Short files are remembered so they are not parsed again, but only
+    // files long enough are reported
+    auto it = entries.find(candidate.name);
+    const bool wasListed = it != entries.end() && isListed(it->second);
+    const bool listed = isListed(candidate.info);
+    if (listed && !wasListed)
+      pendingAdded.add(folder.getChildFile(candidate.name));
+    else if (wasListed && !listed)
+      pendingRemoved.add(folder.getChildFile(candidate.name));
+    numTooShort += listed ? 0 : 1;
+    entries[candidate.name] = candidate.info;
+  }
+
+  if (numTooShort > 0)
+    DBG("MIDI library: skipped " + String(numTooShort) +
+        " file(s) shorter than " + String(minimumLengthBeats) + " beats");
+
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (present.count(it->first) == 0) {
+      if (isListed(it->second))
+        pendingRemoved.add(folder.getChildFile(it->first));
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (!toParse->empty() || !pendingRemoved.isEmpty()) {
+    indexDirty = true;
+    triggerAsyncUpdate();
+  }
+}
+
+void MidiLibraryIndex::refreshFiles(const StringArray &fileNames) {
+  bool changed = false;
+
+  for (auto &name : fileNames) {
+    auto file = folder.getChildFile(name);
+    if (!isMidiFile(file))
+      continue;
+
+    FileInfo info;
+    const bool parsed = file.existsAsFile() && analyseFile(file, info);
+
+    const ScopedLock sl(lock);
+    auto it = entries.find(name);
+    const bool known = it != entries.end();
+    const bool wasListed = known && isListed(it->second);
+
+    if (parsed) {
+      if (isListed(info) && !wasListed)
+        pendingAdded.add(file);
+      else if (wasListed && !isListed(info))
+        pendingRemoved.add(file);
+      entries[name] = info;
+      changed = true;
+    } else if (known) {
+      if (wasListed)
+        pendingRemoved.add(file);
+      entries.erase(it);
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    const ScopedLock sl(lock);
+    indexDirty = true;
+    triggerAsyncUpdate();
+  }
+}
+
+void MidiLibraryIndex::watchFolder() {
+#if JUCE_LINUX
+  const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd >= 0) {
+    // Completed writes and moves only: IN_CREATE would hand us files that
+    // are still being copied
+    const int wd = inotify_add_watch(
+        fd, folder.getFullPathName().toRawUTF8(),
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM |
+            IN_DELETE_SELF | IN_MOVE_SELF);
+
+    if (wd >= 0) {
+      alignas(inotify_event) char buffer[16384];
+      bool folderGone = false;
+
+      while (!threadShouldExit() && !folderGone) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 250) <= 0)
+          continue;
+
+        StringArray changedNames;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+          for (char *ptr = buffer; ptr < buffer + length;) {
+            auto *event = reinterpret_cast<const inotify_event *>(ptr);
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+              folderGone = true;
+            else if (event->len > 0)
+              changedNames.addIfNotAlreadyThere(
+                  String::fromUTF8(event->name));
+            ptr += sizeof(inotify_event) + event->len;
+          }
+        }
+
+        refreshFiles(changedNames);
+        if (indexDirty)
+          saveIndex();
+      }
+
+      inotify_rm_watch(fd, wd);
+
+      // A vanished folder shows up as every file being removed
+      if (folderGone)
+        scanFolder();
+    }
+
+    ::close(fd);
+
+    if (wd >= 0)
+      return;
+  }
+#endif
+
+  // No change notifications: poll the folder, which only costs a stat per
+  // file while nothing changes
+  while (!threadShouldExit()) {
+    wait(pollIntervalMs);
+    if (threadShouldExit())
+      break;
+
+    scanFolder();
+    if (indexDirty)
+      saveIndex();
+  }
+}
+
+//==============================================================================
+File MidiLibraryIndex::getIndexFile() const {
+  auto indexDir = ayra::app_properties->getUserSettings()
+                      ->getFile()
+                      .getSiblingFile("MidiIndex");
+  return indexDir.getChildFile(
+      String::toHexString(folder.getFullPathName().hashCode64()) + ".xml");
+}
+
+void MidiLibraryIndex::loadIndex() {
+  auto xml = parseXML(getIndexFile());
+  if (xml == nullptr ||
+      xml->getStringAttribute("folder") != folder.getFullPathName())
+    return;
+
+  const ScopedLock sl(lock);
+  for (auto *fileXml : xml->getChildWithTagNameIterator("File")) {
+    FileInfo info;
+    info.modificationTime =
+        fileXml->getStringAttribute("modified").getLargeIntValue();
+    info.fileSize = fileXml->getStringAttribute("size").getLargeIntValue();
+    info.lengthBeats = fileXml->getDoubleAttribute("beats");
+    info.lowestNote = fileXml->getIntAttribute("lowNote", -1);
+    info.highestNote = fileXml->getIntAttribute("highNote", -1);
+    info.channelMask =
+        static_cast<uint16>(fileXml->getIntAttribute("channels"));
+    info.tempoBpm = fileXml->getDoubleAttribute("bpm");
+    entries[fileXml->getStringAttribute("name")] = info;
+  }
+}
+
+void MidiLibraryIndex::saveIndex() {
+  XmlElement xml("MidiIndex");
+
+  {
+    const ScopedLock sl(lock);
+    if (folder == File())
+      return;
+
+    xml.setAttribute("folder", folder.getFullPathName());
+    for (auto &[name, info] : entries) {
+      auto *fileXml = xml.createNewChildElement("File");
+      fileXml->setAttribute("name", name);
+      fileXml->setAttribute("modified", String(info.modificationTime));
+      fileXml->setAttribute("size", String(info.fileSize));
+      fileXml->setAttribute("beats", info.lengthBeats);
+      fileXml->setAttribute("lowNote", info.lowestNote);
+      fileXml->setAttribute("highNote", info.highestNote);
+      fileXml->setAttribute("channels", static_cast<int>(info.channelMask));
+      fileXml->setAttribute("bpm", info.tempoBpm);
+    }
+    indexDirty = false;
+  }
+
+  auto indexFile = getIndexFile();
+  indexFile.getParentDirectory().createDirectory();
+  if (!xml.writeTo(indexFile))
+    DBG("Failed to save MIDI index: " + indexFile.getFullPathName());
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    MidiLibraryIndex.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Background index of a MIDI folder. Files are enumerated and pre-parsed
+    (length, note range, channels, tempo) on worker threads and the result
+    is persisted, so reopening a large library starts from the cached list.
+    The folder is then watched (inotify on Linux, polling elsewhere) and
+    changes are reported incrementally on the message thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class MidiLibraryIndex : private Thread, private AsyncUpdater {
+public:
+  //==============================================================================
+  struct FileInfo {
+    int64 modificationTime = 0;
+    int64 fileSize = 0;
+
+    double lengthBeats = 0.0;
+    int lowestNote = -1; // -1 if the file has no notes
+    int highestNote = -1;
+    uint16 channelMask = 0; // Bit n set = MIDI channel n + 1 used
+    double tempoBpm = 0.0;  // First tempo event, 0 if none
+  };
+
+  //==============================================================================
+  MidiLibraryIndex();
+  ~MidiLibraryIndex() override;
+
+  //==============================================================================
+  // Start indexing and watching a folder. Returns the files known from the
+  // persisted index right away (sorted); changes found by the background
+  // scan arrive through onFilesChanged.
+  Array<File> openFolder(const File &folder);
+  void close();
+
+  // Files shorter than this are indexed but left out of the library (files
+  // without any events are kept). Set before openFolder().
+  void setMinimumLength(double beats) { minimumLengthBeats = beats; }
+
+  bool getFileInfo(const File &file, FileInfo &info) const;
+
+  // Called on the message thread
+  std::function<void(const Array<File> &added, const Array<File> &removed)>
+      onFilesChanged;
+
+  //==============================================================================
+  static bool isMidiFile(const File &file);
+  static bool analyseFile(const File &file, FileInfo &info);
+
+private:
+  //==============================================================================
+  File folder;
+
+  mutable CriticalSection lock;
+  std::map<String, FileInfo> entries; // Keyed by file name
+
+  Array<File> pendingAdded, pendingRemoved;
+  bool indexDirty = false;
+  double minimumLengthBeats = 0.0;
+
+  ThreadPool parsePool;
+
+  //==============================================================================
+  void run() override;
+  void handleAsyncUpdate() override;
+
+  bool isListed(const FileInfo &info) const;
+
+  void scanFolder();
+  void refreshFiles(const StringArray &fileNames);
+  void watchFolder();
+
+  File getIndexFile() const;
+  void loadIndex();
+  void saveIndex();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiLibraryIndex)
+};
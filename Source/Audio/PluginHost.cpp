@@ -11,6 +11,183 @@
 */
 
 #include "PluginHost.h"
+#include "../TraceRecorder.h"
+
+//==============================================================================
+// Plays one rendered clip, either from a memory-mapped WAV or from a buffer
+// kept in memory. Files are paged in before they are handed to the audio
+// thread, so processBlock only copies (and resamples when the device rate
+// differs from the render rate).
+class ClipPlayerProcessor : public AudioProcessor {
+public:
+  ClipPlayerProcessor()
+      : AudioProcessor(BusesProperties().withOutput(
+            "Output", AudioChannelSet::stereo(), true)) {}
+
+  void prepareToPlay(double sampleRate, int samplesPerBlock) override {
+    const ScopedLock sl(clipLock);
+    hostSampleRate = sampleRate;
+    maxBlockSize = jmax(1, samplesPerBlock);
+    prepareClip();
+  }
+
+  void releaseResources() override {}
+
+  void processBlock(AudioBuffer<float> &buffer, MidiBuffer &) override {
+    buffer.clear();
+
+    // Never wait on the message thread while it swaps clips
+    const ScopedTryLock sl(clipLock);
+    if (!sl.isLocked() || clipLength == 0 || !playing.load())
+      return;
+
+    for (int start = 0; start < buffer.getNumSamples();
+         start += maxBlockSize) {
+      const int numSamples = jmin(maxBlockSize, buffer.getNumSamples() - start);
+
+      if (speedRatio == 1.0) {
+        readSource(buffer, start, numSamples);
+        position += numSamples;
+      } else {
+        readSource(sourceBuffer, 0, sourceBuffer.getNumSamples());
+
+        int consumed = 0;
+        for (int ch = 0; ch < jmin(2, buffer.getNumChannels()); ++ch)
+          consumed = interpolators[ch].process(
+              speedRatio, sourceBuffer.getReadPointer(ch),
+              buffer.getWritePointer(ch, start), numSamples);
+        position += consumed;
+      }
+
+      if (position >= clipLength) {
+        playing.store(false);
+        break;
+      }
+    }
+
+    buffer.applyGain(gain);
+  }
+
+  void processBlock(AudioBuffer<double> &buffer, MidiBuffer &) override {
+    buffer.clear();
+  }
+
+  AudioProcessorEditor *createEditor() override { return nullptr; }
+  bool hasEditor() const override { return false; }
+  const String getName() const override { return "Clip Player"; }
+  bool acceptsMidi() const override { return false; }
+  bool producesMidi() const override { return false; }
+  double getTailLengthSeconds() const override { return 0.0; }
+  int getNumPrograms() override { return 1; }
+  int getCurrentProgram() override { return 0; }
+  void setCurrentProgram(int) override {}
+  const String getProgramName(int) override { return "Default"; }
+  void changeProgramName(int, const String &) override {}
+  void getStateInformation(MemoryBlock &) override {}
+  void setStateInformation(const void *, int) override {}
+
+  //==============================================================================
+  // Message thread
+  bool play(const File &file) {
+    WavAudioFormat wavFormat;
+    std::unique_ptr<MemoryMappedAudioFormatReader> newReader(
+        wavFormat.createMemoryMappedReader(file));
+    if (newReader == nullptr || !newReader->mapEntireFile())
+      return false;
+
+    // Touch every page now rather than faulting them in on the audio thread
+    const auto bytesPerFrame =
+        static_cast<int>(newReader->numChannels * newReader->bitsPerSample / 8);
+    const int framesPerPage = jmax(1, 4096 / jmax(1, bytesPerFrame));
+    for (int64 frame = 0; frame < newReader->lengthInSamples;
+         frame += framesPerPage)
+      newReader->touchSample(frame);
+
+    std::shared_ptr<const AudioBuffer<float>> noBuffer;
+    swapClip(newReader, noBuffer, newReader->sampleRate, 1.0f);
+    return true;
+  }
+
+  void play(std::shared_ptr<const AudioBuffer<float>> audio, double sampleRate,
+            float newGain) {
+    std::unique_ptr<MemoryMappedAudioFormatReader> noReader;
+    swapClip(noReader, audio, sampleRate, newGain);
+  }
+
+  void stop() { playing.store(false); }
+  bool isPlaying() const { return playing.load(); }
+
+private:
+  // The previous clip comes back through the arguments and is released by
+  // the caller, outside the lock
+  void swapClip(std::unique_ptr<MemoryMappedAudioFormatReader> &newReader,
+                std::shared_ptr<const AudioBuffer<float>> &newBuffer,
+                double sampleRate, float newGain) {
+    const ScopedLock sl(clipLock);
+    std::swap(reader, newReader);
+    std::swap(clipBuffer, newBuffer);
+    clipSampleRate = sampleRate;
+    clipLength = reader != nullptr      ? reader->lengthInSamples
+                 : clipBuffer != nullptr ? clipBuffer->getNumSamples()
+                                         : 0;
+    gain = newGain;
+    position = 0;
+    prepareClip();
+    playing.store(clipLength > 0);
+  }
+
+  // Called with clipLock held
+  void prepareClip() {
+    if (clipLength == 0 || hostSampleRate <= 0.0)
+      return;
+
+    speedRatio = clipSampleRate / hostSampleRate;
+    for (auto &interpolator : interpolators)
+      interpolator.reset();
+
+    if (speedRatio != 1.0)
+      sourceBuffer.setSize(
+          2, static_cast<int>(std::ceil(maxBlockSize * speedRatio)) + 8,
+          false, false, true);
+  }
+
+  // Copy source samples from the current position; past the end is silence
+  void readSource(AudioBuffer<float> &dest, int destStart, int numSamples) {
+    if (reader != nullptr) {
+      reader->read(&dest, destStart, numSamples, position, true, true);
+      return;
+    }
+
+    const int available = static_cast<int>(
+        jlimit<int64>(0, numSamples, clipLength - position));
+    const int sourceChannels = clipBuffer->getNumChannels();
+
+    for (int ch = 0; ch < jmin(2, dest.getNumChannels()); ++ch) {
+      if (available > 0)
+        dest.copyFrom(ch, destStart, *clipBuffer,
+                      jmin(ch, sourceChannels - 1),
+                      static_cast<int>(position), available);
+      if (available < numSamples)
+        dest.clear(ch, destStart + available, numSamples - available);
+    }
+  }
+
+  CriticalSection clipLock;
+  std::unique_ptr<MemoryMappedAudioFormatReader> reader;
+  std::shared_ptr<const AudioBuffer<float>> clipBuffer;
+  double clipSampleRate = 44100.0;
+  int64 clipLength = 0;
+  float gain = 1.0f;
+
+  std::atomic<bool> playing{false};
+  int64 position = 0; // In source samples
+
+  double hostSampleRate = 44100.0;
+  int maxBlockSize = 512;
+  double speedRatio = 1.0;
+  LagrangeInterpolator interpolators[2];
+  AudioBuffer<float> sourceBuffer;
+};
 
 //==============================================================================
 PluginHost::PluginHost(AudioDeviceManager &dm, ayra::PluginsManager &pm)
@@ -33,6 +210,16 @@ PluginHost::PluginHost(AudioDeviceManager &dm, ayra::PluginsManager &pm)
           AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode);
   audioOutputNode = graph->addNode(std::move(audioOutputProcessor));
 
+  // Rendered clip player, always connected straight to the output
+  auto clipPlayerProcessor = std::make_unique<ClipPlayerProcessor>();
+  clipPlayer = clipPlayerProcessor.get();
+  clipPlayerNode = graph->addNode(std::move(clipPlayerProcessor));
+  graph->addConnection(
+      {{clipPlayerNode->nodeID, 0}, {audioOutputNode->nodeID, 0}});
+  graph->addConnection(
+      {{clipPlayerNode->nodeID, 1}, {audioOutputNode->nodeID, 1}});
+  graph->rebuild();
+
   // Register as MIDI input callback
   auto midiInputs = MidiInput::getAvailableDevices();
   for (auto &input : midiInputs) {
@@ -56,8 +243,35 @@ PluginHost::~PluginHost() {
 void PluginHost::setActivePlugin(AudioPluginInstance *plugin) {
   const ScopedLock sl(midiLock);
 
-  // Rebuild graph topology
-  rebuildGraph(std::move(plugin));
+  // Rebuild graph topology: the plugin becomes the only layer
+  while (!layers.isEmpty())
+    removeLayerNodes(layers.size() - 1);
+
+  if (plugin != nullptr)
+    addLayerNodes(plugin, 1.0f);
+
+  updateGraph();
+}
+
+void PluginHost::addLayer(AudioPluginInstance *plugin, float gain) {
+  const ScopedLock sl(midiLock);
+
+  if (plugin == nullptr || findLayer(plugin) >= 0)
+    return;
+
+  addLayerNodes(plugin, gain);
+  updateGraph();
+}
+
+void PluginHost::removeLayer(AudioPluginInstance *plugin) {
+  const ScopedLock sl(midiLock);
+
+  const int index = findLayer(plugin);
+  if (index < 0)
+    return;
+
+  removeLayerNodes(index);
+  updateGraph();
 }
 
 // Proxy Processor to wrap external plugins in the graph without taking
@@ -116,178 +330,206 @@ private:
   AudioPluginInstance *targetProcessor = nullptr;
 };
 
-void PluginHost::rebuildGraph(AudioPluginInstance *plugin) {
-  // Remove old plugin and gain nodes if they exist
-  if (activePluginNode != nullptr) {
-    graph->removeNode(activePluginNode.get());
-    activePluginNode = nullptr;
-  }
-  if (activePluginGainNode != nullptr) {
-    graph->removeNode(activePluginGainNode.get());
-    activePluginGainNode = nullptr;
+void PluginHost::addLayerNodes(AudioPluginInstance *plugin, float gain) {
+  auto *layer = layers.add(new Layer());
+  layer->plugin = plugin;
+  layer->gain = gain;
+
+  // prepare plugin
+  plugin->enableAllBuses();
+  plugin->setPlayHead(this);
+
+  // Add plugin node VIA PROXY
+  auto proxy = std::make_unique<ProxyProcessor>(plugin);
+  layer->pluginNode = graph->addNode(std::move(proxy));
+
+  // Add layer gain node (applies combined layer gain * masterGain and meters
+  // the layer)
+  auto gainProc = std::make_unique<GainProcessor>();
+  gainProc->setGain(gain * currentMasterGain);
+  gainProc->getMeterSource().resize(
+      2, jmax(8, static_cast<int>(currentSampleRate * 0.05 /
+                                  jmax(1, currentBlockSize))));
+  layer->gainNode = graph->addNode(std::move(gainProc));
+
+  // Connect: Midi Input -> Plugin (Proxy). Every layer gets the same MIDI;
+  // the graph processes the layers in parallel.
+  graph->addConnection(
+      {{midiInputNode->nodeID, ayra::AudioProcessorGraph::midiChannel},
+       {layer->pluginNode->nodeID, ayra::AudioProcessorGraph::midiChannel}});
+
+  // Connect: Plugin (Proxy) -> Layer Gain -> Audio Output
+  for (int ch = 0; ch < 2; ++ch) {
+    graph->addConnection(
+        {{layer->pluginNode->nodeID, ch}, {layer->gainNode->nodeID, ch}});
+    graph->addConnection(
+        {{layer->gainNode->nodeID, ch}, {audioOutputNode->nodeID, ch}});
   }
+}
 
-  if (plugin != nullptr) {
-    // prepare plugin
-    plugin->enableAllBuses();
-    plugin->setPlayHead(this);
+void PluginHost::removeLayerNodes(int index) {
+  auto *layer = layers[index];
+  graph->removeNode(layer->pluginNode.get());
+  graph->removeNode(layer->gainNode.get());
+  layers.remove(index);
+}
 
-    // Add plugin node VIA PROXY
-    auto proxy = std::make_unique<ProxyProcessor>(plugin);
-    activePluginNode = graph->addNode(std::move(proxy));
+void PluginHost::updateGraph() {
+  // Rebuild the graph's internal processing order after topology changes.
+  // Also needed when the last layer was removed: the clip player remains.
+  graph->rebuild();
 
-    // Add plugin gain node (applies combined rowGain * masterGain)
-    auto gainProc = std::make_unique<GainProcessor>();
-    gainProc->setGain(currentRowGain * currentMasterGain);
-    activePluginGainNode = graph->addNode(std::move(gainProc));
+  // Re-prepare the graph with current sample rate and block size
+  if (currentSampleRate > 0 && currentBlockSize > 0) {
+    graph->prepareToPlay(currentSampleRate, currentBlockSize);
+  }
+}
 
-    // Connect: Midi Input -> Plugin (Proxy)
-    graph->addConnection(
-        {{midiInputNode->nodeID, ayra::AudioProcessorGraph::midiChannel},
-         {activePluginNode->nodeID, ayra::AudioProcessorGraph::midiChannel}});
+int PluginHost::findLayer(AudioPluginInstance *plugin) const {
+  for (int i = 0; i < layers.size(); ++i)
+    if (layers[i]->plugin == plugin)
+      return i;
+  return -1;
+}
 
-    // Connect: Plugin (Proxy) -> Plugin Gain
-    graph->addConnection(
-        {{activePluginNode->nodeID, 0}, {activePluginGainNode->nodeID, 0}});
-    graph->addConnection(
-        {{activePluginNode->nodeID, 1}, {activePluginGainNode->nodeID, 1}});
+GainProcessor *PluginHost::getLayerGainProcessor(int index) const {
+  if (auto *layer = layers[index])
+    return dynamic_cast<GainProcessor *>(layer->gainNode->getProcessor());
+  return nullptr;
+}
 
-    // Connect: Plugin Gain -> Audio Output (direct connection, no master gain
-    // node)
-    graph->addConnection(
-        {{activePluginGainNode->nodeID, 0}, {audioOutputNode->nodeID, 0}});
-    graph->addConnection(
-        {{activePluginGainNode->nodeID, 1}, {audioOutputNode->nodeID, 1}});
+AudioPluginInstance *PluginHost::getActivePlugin() const {
+  return layers.isEmpty() ? nullptr : layers.getFirst()->plugin;
+}
 
-    // Rebuild the graph's internal processing order after topology changes
-    graph->rebuild();
+Array<AudioPluginInstance *> PluginHost::getActivePlugins() const {
+  Array<AudioPluginInstance *> plugins;
+  for (auto *layer : layers)
+    plugins.add(layer->plugin);
+  return plugins;
+}
 
-    // Re-prepare the graph with current sample rate and block size
-    if (currentSampleRate > 0 && currentBlockSize > 0) {
-      graph->prepareToPlay(currentSampleRate, currentBlockSize);
-    }
-  }
+bool PluginHost::hasLayer(AudioPluginInstance *plugin) const {
+  return plugin != nullptr && findLayer(plugin) >= 0;
 }
 
-AudioPluginInstance *PluginHost::getActivePlugin() const {
-  if (activePluginNode) {
-    if (auto *proxy =
-            dynamic_cast<ProxyProcessor *>(activePluginNode->getProcessor())) {
-      return proxy->getTarget();
-    }
-  }
+foleys::LevelMeterSource *
+PluginHost::getLayerMeterSource(AudioPluginInstance *plugin) {
+  if (auto *gainProc = getLayerGainProcessor(findLayer(plugin)))
+    return &gainProc->getMeterSource();
   return nullptr;
 }
 
+double PluginHost::getCpuLoad() const { return deviceManager.getCpuUsage(); }
+
 void PluginHost::setAcceptingMidiInput(bool accept) {
   acceptMidiInput = accept;
 }
 
 //==============================================================================
 void PluginHost::playMidiSequence(const MidiMessageSequence &seq, double bpm) {
+  clipPlayer->stop();
+
   const ScopedLock sl(midiLock);
 
   playbackSequence = seq;
-  currentBpm = bpm;
+  playbackSource = &playbackSequence;
+  setBpm(bpm);
   currentPpqPosition = 0.0;
-  currentSampleCount = 0;
   nextEventIndex = 0;
   playing = true;
 
-  // For AtTrigger mode: reset trigger position when starting playback
-  if (playheadMode == PlayheadMode::AtTrigger) {
-    triggerPpqPosition = 0.0;
-    triggerActive = true;
+  // For AtTrigger mode: restart the transport from 0 with the playback
+  if (playheadMode.load() == PlayheadMode::AtTrigger) {
+    transport.locate(0.0);
+    transport.play();
   }
 }
 
 void PluginHost::stopPlayback() {
+  clipPlayer->stop();
+
   const ScopedLock sl(midiLock);
 
   playing = false;
-  triggerActive = false;
+  if (playheadMode.load() == PlayheadMode::AtTrigger) {
+    transport.stop();
+    transport.locate(0.0);
+  }
 
-  // Send all notes off
-  if (activePluginNode != nullptr) {
-    MidiBuffer allNotesOff;
-    for (int ch = 1; ch <= 16; ++ch) {
-      allNotesOff.addEvent(MidiMessage::allNotesOff(ch), 0);
-    }
+  // Send all notes off to every layer
+  MidiBuffer allNotesOff;
+  for (int ch = 1; ch <= 16; ++ch) {
+    allNotesOff.addEvent(MidiMessage::allNotesOff(ch), 0);
+  }
 
-    if (auto *proc = activePluginNode->getProcessor()) {
+  for (auto *layer : layers) {
+    if (auto *proc = layer->pluginNode->getProcessor()) {
       AudioBuffer<float> dummyBuffer(2, currentBlockSize);
       dummyBuffer.clear();
-      proc->processBlock(dummyBuffer, allNotesOff);
+      MidiBuffer midi(allNotesOff);
+      proc->processBlock(dummyBuffer, midi);
     }
   }
 }
 
-void PluginHost::setBpm(double newBpm) { currentBpm = newBpm; }
-
-//==============================================================================
-void PluginHost::setPlayheadMode(PlayheadMode mode) {
-  playheadMode = mode;
-
-  // Reset trigger state when changing mode
-  if (mode != PlayheadMode::AtTrigger) {
-    triggerActive = false;
-  }
+void PluginHost::setBpm(double newBpm) {
+  currentBpm = newBpm;
+  transport.setBpm(newBpm);
 }
 
-void PluginHost::setIndependentPlayheadPosition(double ppqPosition) {
-  independentPpqPosition.store(ppqPosition);
+bool PluginHost::playClip(const File &audioFile) {
+  stopPlayback();
+  return clipPlayer->play(audioFile);
 }
 
-//==============================================================================
-Optional<AudioPlayHead::PositionInfo> PluginHost::getPosition() const {
-  AudioPlayHead::PositionInfo info;
+void PluginHost::playBuffer(std::shared_ptr<const AudioBuffer<float>> audio,
+                            double sampleRate) {
+  stopPlayback();
+  // Unlike rendered files, cached buffers carry the row gain but not the
+  // master gain
+  clipPlayer->play(std::move(audio), sampleRate, currentMasterGain);
+}
 
-  info.setBpm(currentBpm);
-  AudioPlayHead::TimeSignature ts;
-  ts.numerator = 4;
-  ts.denominator = 4;
-  info.setTimeSignature(ts);
+bool PluginHost::isPlayingClip() const { return clipPlayer->isPlaying(); }
 
-  // Determine PPQ position based on playhead mode
-  double ppqPos = 0.0;
-  bool isCurrentlyPlaying = false;
+//==============================================================================
+void PluginHost::setPlayheadMode(PlayheadMode mode) {
+  playheadMode = mode;
 
-  switch (playheadMode) {
+  switch (mode) {
   case PlayheadMode::Independent:
-    // Use the global independent playhead position (cycles 0-64 PPQ = 16 bars)
-    ppqPos = independentPpqPosition.load();
-    isCurrentlyPlaying =
-        true; // Always considered "playing" in independent mode
+    // Runs continuously, cycling over 16 bars
+    transport.setLoop(true, 0.0, independentLoopBeats);
+    transport.play();
     break;
 
   case PlayheadMode::AtTrigger:
-    // Use trigger position if active, otherwise 0
-    if (triggerActive) {
-      ppqPos = triggerPpqPosition;
-      isCurrentlyPlaying = true;
-    } else {
-      ppqPos = 0.0;
-      isCurrentlyPlaying = false;
-    }
+    // Waits at 0 for the next triggered playback
+    transport.setLoop(false, 0.0, 0.0);
+    transport.stop();
+    transport.locate(0.0);
     break;
 
   case PlayheadMode::NoMoving:
-    // Always return 0
-    ppqPos = 0.0;
-    isCurrentlyPlaying = playing.load();
+    transport.setLoop(false, 0.0, 0.0);
+    transport.stop();
+    transport.locate(0.0);
     break;
   }
+}
 
-  info.setTimeInSamples(currentSampleCount);
-  info.setTimeInSeconds(static_cast<double>(currentSampleCount) /
-                        (currentSampleRate > 0 ? currentSampleRate : 44100.0));
-
-  info.setPpqPosition(ppqPos);
-  info.setPpqPositionOfLastBarStart(std::floor(ppqPos / 4.0) * 4.0);
+//==============================================================================
+Optional<AudioPlayHead::PositionInfo> PluginHost::getPosition() const {
+  // The transport state is fixed for the duration of the block, so every
+  // layer sees the same position whichever graph thread it runs on
+  AudioPlayHead::PositionInfo info;
+  transport.fillPositionInfo(
+      info, currentSampleRate > 0 ? currentSampleRate : 44100.0);
 
-  info.setIsPlaying(isCurrentlyPlaying);
-  info.setIsLooping(false);
-  info.setIsRecording(false);
+  // No Moving stays at 0 but still reports whether a cell is playing
+  if (playheadMode.load() == PlayheadMode::NoMoving)
+    info.setIsPlaying(playing.load());
 
   return info;
 }
@@ -305,46 +547,37 @@ void PluginHost::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
   graph->setPlayConfigDetails(0, 2, sampleRate, samplesPerBlockExpected);
   graph->setPlayHead(this);
   graph->prepareToPlay(sampleRate, samplesPerBlockExpected);
+
+  const ScopedLock sl(midiLock);
+  blockMidiBuffer.ensureSize(4096);
+  clockAnchored = false;
 }
 
 void PluginHost::releaseResources() { graph->releaseResources(); }
 
 void PluginHost::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+  TRACE_SCOPE("Audio", "Audio callback");
+
   bufferToFill.clearActiveBufferRegion();
 
-  MidiBuffer midiBuffer;
+  auto &midiBuffer = blockMidiBuffer;
   int numSamples = bufferToFill.numSamples;
 
+  // Position for this block, seen by every plugin through getPosition()
+  const auto &transportState = transport.beginBlock();
+
   {
     const ScopedLock sl(midiLock);
 
     // Add any pending MIDI from input
-    midiBuffer.swapWith(pendingMidiBuffer);
-
-    // Logic for playback
-    if (playing) {
-      processMidiPlayback(midiBuffer, numSamples);
-
-      // Advance time for MIDI playback (always advances for MIDI event timing)
-      double bpm = currentBpm;
-      double beatsPerSecond = bpm / 60.0;
-      double samplesPerBeat = currentSampleRate / beatsPerSecond;
-      double beatsInBlock = numSamples / samplesPerBeat;
-
-      currentPpqPosition += beatsInBlock;
-      currentSampleCount += numSamples;
-
-      // For AtTrigger mode: advance trigger position and check 4-bar limit
-      if (playheadMode == PlayheadMode::AtTrigger && triggerActive) {
-        triggerPpqPosition += beatsInBlock;
-
-        // Stop after 4 bars (16 beats in 4/4)
-        if (triggerPpqPosition >= 16.0) {
-          triggerActive = false;
-          triggerPpqPosition = 0.0;
-        }
-      }
-    }
+    midiBuffer.clear();
+    midiBuffer.addEvents(pendingMidiBuffer, 0, -1, 0);
+    pendingMidiBuffer.clear();
+
+    // Playback, split at the cues that start inside this block
+    updateAudioClock(numSamples);
+    scheduleCues();
+    processCues(midiBuffer, numSamples);
   }
 
   // Process audio through graph
@@ -355,30 +588,38 @@ void PluginHost::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
   // Process audio through the graph
   graph->processBlock(buffer, midiBuffer);
 
+  // Advance by exactly this block's length
+  transport.endBlock(numSamples, currentSampleRate);
+
+  // For AtTrigger mode: stop after 4 bars (16 beats in 4/4)
+  if (playheadMode.load() == PlayheadMode::AtTrigger &&
+      transportState.playing &&
+      transport.getBlockState().ppqPosition >= triggerLengthBeats) {
+    transport.stop();
+    transport.locate(0.0);
+  }
+
   // Measure audio levels for meter (post-gain)
   meterSource.measureBlock(buffer);
 }
 
-void PluginHost::setGain(float gain) {
-  currentRowGain = gain;
+void PluginHost::setLayerGain(AudioPluginInstance *plugin, float gain) {
+  const int index = findLayer(plugin);
+  if (index < 0)
+    return;
+
+  layers[index]->gain = gain;
   // Apply combined gain
-  if (activePluginGainNode) {
-    if (auto *proc = dynamic_cast<GainProcessor *>(
-            activePluginGainNode->getProcessor())) {
-      proc->setGain(currentRowGain * currentMasterGain);
-    }
-  }
+  if (auto *proc = getLayerGainProcessor(index))
+    proc->setGain(gain * currentMasterGain);
 }
 
 void PluginHost::setMasterGain(float gain) {
   currentMasterGain = gain;
-  // Apply combined gain to active plugin
-  if (activePluginGainNode) {
-    if (auto *proc = dynamic_cast<GainProcessor *>(
-            activePluginGainNode->getProcessor())) {
-      proc->setGain(currentRowGain * currentMasterGain);
-    }
-  }
+  // Apply combined gain to every layer
+  for (int i = 0; i < layers.size(); ++i)
+    if (auto *proc = getLayerGainProcessor(i))
+      proc->setGain(layers[i]->gain * currentMasterGain);
 }
 
 //==============================================================================
@@ -393,8 +634,9 @@ void PluginHost::handleIncomingMidiMessage(MidiInput *source,
   pendingMidiBuffer.addEvent(message, 0);
 }
 
-void PluginHost::processMidiPlayback(MidiBuffer &midiBuffer, int numSamples) {
-  if (!playing || playbackSequence.getNumEvents() == 0)
+void PluginHost::processMidiPlayback(MidiBuffer &midiBuffer, int startSample,
+                                     int numSamples) {
+  if (!playing || numSamples <= 0)
     return;
 
   double bpm = currentBpm;
@@ -405,15 +647,20 @@ void PluginHost::processMidiPlayback(MidiBuffer &midiBuffer, int numSamples) {
   double startPpq = currentPpqPosition;
   double endPpq = startPpq + (numSamples / samplesPerBeat);
 
+  // Advance time for MIDI playback (always advances for MIDI event timing)
+  currentPpqPosition = endPpq;
+
+  const auto &sequence = *playbackSource;
+
   // Find events in this PPQ range
-  while (nextEventIndex < playbackSequence.getNumEvents()) {
-    auto *event = playbackSequence.getEventPointer(nextEventIndex);
+  while (nextEventIndex < sequence.getNumEvents()) {
+    auto *event = sequence.getEventPointer(nextEventIndex);
     // Timestamps are now expected to be in PPQ (Beats)
     double eventPpq = event->message.getTimeStamp();
 
     if (eventPpq < startPpq) {
       // Catch up missed events at start of block
-      midiBuffer.addEvent(event->message, 0);
+      midiBuffer.addEvent(event->message, startSample);
       nextEventIndex++;
     } else if (eventPpq < endPpq) {
       // Event falls in this block
@@ -421,10 +668,161 @@ void PluginHost::processMidiPlayback(MidiBuffer &midiBuffer, int numSamples) {
       int sampleOffset = static_cast<int>(ppqOffset * samplesPerBeat);
       sampleOffset = jlimit(0, numSamples - 1, sampleOffset);
 
-      midiBuffer.addEvent(event->message, sampleOffset);
+      midiBuffer.addEvent(event->message, startSample + sampleOffset);
       nextEventIndex++;
     } else {
       break;
     }
   }
 }
+
+//==============================================================================
+void PluginHost::setCueTable(std::unique_ptr<CueTable> newTable) {
+  {
+    const ScopedLock cl(cueLock);
+    const ScopedLock sl(midiLock);
+
+    // A cue that is still playing keeps going from a copy of its sequence
+    if (playbackSource != &playbackSequence) {
+      playbackSequence = *playbackSource;
+      playbackSource = &playbackSequence;
+    }
+
+    std::swap(cueTable, newTable);
+  }
+
+  // The previous table is released here, outside the locks
+}
+
+bool PluginHost::cueCell(int row, int column, double timeMs) {
+  const ScopedLock cl(cueLock);
+
+  if (cueTable == nullptr || row != cueTable->row ||
+      !isPositiveAndBelow(column, static_cast<int>(cueTable->columns.size())))
+    return false;
+
+  return pushCue({row, column, timeMs});
+}
+
+bool PluginHost::cueStop(double timeMs) {
+  const ScopedLock cl(cueLock);
+  return pushCue({-1, -1, timeMs});
+}
+
+// Called with cueLock held, so there is only ever one writer
+bool PluginHost::pushCue(const CueEvent &cue) {
+  const auto scope = cueFifo.write(1);
+  if (scope.blockSize1 + scope.blockSize2 == 0)
+    return false;
+
+  cueBuffer[static_cast<size_t>(
+      scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = cue;
+  return true;
+}
+
+void PluginHost::updateAudioClock(int numSamples) {
+  const double nowMs = Time::getMillisecondCounterHiRes();
+  const double expectedMs =
+      clockAnchorMs + static_cast<double>(audioSamplePosition -
+                                          clockAnchorSample) *
+                          1000.0 / currentSampleRate;
+
+  // Callback jitter is ignored so that cues keep their relative timing;
+  // the clock is only re-anchored after a dropout or a device change
+  const double toleranceMs =
+      jmax(20.0, 2000.0 * numSamples / currentSampleRate);
+  if (!clockAnchored || std::abs(nowMs - expectedMs) > toleranceMs) {
+    clockAnchorMs = nowMs;
+    clockAnchorSample = audioSamplePosition;
+    clockAnchored = true;
+  }
+}
+
+void PluginHost::scheduleCues() {
+  const auto scope = cueFifo.read(cueFifo.getNumReady());
+
+  auto schedule = [this](int start, int size) {
+    for (int i = start; i < start + size; ++i) {
+      auto cue = cueBuffer[static_cast<size_t>(i)];
+      cue.samplePosition =
+          cue.timeMs > 0.0
+              ? clockAnchorSample +
+                    static_cast<int64>((cue.timeMs - clockAnchorMs) *
+                                       currentSampleRate / 1000.0)
+              : audioSamplePosition;
+
+      if (numScheduledCues == static_cast<int>(scheduledCues.size()))
+        continue; // Full: drop it rather than block the audio thread
+
+      // Kept sorted by start time
+      int index = numScheduledCues++;
+      for (; index > 0 &&
+             scheduledCues[static_cast<size_t>(index - 1)].samplePosition >
+                 cue.samplePosition;
+           --index)
+        scheduledCues[static_cast<size_t>(index)] =
+            scheduledCues[static_cast<size_t>(index - 1)];
+      scheduledCues[static_cast<size_t>(index)] = cue;
+    }
+  };
+
+  schedule(scope.startIndex1, scope.blockSize1);
+  schedule(scope.startIndex2, scope.blockSize2);
+}
+
+void PluginHost::processCues(MidiBuffer &midiBuffer, int numSamples) {
+  const int64 blockEnd = audioSamplePosition + numSamples;
+  int position = 0;
+  int numStarted = 0;
+
+  for (; numStarted < numScheduledCues; ++numStarted) {
+    const auto &cue = scheduledCues[static_cast<size_t>(numStarted)];
+    if (cue.samplePosition >= blockEnd)
+      break;
+
+    // Late cues start right away
+    const int offset = jmax(
+        position, static_cast<int>(cue.samplePosition - audioSamplePosition));
+    processMidiPlayback(midiBuffer, position, offset - position);
+    startCue(midiBuffer, cue, offset);
+    position = offset;
+  }
+
+  processMidiPlayback(midiBuffer, position, numSamples - position);
+
+  std::move(scheduledCues.begin() + numStarted,
+            scheduledCues.begin() + numScheduledCues, scheduledCues.begin());
+  numScheduledCues -= numStarted;
+  audioSamplePosition = blockEnd;
+}
+
+// Audio thread, with midiLock held
+void PluginHost::startCue(MidiBuffer &midiBuffer, const CueEvent &cue,
+                          int sampleOffset) {
+  clipPlayer->stop();
+
+  if (playing)
+    for (int ch = 1; ch <= 16; ++ch)
+      midiBuffer.addEvent(MidiMessage::allNotesOff(ch), sampleOffset);
+
+  // The table may have been replaced since the cue was queued
+  const bool isStart =
+      cue.column >= 0 && cueTable != nullptr && cue.row == cueTable->row &&
+      isPositiveAndBelow(cue.column,
+                         static_cast<int>(cueTable->columns.size()));
+
+  playing = isStart;
+  if (isStart) {
+    playbackSource = cueTable->columns[static_cast<size_t>(cue.column)].get();
+    currentPpqPosition = 0.0;
+    nextEventIndex = 0;
+  }
+
+  if (playheadMode.load() == PlayheadMode::AtTrigger) {
+    transport.locate(0.0);
+    if (isStart)
+      transport.play();
+    else
+      transport.stop();
+  }
+}
@@ -13,7 +13,9 @@
 #pragma once
 
 #include "../ConfigurationPanel.h"
+#include "Transport.h"
 #include <JuceHeader.h>
+#include <array>
 
 class GainProcessor : public AudioProcessor {
 public:
@@ -28,10 +30,12 @@ public:
 
   void processBlock(AudioBuffer<float> &buffer, MidiBuffer &) override {
     buffer.applyGain(gain);
+    meterSource.measureBlock(buffer);
   }
 
   void processBlock(AudioBuffer<double> &buffer, MidiBuffer &) override {
     buffer.applyGain(gain);
+    meterSource.measureBlock(buffer);
   }
 
   AudioProcessorEditor *createEditor() override { return nullptr; }
@@ -50,10 +54,16 @@ public:
 
   void setGain(float newGain) { gain = newGain; }
 
+  // Post-gain level; lives as long as the node, so readers never outlive it
+  foleys::LevelMeterSource &getMeterSource() { return meterSource; }
+
 private:
   float gain = 1.0f;
+  foleys::LevelMeterSource meterSource;
 };
 
+class ClipPlayerProcessor;
+
 //==============================================================================
 class PluginHost : public AudioSource,
                    public MidiInputCallback,
@@ -65,9 +75,16 @@ public:
 
   //==============================================================================
   // Plugin management
-  // Uses ProxyProcessor internally to allow shared ownership with MidiGrid
-  void setActivePlugin(AudioPluginInstance *plugin);
-  AudioPluginInstance *getActivePlugin() const;
+  // Uses ProxyProcessor internally to allow shared ownership with MidiGrid.
+  // Several plugins can be active as layers: each gets the same MIDI, has
+  // its own gain and meter, and the graph processes them in parallel.
+  void setActivePlugin(AudioPluginInstance *plugin); // Replaces all layers
+  void addLayer(AudioPluginInstance *plugin, float gain);
+  void removeLayer(AudioPluginInstance *plugin);
+  bool hasLayer(AudioPluginInstance *plugin) const;
+
+  AudioPluginInstance *getActivePlugin() const; // First layer
+  Array<AudioPluginInstance *> getActivePlugins() const;
 
   void setAcceptingMidiInput(bool accept);
   bool isAcceptingMidiInput() const { return acceptMidiInput; }
@@ -80,17 +97,40 @@ public:
 
   void setBpm(double newBpm);
 
+  // Preview of an already rendered cell: the WAV is streamed from a
+  // memory-mapped file (or the audio is already in memory), so no plugin
+  // has to run. Replaces any MIDI or clip
+  // playback; stopPlayback() stops it too.
+  bool playClip(const File &audioFile);
+  void playBuffer(std::shared_ptr<const AudioBuffer<float>> audio,
+                  double sampleRate);
+  bool isPlayingClip() const;
+
   //==============================================================================
   // Playhead mode control
   void setPlayheadMode(PlayheadMode mode);
   PlayheadMode getPlayheadMode() const { return playheadMode; }
 
-  // For Independent mode: set the global playhead position from
-  // ConfigurationPanel
-  void setIndependentPlayheadPosition(double ppqPosition);
-  double getIndependentPlayheadPosition() const {
-    return independentPpqPosition;
-  }
+  // Advanced by the audio callback; use getSnapshot() to display it
+  const Transport &getTransport() const { return transport; }
+
+  //==============================================================================
+  // Cells that can be started by the audio callback itself: the transformed
+  // MIDI of every column, playable on the row whose plugin is active.
+  // Swapped in whole from the message thread.
+  struct CueTable {
+    std::vector<std::shared_ptr<const MidiMessageSequence>> columns;
+    int row = -1;
+  };
+
+  void setCueTable(std::unique_ptr<CueTable> newTable);
+
+  // Queue a cell start (or a stop) for the audio callback, from any thread.
+  // timeMs is a Time::getMillisecondCounterHiRes() time to start at, or 0
+  // for the next block. Returns false if the cell has no cue or the queue
+  // is full: it then has to be played through the message thread.
+  bool cueCell(int row, int column, double timeMs = 0.0);
+  bool cueStop(double timeMs = 0.0);
 
   //==============================================================================
   // AudioPlayHead implementation
@@ -100,9 +140,14 @@ public:
   // Audio level metering
   foleys::LevelMeterSource *getMeterSource() { return &meterSource; }
 
-  void setGain(float gain);
+  foleys::LevelMeterSource *getLayerMeterSource(AudioPluginInstance *plugin);
+
+  void setLayerGain(AudioPluginInstance *plugin, float gain);
   void setMasterGain(float gain);
 
+  // Share of the audio callback's time budget in use (0..1)
+  double getCpuLoad() const;
+
 private:
   //==============================================================================
   // AudioSource
@@ -127,45 +172,88 @@ private:
   ayra::AudioProcessorGraph::Node::Ptr midiInputNode;
   ayra::AudioProcessorGraph::Node::Ptr audioOutputNode;
 
-  ayra::AudioProcessorGraph::Node::Ptr activePluginNode;
-  ayra::AudioProcessorGraph::Node::Ptr activePluginGainNode;
+  struct Layer {
+    AudioPluginInstance *plugin = nullptr;
+    ayra::AudioProcessorGraph::Node::Ptr pluginNode;
+    ayra::AudioProcessorGraph::Node::Ptr gainNode;
+    float gain = 1.0f;
+  };
+  OwnedArray<Layer> layers; // Guarded by midiLock
+
+  ayra::AudioProcessorGraph::Node::Ptr clipPlayerNode;
+  ClipPlayerProcessor *clipPlayer = nullptr; // Owned by clipPlayerNode
 
-  // Gain state for combined gain calculation
-  float currentRowGain = 1.0f;
+  // Master gain, combined with each layer's gain
   float currentMasterGain = 1.0f;
 
   // State
   bool acceptMidiInput = false;
   std::atomic<bool> playing{false};
 
-  // Playback state
+  // Playback state. The source is playbackSequence, or a sequence of the
+  // cue table when the audio callback started a cue.
   MidiMessageSequence playbackSequence;
+  const MidiMessageSequence *playbackSource = &playbackSequence;
 
-  // Timing state
+  // Timing state (currentPpqPosition is relative to the playback start)
   std::atomic<double> currentBpm{120.0};
   double currentPpqPosition = 0.0;
-  std::atomic<int64> currentSampleCount{0};
   int nextEventIndex = 0;
 
-  // Playhead mode state
-  PlayheadMode playheadMode = PlayheadMode::Independent;
-  std::atomic<double> independentPpqPosition{0.0};
-  double triggerPpqPosition = 0.0; // For AtTrigger mode
-  bool triggerActive = false;      // For AtTrigger mode
+  // Playhead exposed to the plugins
+  Transport transport;
+  std::atomic<PlayheadMode> playheadMode{PlayheadMode::Independent};
+  static constexpr double independentLoopBeats = 64.0; // 16 bars
+  static constexpr double triggerLengthBeats = 16.0;   // 4 bars
 
   // Audio processing
   double currentSampleRate = 44100.0;
   int currentBlockSize = 2048;
 
   MidiBuffer pendingMidiBuffer;
+  MidiBuffer blockMidiBuffer; // Preallocated, reused every block
   CriticalSection midiLock;
 
+  // Cues, queued lock-free and scheduled by the audio callback.
+  // cueLock only serialises the producers with setCueTable().
+  struct CueEvent {
+    int row = -1;
+    int column = -1; // -1 = stop
+    double timeMs = 0.0;
+    int64 samplePosition = 0; // Set when scheduled
+  };
+
+  std::unique_ptr<CueTable> cueTable; // Guarded by midiLock and cueLock
+  CriticalSection cueLock;
+  AbstractFifo cueFifo{256};
+  std::array<CueEvent, 256> cueBuffer;
+  std::array<CueEvent, 64> scheduledCues; // Audio thread only
+  int numScheduledCues = 0;
+
+  // Audio clock: samples since the device started, anchored to
+  // Time::getMillisecondCounterHiRes() to place timed cues
+  int64 audioSamplePosition = 0;
+  int64 clockAnchorSample = 0;
+  double clockAnchorMs = 0.0;
+  bool clockAnchored = false;
+
   // Level metering
   foleys::LevelMeterSource meterSource;
 
   // Helpers
-  void processMidiPlayback(MidiBuffer &midiBuffer, int numSamples);
-  void rebuildGraph(AudioPluginInstance *plugin);
+  void processMidiPlayback(MidiBuffer &midiBuffer, int startSample,
+                           int numSamples);
+  void updateAudioClock(int numSamples);
+  void scheduleCues();
+  void processCues(MidiBuffer &midiBuffer, int numSamples);
+  void startCue(MidiBuffer &midiBuffer, const CueEvent &cue,
+                int sampleOffset);
+  bool pushCue(const CueEvent &cue);
+  void addLayerNodes(AudioPluginInstance *plugin, float gain);
+  void removeLayerNodes(int index);
+  void updateGraph();
+  int findLayer(AudioPluginInstance *plugin) const;
+  GainProcessor *getLayerGainProcessor(int index) const;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginHost)
 };
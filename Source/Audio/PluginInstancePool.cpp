@@ -0,0 +1,449 @@
+/*
+  ==============================================================================
+
+    PluginInstancePool.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "PluginInstancePool.h"
+#include "../Rendering/ContentHash.h"
+#include "../Rendering/RenderCostModel.h"
+
+static constexpr double previewSampleRate = 44100.0;
+static constexpr int previewBlockSize = 2048;
+
+//==============================================================================
+PluginInstancePool::PluginInstancePool(ayra::PluginsManager &pm)
+    : pluginsManager(pm),
+      restorePool(jlimit(2, 8, SystemStats::getNumCpus() / 2)) {
+  auto *userSettings = ayra::app_properties->getUserSettings();
+
+  // 0 = auto: allow previews to use up to a quarter of the physical RAM
+  const int64 limitMB = userSettings->getIntValue("previewMemoryLimitMB", 0);
+  const int64 autoMB =
+      jmax<int64>(1024, SystemStats::getMemorySizeInMegabytes() / 4);
+
+  setLimits(userSettings->getIntValue("previewMaxInstances", 8),
+            (limitMB > 0 ? limitMB : autoMB) * 1024 * 1024);
+}
+
+PluginInstancePool::~PluginInstancePool() {
+  onInstanceCreated = nullptr;
+  onInstanceReleased = nullptr;
+  onPrewarmFinished = nullptr;
+
+  // Pending restores own their instances, so they just get dropped
+  restorePool.removeAllJobs(true, 10000);
+
+  for (auto &[id, slot] : slots)
+    releaseInstance(id, slot, false);
+}
+
+//==============================================================================
+PluginInstancePool::SlotId PluginInstancePool::createSlot() {
+  const SlotId id = nextSlotId++;
+  slots[id];
+  return id;
+}
+
+void PluginInstancePool::removeSlot(SlotId id) {
+  if (auto *slot = findSlot(id)) {
+    releaseInstance(id, *slot, false);
+    slots.erase(id);
+  }
+}
+
+void PluginInstancePool::setSlotPlugin(
+    SlotId id, std::unique_ptr<AudioPluginInstance> instance,
+    const PluginDescription &desc) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr || instance == nullptr)
+    return;
+
+  releaseInstance(id, *slot, false);
+  slot->desc = desc;
+  slot->hasDescription = true;
+  slot->state.reset();
+  slot->stateLoader = nullptr;
+  slot->snapshot.reset();
+  slot->stateVersion++;
+  slot->generation++;
+
+  adoptInstance(id, *slot, std::move(instance), getEstimatedBytes(desc));
+  enforceLimits(id);
+}
+
+void PluginInstancePool::setSlotDescription(SlotId id,
+                                            const PluginDescription &desc,
+                                            const MemoryBlock &state,
+                                            StateLoader stateLoader) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr)
+    return;
+
+  releaseInstance(id, *slot, false);
+  slot->desc = desc;
+  slot->hasDescription = true;
+  slot->state = state;
+  slot->stateLoader = state.getSize() == 0 ? std::move(stateLoader) : nullptr;
+  slot->snapshot.reset();
+  slot->stateVersion++;
+  slot->generation++;
+}
+
+void PluginInstancePool::clearSlot(SlotId id) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr)
+    return;
+
+  releaseInstance(id, *slot, false);
+  slot->desc = {};
+  slot->hasDescription = false;
+  slot->state.reset();
+  slot->stateLoader = nullptr;
+  slot->snapshot.reset();
+  slot->stateVersion++;
+  slot->generation++;
+}
+
+bool PluginInstancePool::hasPlugin(SlotId id) const {
+  auto *slot = findSlot(id);
+  return slot != nullptr && slot->hasDescription;
+}
+
+PluginDescription PluginInstancePool::getDescription(SlotId id) const {
+  auto *slot = findSlot(id);
+  return slot != nullptr ? slot->desc : PluginDescription();
+}
+
+MemoryBlock PluginInstancePool::getState(SlotId id) const {
+  auto *slot = findSlot(id);
+  if (slot == nullptr)
+    return {};
+
+  if (slot->instance == nullptr)
+    return resolveState(*slot);
+
+  MemoryBlock state;
+  slot->instance->getStateInformation(state);
+  return state;
+}
+
+PluginInstancePool::StateLoader
+PluginInstancePool::getStateSnapshot(SlotId id) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr || !slot->hasDescription)
+    return {};
+
+  if (slot->instance != nullptr) {
+    if (slot->watcher->changed.exchange(false) || slot->snapshot == nullptr) {
+      auto state = std::make_shared<MemoryBlock>();
+      slot->instance->getStateInformation(*state);
+      slot->snapshot = std::move(state);
+      slot->stateVersion++;
+    }
+  } else if (slot->stateLoader != nullptr) {
+    return slot->stateLoader;
+  } else if (slot->snapshot == nullptr) {
+    slot->snapshot = std::make_shared<const MemoryBlock>(slot->state);
+  }
+
+  return [snapshot = slot->snapshot] { return *snapshot; };
+}
+
+uint32 PluginInstancePool::getStateVersion(SlotId id) const {
+  auto *slot = findSlot(id);
+  return slot != nullptr ? slot->stateVersion : 0;
+}
+
+uint64 PluginInstancePool::getStateHash(SlotId id) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr || !slot->hasDescription)
+    return 0;
+
+  // Bumps the version first if a live instance reported a change
+  auto snapshot = getStateSnapshot(id);
+
+  if (!slot->hasStateHash || slot->stateHashVersion != slot->stateVersion) {
+    slot->stateHash = ContentHash().add(snapshot()).getValue();
+    slot->stateHashVersion = slot->stateVersion;
+    slot->hasStateHash = true;
+  }
+
+  return slot->stateHash;
+}
+
+//==============================================================================
+AudioPluginInstance *PluginInstancePool::getInstance(SlotId id) const {
+  auto *slot = findSlot(id);
+  return slot != nullptr ? slot->instance.get() : nullptr;
+}
+
+AudioPluginInstance *PluginInstancePool::acquire(SlotId id,
+                                                 String &errorMessage) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr || !slot->hasDescription)
+    return nullptr;
+
+  if (slot->instance != nullptr) {
+    slot->lastUsed = ++useCounter;
+    return slot->instance.get();
+  }
+
+  RenderCostModel::LoadProbe loadProbe;
+
+  ayra::PluginDescriptionAndPreference descPref;
+  descPref.pluginDescription = slot->desc;
+  auto instance = pluginsManager.createPluginInstance(
+      descPref, previewSampleRate, previewBlockSize, errorMessage);
+
+  if (instance == nullptr)
+    return nullptr;
+
+  if (auto &state = resolveState(*slot); state.getSize() > 0)
+    instance->setStateInformation(state.getData(),
+                                  static_cast<int>(state.getSize()));
+
+  // The RSS delta is only a rough figure, but it is the best we have before
+  // the plugin has been rendered once. It is not taken while a batch or
+  // another preview instance is loading alongside.
+  const int64 residentDelta = loadProbe.finish();
+  if (residentDelta > 0)
+    measuredBytes[RenderCostModel::getPluginKey(slot->desc)] = residentDelta;
+
+  adoptInstance(id, *slot, std::move(instance), getEstimatedBytes(slot->desc));
+  enforceLimits(id);
+
+  if (onInstanceCreated)
+    onInstanceCreated(id);
+
+  return getInstance(id);
+}
+
+void PluginInstancePool::prewarm(SlotId id) {
+  auto *slot = findSlot(id);
+  if (slot == nullptr || !slot->hasDescription || slot->instance != nullptr ||
+      slot->prewarmPending)
+    return;
+
+  slot->prewarmPending = true;
+
+  WeakReference<PluginInstancePool> weakThis(this);
+  const int generation = slot->generation;
+
+  pluginsManager.getFormatManager().createPluginInstanceAsync(
+      slot->desc, previewSampleRate, previewBlockSize,
+      [weakThis, id, generation](std::unique_ptr<AudioPluginInstance> instance,
+                                 const String &error) {
+        auto *pool = weakThis.get();
+        if (pool == nullptr)
+          return;
+
+        if (instance == nullptr)
+          DBG("Prewarm failed: " + error);
+
+        pool->restoreStateInBackground(id, generation, std::move(instance));
+      });
+}
+
+bool PluginInstancePool::isPrewarming(SlotId id) const {
+  auto *slot = findSlot(id);
+  return slot != nullptr && slot->prewarmPending;
+}
+
+void PluginInstancePool::restoreStateInBackground(
+    SlotId id, int generation, std::unique_ptr<AudioPluginInstance> instance) {
+  auto *slot = findSlot(id);
+  if (instance == nullptr || slot == nullptr ||
+      slot->generation != generation ||
+      (slot->state.getSize() == 0 && slot->stateLoader == nullptr)) {
+    finishPrewarm(id, generation, std::move(instance));
+    return;
+  }
+
+  // Restoring state is where sample-based instruments spend most of their
+  // load time, so do it off the message thread
+  WeakReference<PluginInstancePool> weakThis(this);
+  auto holder = std::make_shared<std::unique_ptr<AudioPluginInstance>>(
+      std::move(instance));
+  MemoryBlock state(slot->state);
+  StateLoader loader(slot->stateLoader);
+
+  // A state still in the project file is read on the pool as well; the
+  // slot keeps its loader, as the live instance replaces it anyway
+  restorePool.addJob([weakThis, id, generation, holder, state, loader] {
+    MemoryBlock loaded;
+    if (loader != nullptr)
+      loaded = loader();
+
+    const auto &toRestore = loader != nullptr ? loaded : state;
+    if (toRestore.getSize() > 0)
+      (*holder)->setStateInformation(toRestore.getData(),
+                                     static_cast<int>(toRestore.getSize()));
+
+    MessageManager::callAsync([weakThis, id, generation, holder] {
+      if (auto *pool = weakThis.get())
+        pool->finishPrewarm(id, generation, std::move(*holder));
+    });
+  });
+}
+
+void PluginInstancePool::finishPrewarm(
+    SlotId id, int generation, std::unique_ptr<AudioPluginInstance> instance) {
+  bool success = false;
+
+  if (auto *slot = findSlot(id)) {
+    slot->prewarmPending = false;
+
+    // Discard results for a plugin that has since been replaced, or a slot
+    // that was filled synchronously in the meantime
+    if (instance != nullptr && slot->generation == generation &&
+        slot->instance == nullptr) {
+      adoptInstance(id, *slot, std::move(instance),
+                    getEstimatedBytes(slot->desc));
+      enforceLimits(id);
+      success = true;
+    }
+  }
+
+  if (success && onInstanceCreated)
+    onInstanceCreated(id);
+
+  if (onPrewarmFinished)
+    onPrewarmFinished(id, success);
+}
+
+void PluginInstancePool::pin(SlotId id) {
+  if (auto *slot = findSlot(id))
+    slot->pinCount++;
+}
+
+void PluginInstancePool::unpin(SlotId id) {
+  if (auto *slot = findSlot(id)) {
+    slot->pinCount = jmax(0, slot->pinCount - 1);
+    enforceLimits(id);
+  }
+}
+
+//==============================================================================
+void PluginInstancePool::setLimits(int maxInstances, int64 maxBytes) {
+  maxLiveInstances = jmax(1, maxInstances);
+  maxLiveBytes = maxBytes;
+  enforceLimits(0);
+}
+
+int PluginInstancePool::getNumLiveInstances() const {
+  int count = 0;
+  for (auto &[id, slot] : slots)
+    if (slot.instance != nullptr)
+      count++;
+  return count;
+}
+
+int64 PluginInstancePool::getLiveBytes() const {
+  int64 total = 0;
+  for (auto &[id, slot] : slots)
+    if (slot.instance != nullptr)
+      total += slot.estimatedBytes;
+  return total;
+}
+
+//==============================================================================
+PluginInstancePool::Slot *PluginInstancePool::findSlot(SlotId id) {
+  auto it = slots.find(id);
+  return it != slots.end() ? &it->second : nullptr;
+}
+
+const PluginInstancePool::Slot *PluginInstancePool::findSlot(SlotId id) const {
+  auto it = slots.find(id);
+  return it != slots.end() ? &it->second : nullptr;
+}
+
+const MemoryBlock &PluginInstancePool::resolveState(const Slot &slot) {
+  if (slot.stateLoader != nullptr) {
+    slot.state = slot.stateLoader();
+    slot.stateLoader = nullptr;
+  }
+  return slot.state;
+}
+
+void PluginInstancePool::adoptInstance(
+    SlotId id, Slot &slot, std::unique_ptr<AudioPluginInstance> instance,
+    int64 bytes) {
+  slot.instance = std::move(instance);
+  slot.estimatedBytes = bytes;
+  slot.lastUsed = ++useCounter;
+  slot.state.reset(); // The live instance is now the source of truth
+  slot.stateLoader = nullptr;
+
+  // An instance restored from the snapshot's state starts out unchanged
+  slot.watcher = std::make_unique<ChangeWatcher>();
+  slot.watcher->changed = slot.snapshot == nullptr;
+  slot.instance->addListener(slot.watcher.get());
+  DBG("Preview instance created for slot " + String(id) + " (" +
+      String(getNumLiveInstances()) + " live)");
+}
+
+void PluginInstancePool::releaseInstance(SlotId id, Slot &slot,
+                                         bool keepState) {
+  if (slot.instance == nullptr)
+    return;
+
+  if (keepState) {
+    slot.state.reset();
+    slot.stateLoader = nullptr;
+    slot.instance->getStateInformation(slot.state);
+
+    if (slot.watcher->changed) {
+      slot.snapshot.reset();
+      slot.stateVersion++;
+    }
+  }
+
+  if (onInstanceReleased)
+    onInstanceReleased(id, slot.instance.get());
+
+  slot.instance->removeListener(slot.watcher.get());
+  slot.instance.reset();
+  slot.watcher.reset();
+  slot.estimatedBytes = 0;
+}
+
+void PluginInstancePool::enforceLimits(SlotId justUsed) {
+  for (;;) {
+    const bool overCount = getNumLiveInstances() > maxLiveInstances;
+    const bool overBytes = maxLiveBytes > 0 && getLiveBytes() > maxLiveBytes;
+    if (!overCount && !overBytes)
+      return;
+
+    // Least recently used, unpinned, and not the one just requested
+    SlotId victimId = 0;
+    Slot *victim = nullptr;
+    for (auto &[id, slot] : slots) {
+      if (slot.instance == nullptr || slot.pinCount > 0 || id == justUsed)
+        continue;
+      if (victim == nullptr || slot.lastUsed < victim->lastUsed) {
+        victimId = id;
+        victim = &slot;
+      }
+    }
+
+    if (victim == nullptr)
+      return; // Everything left is pinned
+
+    DBG("Evicting preview instance for slot " + String(victimId));
+    releaseInstance(victimId, *victim, true);
+  }
+}
+
+int64 PluginInstancePool::getEstimatedBytes(
+    const PluginDescription &desc) const {
+  auto it = measuredBytes.find(RenderCostModel::getPluginKey(desc));
+  return it != measuredBytes.end() ? it->second
+                                   : RenderCostModel::defaultInstanceBytes;
+}
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    PluginInstancePool.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Owns the live preview instances for the grid rows. A row only keeps a
+    slot (description + state blob); instances are created on demand and the
+    least recently used ones are evicted, with their state saved back into
+    the slot, once the instance or memory limit is exceeded.
+
+    All methods must be called from the message thread. Prewarmed instances
+    have their saved state restored on a background pool, so several heavy
+    plugins can load their samples at the same time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class PluginInstancePool {
+public:
+  using SlotId = int;
+  // Reads a saved state on demand (e.g. from the project file)
+  using StateLoader = std::function<MemoryBlock()>;
+
+  //==============================================================================
+  explicit PluginInstancePool(ayra::PluginsManager &pm);
+  ~PluginInstancePool();
+
+  //==============================================================================
+  SlotId createSlot();
+  void removeSlot(SlotId id);
+
+  // Adopt an instance the user just loaded
+  void setSlotPlugin(SlotId id, std::unique_ptr<AudioPluginInstance> instance,
+                     const PluginDescription &desc);
+
+  // Assign a plugin without instantiating it (instance created on demand).
+  // With a loader, the state is only read when the slot first needs it.
+  void setSlotDescription(SlotId id, const PluginDescription &desc,
+                          const MemoryBlock &state,
+                          StateLoader stateLoader = {});
+  void clearSlot(SlotId id);
+
+  bool hasPlugin(SlotId id) const;
+  PluginDescription getDescription(SlotId id) const;
+  MemoryBlock getState(SlotId id) const;
+
+  // State for saving without stalling the UI. A live instance is only asked
+  // for its state if it reported a change since the last snapshot; other
+  // slots share their saved copy, or return their loader unread.
+  StateLoader getStateSnapshot(SlotId id);
+  // Changes whenever the slot's plugin or state may have changed
+  uint32 getStateVersion(SlotId id) const;
+  // ContentHash of the state (see RenderManifest::JobInputs), cached per
+  // state version. Refreshes the snapshot like getStateSnapshot() does.
+  uint64 getStateHash(SlotId id);
+
+  //==============================================================================
+  // Live instance or nullptr if the slot is empty or currently evicted
+  AudioPluginInstance *getInstance(SlotId id) const;
+
+  // Live instance, created synchronously if needed. Marks it as most
+  // recently used.
+  AudioPluginInstance *acquire(SlotId id, String &errorMessage);
+
+  // Start creating the instance in the background (no-op if already live
+  // or already prewarming)
+  void prewarm(SlotId id);
+  bool isPrewarming(SlotId id) const;
+
+  // Pinned instances (active in the host, editor open) are never evicted
+  void pin(SlotId id);
+  void unpin(SlotId id);
+
+  //==============================================================================
+  void setLimits(int maxInstances, int64 maxBytes);
+  int getMaxLiveInstances() const { return maxLiveInstances; }
+  int getNumLiveInstances() const;
+  int64 getLiveBytes() const;
+
+  //==============================================================================
+  std::function<void(SlotId)> onInstanceCreated;
+  // Called for every prewarm request once it has completed or failed
+  std::function<void(SlotId, bool success)> onPrewarmFinished;
+  // Called right before an instance is destroyed (eviction or removal)
+  std::function<void(SlotId, AudioPluginInstance *)> onInstanceReleased;
+
+private:
+  //==============================================================================
+  // Flags parameter and state changes reported by a live instance. May be
+  // called from the audio thread.
+  struct ChangeWatcher : public AudioProcessorListener {
+    std::atomic<bool> changed{true};
+
+    void audioProcessorParameterChanged(AudioProcessor *, int,
+                                        float) override {
+      changed = true;
+    }
+    void audioProcessorChanged(AudioProcessor *,
+                               const ChangeDetails &) override {
+      changed = true;
+    }
+  };
+
+  struct Slot {
+    PluginDescription desc;
+    bool hasDescription = false;
+    // Resolved lazily: the loader is replaced by its result on first use
+    mutable MemoryBlock state;
+    mutable StateLoader stateLoader;
+
+    std::unique_ptr<AudioPluginInstance> instance;
+    std::unique_ptr<ChangeWatcher> watcher; // While the instance is live
+    std::shared_ptr<const MemoryBlock> snapshot;
+    uint32 stateVersion = 0;
+    uint64 stateHash = 0;
+    uint32 stateHashVersion = 0;
+    bool hasStateHash = false;
+    int64 estimatedBytes = 0;
+    uint32 lastUsed = 0;
+    int pinCount = 0;
+
+    int generation = 0; // Bumped whenever the plugin changes
+    bool prewarmPending = false;
+  };
+
+  ayra::PluginsManager &pluginsManager;
+
+  std::map<SlotId, Slot> slots;
+  SlotId nextSlotId = 1;
+  uint32 useCounter = 0;
+
+  int maxLiveInstances = 8;
+  int64 maxLiveBytes = 0;
+
+  // Measured footprint per plugin, reused for background-created instances
+  std::map<String, int64> measuredBytes;
+
+  ThreadPool restorePool;
+
+  //==============================================================================
+  Slot *findSlot(SlotId id);
+  const Slot *findSlot(SlotId id) const;
+  static const MemoryBlock &resolveState(const Slot &slot);
+
+  void adoptInstance(SlotId id, Slot &slot,
+                     std::unique_ptr<AudioPluginInstance> instance,
+                     int64 bytes);
+  void releaseInstance(SlotId id, Slot &slot, bool keepState);
+  void restoreStateInBackground(SlotId id, int generation,
+                                std::unique_ptr<AudioPluginInstance> instance);
+  void finishPrewarm(SlotId id, int generation,
+                     std::unique_ptr<AudioPluginInstance> instance);
+  void enforceLimits(SlotId justUsed);
+  int64 getEstimatedBytes(const PluginDescription &desc) const;
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(PluginInstancePool)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginInstancePool)
+};
@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+    PreviewRenderCache.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "PreviewRenderCache.h"
+#include "../Rendering/ParallelBatchRenderer.h"
+#include "../TraceRecorder.h"
+#include "MidiPlayer.h"
+
+static constexpr double tailSeconds = 4.0;
+static constexpr float silenceThresholdDb = -60.0f;
+static constexpr int yieldPollMs = 50;
+
+//==============================================================================
+PreviewRenderCache::PreviewRenderCache(ayra::PluginsManager &pm)
+    : Thread("Preview Render Cache"), pluginsManager(pm) {
+  const int limitMB = ayra::app_properties->getUserSettings()->getIntValue(
+      "previewCacheMemoryMB", 512);
+  memoryLimitBytes = static_cast<int64>(jmax(0, limitMB)) * 1024 * 1024;
+
+  startThread(Thread::Priority::background);
+}
+
+PreviewRenderCache::~PreviewRenderCache() {
+  {
+    const ScopedLock sl(lock);
+    pending.clear();
+    pendingKeys.clear();
+  }
+
+  stopThread(10000);
+}
+
+//==============================================================================
+void PreviewRenderCache::setPendingCells(
+    const std::vector<RenderManifest::JobInputs> &cells) {
+  {
+    const ScopedLock sl(lock);
+    pending.clear();
+    pendingKeys.clear();
+
+    for (auto &inputs : cells) {
+      auto key = RenderManifest::computeKey(inputs);
+      if (entries.find(key) != entries.end() || pendingKeys.count(key) > 0)
+        continue;
+
+      pending.push_back({key, inputs});
+      pendingKeys.insert(key);
+    }
+  }
+
+  notify();
+}
+
+PreviewRenderCache::Clip PreviewRenderCache::find(const String &key) {
+  const ScopedLock sl(lock);
+
+  auto it = entries.find(key);
+  if (it == entries.end())
+    return nullptr;
+
+  it->second.lastUsed = ++useCounter;
+  return it->second.audio;
+}
+
+void PreviewRenderCache::setMemoryLimit(int64 bytes) {
+  const ScopedLock sl(lock);
+  memoryLimitBytes = bytes;
+  evictToFit(0);
+}
+
+int64 PreviewRenderCache::getCachedBytes() const {
+  const ScopedLock sl(lock);
+  return cachedBytes;
+}
+
+//==============================================================================
+void PreviewRenderCache::run() {
+  while (!threadShouldExit()) {
+    Request request;
+    {
+      const ScopedLock sl(lock);
+      while (!pending.empty() &&
+             entries.find(pending.front().key) != entries.end()) {
+        pendingKeys.erase(pending.front().key);
+        pending.pop_front();
+      }
+
+      // Left at the front of the queue while rendering: replacing the
+      // queue without this cell is what abandons it
+      if (!pending.empty())
+        request = pending.front();
+    }
+
+    if (request.key.isEmpty()) {
+      // Nothing wanted: don't hold on to a plugin instance while idle
+      plugin.reset();
+      pluginKey.clear();
+      wait(-1);
+      continue;
+    }
+
+    renderCell(request);
+
+    const ScopedLock sl(lock);
+    if (!pending.empty() && pending.front().key == request.key) {
+      pendingKeys.erase(request.key);
+      pending.pop_front();
+    }
+  }
+
+  plugin.reset();
+}
+
+bool PreviewRenderCache::renderCell(const Request &request) {
+  if (!waitUntilAllowed(request.key))
+    return false;
+
+  TRACE_SCOPE("Preview", "Preview render");
+  ScopedNoDenormals noDenormals;
+  if (!prepareInstance(request.inputs))
+    return false;
+
+  const auto &inputs = request.inputs;
+  auto midiSeq = MidiPlayer::loadMidiFile(inputs.midiFile, inputs.bpm);
+  midiSeq = MidiPlayer::applyTransformations(midiSeq, inputs.pitchOffset,
+                                             inputs.velocityMultiplier);
+
+  const double midiSeconds = MidiPlayer::getSequenceDuration(midiSeq);
+  const int latencySamples = jmax(0, plugin->getLatencySamples());
+  const int totalSamples =
+      static_cast<int>((midiSeconds + tailSeconds) * sampleRate);
+  const int numChannels = jmax(2, plugin->getTotalNumOutputChannels());
+
+  AudioBuffer<float> rendered(numChannels, totalSamples + latencySamples);
+  const bool finished = ParallelBatchRenderer::renderSequence(
+      *plugin, midiSeq, sampleRate, inputs.bpm, false, rendered,
+      [this, &request] { return waitUntilAllowed(request.key); });
+
+  if (!finished)
+    return false;
+
+  // Drop the silent part of the tail, but never cut into the MIDI
+  const float threshold = Decibels::decibelsToGain(silenceThresholdDb);
+  int length = static_cast<int>(midiSeconds * sampleRate);
+  for (int pos = totalSamples; pos > length;) {
+    const int blockStart =
+        jmax(length, pos - ParallelBatchRenderer::renderBlockSize);
+    float peak = 0.0f;
+    for (int ch = 0; ch < numChannels; ++ch)
+      peak = jmax(peak, rendered.getMagnitude(ch, latencySamples + blockStart,
+                                              pos - blockStart));
+    if (peak > threshold) {
+      length = pos;
+      break;
+    }
+    pos = blockStart;
+  }
+  length = jmax(1, length);
+
+  // Stereo, latency compensated, with the row volume applied
+  auto audio = std::make_shared<AudioBuffer<float>>(2, length);
+  const float gain = inputs.volumeDb > -96.0f
+                         ? Decibels::decibelsToGain(inputs.volumeDb)
+                         : 0.0f;
+  for (int ch = 0; ch < 2; ++ch)
+    audio->copyFrom(ch, 0, rendered, jmin(ch, numChannels - 1),
+                    latencySamples, length, gain);
+
+  store(request.key, std::move(audio));
+  return true;
+}
+
+bool PreviewRenderCache::prepareInstance(
+    const RenderManifest::JobInputs &inputs) {
+  const String key =
+      inputs.pluginDesc.createIdentifierString() + "/" +
+      String::toHexString(static_cast<int64>(inputs.pluginStateHash));
+
+  if (plugin != nullptr && key == pluginKey) {
+    plugin->reset(); // Drop voices and tails left by the previous cell
+    return true;
+  }
+
+  plugin.reset();
+  pluginKey.clear();
+
+  String errorMessage;
+  ayra::PluginDescriptionAndPreference descPref;
+  descPref.pluginDescription = inputs.pluginDesc;
+
+  plugin = pluginsManager.createPluginInstance(
+      descPref, sampleRate, ParallelBatchRenderer::renderBlockSize,
+      errorMessage);
+
+  if (plugin == nullptr) {
+    DBG("Preview render: failed to load plugin: " + errorMessage);
+    return false;
+  }
+
+  if (inputs.pluginState.getSize() > 0)
+    plugin->setStateInformation(inputs.pluginState.getData(),
+                                static_cast<int>(inputs.pluginState.getSize()));
+
+  plugin->setNonRealtime(true);
+  plugin->prepareToPlay(sampleRate, ParallelBatchRenderer::renderBlockSize);
+  pluginKey = key;
+  return true;
+}
+
+bool PreviewRenderCache::waitUntilAllowed(const String &key) {
+  for (;;) {
+    if (threadShouldExit())
+      return false;
+
+    {
+      const ScopedLock sl(lock);
+      if (pendingKeys.count(key) == 0)
+        return false; // No longer wanted
+    }
+
+    const bool busy = ParallelBatchRenderer::isAnyRenderActive() ||
+                      (shouldYield != nullptr && shouldYield());
+    if (!busy)
+      return true;
+
+    wait(yieldPollMs);
+  }
+}
+
+//==============================================================================
+void PreviewRenderCache::store(const String &key, Clip audio) {
+  const int64 bytes = static_cast<int64>(audio->getNumChannels()) *
+                      audio->getNumSamples() *
+                      static_cast<int64>(sizeof(float));
+
+  const ScopedLock sl(lock);
+  if (bytes > memoryLimitBytes)
+    return;
+
+  evictToFit(bytes);
+  entries[key] = {std::move(audio), ++useCounter};
+  cachedBytes += bytes;
+}
+
+void PreviewRenderCache::evictToFit(int64 bytesNeeded) {
+  while (!entries.empty() && cachedBytes + bytesNeeded > memoryLimitBytes) {
+    auto oldest = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+      if (it->second.lastUsed < oldest->second.lastUsed)
+        oldest = it;
+
+    auto &audio = *oldest->second.audio;
+    cachedBytes -= static_cast<int64>(audio.getNumChannels()) *
+                   audio.getNumSamples() * static_cast<int64>(sizeof(float));
+    entries.erase(oldest);
+  }
+}
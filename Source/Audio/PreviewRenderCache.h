@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    PreviewRenderCache.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Speculative offline renders of the cells the user is likely to audition
+    next, kept in RAM so triggering them costs no synthesis. Rendering runs
+    on a background thread with its own plugin instance and pauses between
+    blocks whenever a batch render is running or shouldYield() asks for it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Rendering/RenderManifest.h"
+#include <JuceHeader.h>
+#include <deque>
+#include <map>
+#include <set>
+
+//==============================================================================
+class PreviewRenderCache : private Thread {
+public:
+  using Clip = std::shared_ptr<const AudioBuffer<float>>;
+
+  static constexpr double sampleRate = 44100.0;
+
+  //==============================================================================
+  explicit PreviewRenderCache(ayra::PluginsManager &pm);
+  ~PreviewRenderCache() override;
+
+  //==============================================================================
+  // Replace the queue of cells to render, most wanted first. Cells that are
+  // already cached are skipped; the cell being rendered is abandoned only if
+  // it is no longer wanted.
+  void setPendingCells(const std::vector<RenderManifest::JobInputs> &cells);
+
+  // Cached audio for a cell key (see RenderManifest::computeKey), or nullptr
+  Clip find(const String &key);
+
+  void setMemoryLimit(int64 bytes);
+  int64 getCachedBytes() const;
+
+  // Polled from the render thread between blocks
+  std::function<bool()> shouldYield;
+
+private:
+  //==============================================================================
+  struct Entry {
+    Clip audio;
+    uint32 lastUsed = 0;
+  };
+
+  struct Request {
+    String key;
+    RenderManifest::JobInputs inputs;
+  };
+
+  ayra::PluginsManager &pluginsManager;
+
+  mutable CriticalSection lock;
+  std::map<String, Entry> entries;
+  int64 cachedBytes = 0;
+  int64 memoryLimitBytes = 0;
+  uint32 useCounter = 0;
+
+  std::deque<Request> pending;
+  std::set<String> pendingKeys;
+
+  // Render thread only: the instance is kept while consecutive cells use
+  // the same plugin and state
+  std::unique_ptr<AudioPluginInstance> plugin;
+  String pluginKey;
+
+  //==============================================================================
+  void run() override;
+  bool renderCell(const Request &request);
+  bool prepareInstance(const RenderManifest::JobInputs &inputs);
+  bool waitUntilAllowed(const String &key);
+
+  void store(const String &key, Clip audio);
+  void evictToFit(int64 bytesNeeded);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PreviewRenderCache)
+};
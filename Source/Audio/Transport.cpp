@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    Transport.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "Transport.h"
+
+//==============================================================================
+void Transport::setBpm(double newBpm) {
+  if (newBpm > 0.0)
+    requestedBpm.store(newBpm);
+}
+
+void Transport::play() { requestedPlaying.store(true); }
+
+void Transport::stop() { requestedPlaying.store(false); }
+
+void Transport::locate(double ppq) {
+  locateTarget.store(jmax(0.0, ppq));
+  locatePending.store(true);
+}
+
+void Transport::setLoop(bool enabled, double startPpq, double endPpq) {
+  requestedLoopStart.store(startPpq);
+  requestedLoopEnd.store(endPpq);
+  requestedLooping.store(enabled && endPpq > startPpq);
+}
+
+//==============================================================================
+const Transport::State &Transport::beginBlock() {
+  current.bpm = requestedBpm.load();
+  current.playing = requestedPlaying.load();
+  current.looping = requestedLooping.load();
+  current.loopStartPpq = requestedLoopStart.load();
+  current.loopEndPpq = requestedLoopEnd.load();
+
+  if (locatePending.exchange(false))
+    current.ppqPosition = locateTarget.load();
+
+  return current;
+}
+
+void Transport::endBlock(int numSamples, double sampleRate) {
+  if (current.playing && sampleRate > 0.0) {
+    current.ppqPosition += numSamples * current.bpm / (60.0 * sampleRate);
+
+    if (current.looping && current.ppqPosition >= current.loopEndPpq) {
+      const double loopLength = current.loopEndPpq - current.loopStartPpq;
+      current.ppqPosition =
+          current.loopStartPpq +
+          std::fmod(current.ppqPosition - current.loopStartPpq, loopLength);
+    }
+  }
+
+  publish();
+}
+
+void Transport::fillPositionInfo(AudioPlayHead::PositionInfo &info,
+                                 double sampleRate) const {
+  info.setBpm(current.bpm);
+  info.setTimeSignature(AudioPlayHead::TimeSignature{4, 4});
+
+  info.setPpqPosition(current.ppqPosition);
+  info.setPpqPositionOfLastBarStart(current.getBarStartPpq());
+
+  // Time follows the musical position, so both agree after a loop or locate
+  const double seconds = current.ppqPosition * 60.0 / current.bpm;
+  info.setTimeInSeconds(seconds);
+  info.setTimeInSamples(static_cast<int64>(seconds * sampleRate));
+
+  info.setIsPlaying(current.playing);
+  info.setIsLooping(current.looping);
+  if (current.looping)
+    info.setLoopPoints(
+        AudioPlayHead::LoopPoints{current.loopStartPpq, current.loopEndPpq});
+  info.setIsRecording(false);
+}
+
+//==============================================================================
+void Transport::publish() {
+  const auto seq = sequence.load(std::memory_order_relaxed);
+  sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  publishedPpq.store(current.ppqPosition, std::memory_order_relaxed);
+  publishedBpm.store(current.bpm, std::memory_order_relaxed);
+  publishedPlaying.store(current.playing, std::memory_order_relaxed);
+  publishedLooping.store(current.looping, std::memory_order_relaxed);
+  publishedLoopStart.store(current.loopStartPpq, std::memory_order_relaxed);
+  publishedLoopEnd.store(current.loopEndPpq, std::memory_order_relaxed);
+
+  sequence.store(seq + 2, std::memory_order_release);
+}
+
+Transport::State Transport::getSnapshot() const {
+  State state;
+
+  for (;;) {
+    const auto before = sequence.load(std::memory_order_acquire);
+    if ((before & 1) != 0)
+      continue; // The audio thread is writing; it only takes a moment
+
+    state.ppqPosition = publishedPpq.load(std::memory_order_relaxed);
+    state.bpm = publishedBpm.load(std::memory_order_relaxed);
+    state.playing = publishedPlaying.load(std::memory_order_relaxed);
+    state.looping = publishedLooping.load(std::memory_order_relaxed);
+    state.loopStartPpq = publishedLoopStart.load(std::memory_order_relaxed);
+    state.loopEndPpq = publishedLoopEnd.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) == before)
+      return state;
+  }
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    Transport.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Musical position of the live preview, owned by the audio callback and
+    advanced by sample count each block. Control requests (play, stop,
+    locate, loop, tempo) can come from any thread and take effect at the
+    start of the next block. The position is published once per block as a
+    consistent snapshot for the UI.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class Transport {
+public:
+  //==============================================================================
+  struct State {
+    double ppqPosition = 0.0;
+    double bpm = 120.0;
+    bool playing = false;
+    bool looping = false;
+    double loopStartPpq = 0.0;
+    double loopEndPpq = 0.0;
+
+    double getBarStartPpq() const {
+      return std::floor(ppqPosition / 4.0) * 4.0; // 4/4
+    }
+  };
+
+  //==============================================================================
+  // Control, from any thread
+  void setBpm(double newBpm);
+  void play();
+  void stop();
+  void locate(double ppq);
+  void setLoop(bool enabled, double startPpq, double endPpq);
+
+  //==============================================================================
+  // Audio thread. beginBlock() applies pending requests; the state it
+  // returns stays valid for the whole block, so every plugin in the graph
+  // sees the same position. endBlock() advances and publishes.
+  const State &beginBlock();
+  void endBlock(int numSamples, double sampleRate);
+  const State &getBlockState() const { return current; }
+
+  void fillPositionInfo(AudioPlayHead::PositionInfo &info,
+                        double sampleRate) const;
+
+  //==============================================================================
+  // Any thread: the position published by the last block
+  State getSnapshot() const;
+
+private:
+  //==============================================================================
+  State current; // Audio thread only
+
+  // Pending control requests
+  std::atomic<double> requestedBpm{120.0};
+  std::atomic<bool> requestedPlaying{false};
+  std::atomic<bool> locatePending{false};
+  std::atomic<double> locateTarget{0.0};
+  std::atomic<bool> requestedLooping{false};
+  std::atomic<double> requestedLoopStart{0.0};
+  std::atomic<double> requestedLoopEnd{0.0};
+
+  // Published state, guarded by a sequence counter (odd while writing)
+  std::atomic<uint32> sequence{0};
+  std::atomic<double> publishedPpq{0.0};
+  std::atomic<double> publishedBpm{120.0};
+  std::atomic<bool> publishedPlaying{false};
+  std::atomic<bool> publishedLooping{false};
+  std::atomic<double> publishedLoopStart{0.0};
+  std::atomic<double> publishedLoopEnd{0.0};
+
+  void publish();
+};
@@ -80,22 +80,8 @@ ConfigurationPanel::ConfigurationPanel() {
   progressType.setSelectedId(static_cast<int>(PlayheadMode::Independent),
                              dontSendNotification);
   progressType.onChange = [this] {
-    auto mode = getPlayheadMode();
-
-    // Handle mode change
-    if (mode == PlayheadMode::Independent) {
-      startIndependentPlayhead();
-    } else {
-      stopIndependentPlayhead();
-      if (mode == PlayheadMode::NoMoving) {
-        // Reset to 0 when switching to NoMoving
-        independentPpqPosition = 0.0;
-        progressPlayhead.setValue(0.0, dontSendNotification);
-      }
-    }
-
     if (onPlayheadModeChanged)
-      onPlayheadModeChanged(mode);
+      onPlayheadModeChanged(getPlayheadMode());
   };
 
   // Progress playhead slider (read-only display)
@@ -106,8 +92,9 @@ ConfigurationPanel::ConfigurationPanel() {
   progressPlayhead.setInterceptsMouseClicks(false, false);
   progressPlayhead.setTextBoxStyle(Slider::TextBoxLeft, true, 80, 20);
 
-  // Start independent playhead by default
-  startIndependentPlayhead();
+  // The position itself is advanced by the audio callback; this only
+  // refreshes the display
+  startTimerHz(30);
 
   // Folder selection
   selectFolderButton.onClick = [this] {
@@ -186,42 +173,8 @@ void ConfigurationPanel::resized() {
 
 //==============================================================================
 void ConfigurationPanel::timerCallback() {
-  // Independent mode: cycle playhead from 0 to 16 bars
-  double currentTime = Time::getMillisecondCounterHiRes() / 1000.0;
-
-  if (lastTimerCallbackTime > 0.0) {
-    double deltaTime = currentTime - lastTimerCallbackTime;
-    double bpm = bpmSlider.getValue();
-    double beatsPerSecond = bpm / 60.0;
-    double ppqIncrement = deltaTime * beatsPerSecond;
-
-    independentPpqPosition += ppqIncrement;
-
-    // Cycle back to 0 after 16 bars (64 beats in 4/4)
-    if (independentPpqPosition >= 64.0) {
-      independentPpqPosition = 0.0;
-    }
-
-    // Update slider display (in bars, 0-16)
-    progressPlayhead.setValue(independentPpqPosition / 4.0,
-                              dontSendNotification);
-
-    // Sync position to PluginHost
-    if (onPlayheadPositionChanged)
-      onPlayheadPositionChanged(independentPpqPosition);
-  }
-
-  lastTimerCallbackTime = currentTime;
-}
-
-void ConfigurationPanel::startIndependentPlayhead() {
-  lastTimerCallbackTime = Time::getMillisecondCounterHiRes() / 1000.0;
-  startTimerHz(60); // 60 FPS update
-}
-
-void ConfigurationPanel::stopIndependentPlayhead() {
-  stopTimer();
-  lastTimerCallbackTime = 0.0;
+  if (getPlayheadPosition)
+    setPlayheadPosition(getPlayheadPosition());
 }
 
 //==============================================================================
@@ -255,6 +208,5 @@ void ConfigurationPanel::reset() {
   variationsSlider.setValue(10, dontSendNotification);
   bpmSlider.setValue(120.0, dontSendNotification);
   folderPathLabel.setText("No folder selected", dontSendNotification);
-  independentPpqPosition = 0.0;
   progressPlayhead.setValue(0.0, dontSendNotification);
 }
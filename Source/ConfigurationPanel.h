@@ -64,23 +64,14 @@ public:
   std::function<void(const File &midiFolder)> onMidiFolderSelected;
   std::function<void()> onMidiPanic;
   std::function<void(PlayheadMode mode)> onPlayheadModeChanged;
-  std::function<void(double ppqPosition)>
-      onPlayheadPositionChanged; // Sync independent position
+  // Polled to display the preview transport position (in PPQ)
+  std::function<double()> getPlayheadPosition;
 
   void reset();
 
-  // Start/stop independent playhead cycling
-  void startIndependentPlayhead();
-  void stopIndependentPlayhead();
-  bool isIndependentPlayheadRunning() const { return isTimerRunning(); }
-
 private:
   //==============================================================================
-  void timerCallback() override; // For independent mode cycling
-
-  // Independent playhead state
-  double independentPpqPosition = 0.0;
-  double lastTimerCallbackTime = 0.0;
+  void timerCallback() override; // Refreshes the playhead display
 
   Label variationsLabel{{}, "Variations:"};
   Slider variationsSlider;
@@ -12,10 +12,37 @@
 
 #include "MainComponent.h"
 #include "OSC/OSCSettingsComponent.h"
+#include "Rendering/ContentHash.h"
+#include "TraceRecorder.h"
 #include <atomic>
+#include <set>
 #include <thread>
 #include <vector>
 
+//==============================================================================
+// "42% - 3/120 jobs - ETA 12:05" for the render progress dialog
+static String formatRenderStatus(const ParallelBatchRenderer &renderer) {
+  String status;
+  status << roundToInt(renderer.getProgress() * 100.0f) << "% - "
+         << renderer.getCompletedJobs() << "/" << renderer.getTotalJobs()
+         << " jobs";
+
+  if (renderer.isPaused())
+    return status + " - Paused";
+
+  auto eta = roundToInt(renderer.getEstimatedSecondsRemaining());
+  if (eta > 0) {
+    status << " - ETA ";
+    if (eta >= 3600)
+      status << eta / 3600 << ":" << String((eta / 60) % 60).paddedLeft('0', 2);
+    else
+      status << eta / 60;
+    status << ":" << String(eta % 60).paddedLeft('0', 2);
+  }
+
+  return status;
+}
+
 //==============================================================================
 MainComponent::MainComponent() {
   // Initialize audio device
@@ -43,19 +70,18 @@ MainComponent::MainComponent() {
 
   // Setup configuration panel callbacks
   configPanel.onVariationsChanged = [this](int num) {
-    numVariations = num;
-    rebuildGrid();
+    applyNumVariations(num);
   };
 
-  configPanel.onBpmChanged = [this](double newBpm) {
-    bpm = newBpm;
-    // Update grid BPM immediately for playback
-    if (gridComponent != nullptr)
-      gridComponent->setBpm(bpm);
+  configPanel.onBpmChanged = [this](double newBpm) { applyBpm(newBpm); };
+
+  midiLibrary.setMinimumLength(16.0); // Leave out files shorter than 4 bars
+  midiLibrary.onFilesChanged = [this](const Array<File> &added,
+                                     const Array<File> &removed) {
+    applyMidiLibraryChanges(added, removed);
   };
 
   configPanel.onMidiFolderSelected = [this](const File &folder) {
-    filterShortMidiFiles(folder); // Remove MIDI files < 4 bars
     loadMidiFolder(folder);
   };
 
@@ -66,11 +92,11 @@ MainComponent::MainComponent() {
   renderButton.setEnabled(false);
   addAndMakeVisible(renderButton);
 
-  // Batch Normalization button - normalizes existing WAV files
+  // Batch Normalization button - normalizes existing renders
   batchNormalization.onClick = [this] {
     // Open folder chooser
     fileChooser = std::make_unique<FileChooser>(
-        "Select folder with WAV files to normalize",
+        "Select folder with rendered files to normalize",
         File::getSpecialLocation(File::userHomeDirectory), "");
 
     fileChooser->launchAsync(
@@ -79,6 +105,8 @@ MainComponent::MainComponent() {
         [this](const FileChooser &fc) {
           auto result = fc.getResult();
           if (result.exists() && result.isDirectory()) {
+            remoteRender = false;
+
             // Show progress window and start normalization
             renderProgress = 0.0;
             progressBar = std::make_unique<ProgressBar>(renderProgress);
@@ -117,6 +145,11 @@ MainComponent::MainComponent() {
   levelMeter.setMeterSource(pluginHost->getMeterSource());
   addAndMakeVisible(levelMeter);
 
+  cpuLoadLabel.setJustificationType(Justification::centred);
+  cpuLoadLabel.setFont(Font(12.0f));
+  addAndMakeVisible(cpuLoadLabel);
+  startTimerHz(4);
+
   addAndMakeVisible(masterVolume);
   masterVolume.setSliderStyle(Slider::Rotary);
   masterVolume.setRange(-96.0, 12.0, 0.1);
@@ -137,15 +170,26 @@ MainComponent::MainComponent() {
     pluginHost->setPlayheadMode(mode);
   };
 
-  // Sync independent playhead position to PluginHost
-  configPanel.onPlayheadPositionChanged = [this](double ppqPosition) {
-    pluginHost->setIndependentPlayheadPosition(ppqPosition);
+  // Display the position of the audio-clock transport
+  configPanel.getPlayheadPosition = [this] {
+    return pluginHost->getTransport().getSnapshot().ppqPosition;
   };
 
   // Set initial playhead mode
   pluginHost->setPlayheadMode(configPanel.getPlayheadMode());
 
-  // Setup OSC controller callbacks
+  // Setup OSC controller callbacks. Cues run on the OSC thread and go
+  // straight to the audio callback.
+  oscController.onCellCue = [this](int row, int column, double timeMs) {
+    return pluginHost->cueCell(row, column, timeMs);
+  };
+  oscController.onStopCue = [this](double timeMs) {
+    return pluginHost->cueStop(timeMs);
+  };
+  oscController.onCellCued = [this](int row, int column) {
+    if (gridComponent != nullptr)
+      gridComponent->notifyCellCued(row, column);
+  };
   oscController.onCellPlay = [this](int row, int column) {
     if (gridComponent != nullptr)
       gridComponent->triggerCellPlay(row, column);
@@ -171,10 +215,18 @@ MainComponent::MainComponent() {
   // Auto-connect OSC on default port
   oscController.connect(9000);
 
+  // Telemetry reports on whichever render pass is running
+  oscTelemetry = std::make_unique<OSCTelemetry>(*pluginHost);
+  oscTelemetry->getRenderer = [this] { return parallelRenderer.get(); };
+  setupRemoteControl();
+  setupAutosave();
+
   setSize(1480, 1000);
 }
 
 MainComponent::~MainComponent() {
+  stopTimer();
+
   // Disconnect audio before destroying PluginHost
   deviceManager.removeAudioCallback(&audioSourcePlayer);
   audioSourcePlayer.setSource(nullptr);
@@ -192,6 +244,14 @@ MainComponent::~MainComponent() {
 }
 
 //==============================================================================
+void MainComponent::timerCallback() {
+  const int numLayers = pluginHost->getActivePlugins().size();
+  cpuLoadLabel.setText(
+      "CPU " + String(roundToInt(pluginHost->getCpuLoad() * 100.0)) + "%" +
+          (numLayers > 1 ? " - " + String(numLayers) + " layers" : String()),
+      dontSendNotification);
+}
+
 void MainComponent::paint(Graphics &g) {
   g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
 }
@@ -221,6 +281,7 @@ void MainComponent::resized() {
   // Level meter on right side (30px wide)
   auto rightArea = bounds.removeFromRight(200);
   masterVolume.setBounds(rightArea.removeFromBottom(200));
+  cpuLoadLabel.setBounds(rightArea.removeFromBottom(20));
   levelMeter.setBounds(rightArea);
 
   bounds.removeFromRight(5);
@@ -239,11 +300,10 @@ void MainComponent::runBatchNormalization(const File &outputDir) {
   else if (File("/opt/homebrew/bin/ffmpeg").existsAsFile())
     ffmpegPath = "/opt/homebrew/bin/ffmpeg";
   else {
-    AlertWindow::showMessageBoxAsync(
-        MessageBoxIconType::WarningIcon, "FFmpeg Not Found",
-        "FFmpeg is required for LUFS normalization.\n\n"
-        "Install with: brew install ffmpeg\n\n"
-        "Files were rendered but NOT normalized.");
+    notifyUser(MessageBoxIconType::WarningIcon, "FFmpeg Not Found",
+               "FFmpeg is required for LUFS normalization.\n\n"
+               "Install with: brew install ffmpeg\n\n"
+               "Files were rendered but NOT normalized.", false);
     return;
   }
 
@@ -253,17 +313,17 @@ void MainComponent::runBatchNormalization(const File &outputDir) {
 
   // Run everything else in background to not block UI
   std::thread([this, outputDir, ffmpegPath, targetLufs, progressPtr]() {
-    int sampleRate = 44100;
-    int bitDepth = 24;
-    String codec = (bitDepth == 24) ? "pcm_s24le" : "pcm_s16le";
     String loudnormFilter =
         "loudnorm=I=" + String(targetLufs, 1) + ":TP=-1.0:LRA=11";
 
-    // Find all WAV files recursively in output directory
+    // Find all rendered files recursively in output directory. Stems are
+    // left alone: normalizing them one by one would change how they sum.
     Array<File> wavFiles;
-    for (const auto &entry :
-         RangedDirectoryIterator(outputDir, true, "*.wav", File::findFiles)) {
-      wavFiles.add(entry.getFile());
+    for (const auto &entry : RangedDirectoryIterator(
+             outputDir, true, "*.wav;*.flac;*.aiff", File::findFiles)) {
+      if (entry.getFile().getParentDirectory().getFileName() !=
+          ParallelBatchRenderer::stemsFolderName)
+        wavFiles.add(entry.getFile());
     }
 
     int totalFiles = wavFiles.size();
@@ -289,16 +349,53 @@ void MainComponent::runBatchNormalization(const File &outputDir) {
     std::atomic<int> nextIndex{0};
 
     for (int t = 0; t < numThreads; ++t) {
-      threads.emplace_back([&, ffmpegPath, sampleRate, codec, loudnormFilter,
-                            progressPtr]() {
+      threads.emplace_back([&, ffmpegPath, loudnormFilter, progressPtr]() {
         while (true) {
           int idx = nextIndex.fetch_add(1);
           if (idx >= totalFiles)
             break;
 
+          TRACE_SCOPE("Normalize", "FFmpeg normalize");
           const File &wavFile = wavFiles.getReference(idx);
           File tempFile = wavFile.getSiblingFile(
-              wavFile.getFileNameWithoutExtension() + "_norm_temp.wav");
+              wavFile.getFileNameWithoutExtension() + "_norm_temp" +
+              wavFile.getFileExtension());
+
+          // Keep each file's own format: a render may deliver several
+          int sampleRate = 44100;
+          int bitDepth = 24;
+          AudioFormatManager formatManager;
+          formatManager.registerBasicFormats();
+          if (std::unique_ptr<AudioFormatReader> reader{
+                  formatManager.createReaderFor(wavFile)}) {
+            sampleRate = roundToInt(reader->sampleRate);
+            bitDepth = static_cast<int>(reader->bitsPerSample);
+          }
+
+          const String extension = wavFile.getFileExtension().toLowerCase();
+          StringArray codecArgs;
+          if (extension == ".flac") {
+            // FLAC stores 24-bit samples in ffmpeg's 32-bit format
+            codecArgs = {"-c:a", "flac", "-sample_fmt",
+                         bitDepth == 16 ? "s16" : "s32"};
+            if (bitDepth == 24) {
+              codecArgs.add("-bits_per_raw_sample");
+              codecArgs.add("24");
+            }
+          } else if (extension == ".aiff") {
+            codecArgs = {"-c:a", bitDepth == 16 ? "pcm_s16be" : "pcm_s24be"};
+          } else {
+            codecArgs = {"-c:a", bitDepth == 32   ? "pcm_f32le"
+                                 : bitDepth == 16 ? "pcm_s16le"
+                                                  : "pcm_s24le"};
+          }
+
+          // Dither when going back down to 16 bits, whatever the container
+          const String filter =
+              bitDepth == 16 ? loudnormFilter + ",aresample=" +
+                                   String(sampleRate) +
+                                   ":dither_method=triangular"
+                             : loudnormFilter;
 
           StringArray ffmpegArgs;
           ffmpegArgs.add(ffmpegPath);
@@ -309,11 +406,10 @@ void MainComponent::runBatchNormalization(const File &outputDir) {
           ffmpegArgs.add("-i");
           ffmpegArgs.add(wavFile.getFullPathName());
           ffmpegArgs.add("-af");
-          ffmpegArgs.add(loudnormFilter);
+          ffmpegArgs.add(filter);
           ffmpegArgs.add("-ar");
           ffmpegArgs.add(String(sampleRate));
-          ffmpegArgs.add("-c:a");
-          ffmpegArgs.add(codec);
+          ffmpegArgs.addArray(codecArgs);
           ffmpegArgs.add(tempFile.getFullPathName());
 
           ChildProcess ffmpeg;
@@ -391,136 +487,65 @@ void MainComponent::runBatchNormalization(const File &outputDir) {
       }
 
       if (failedCount > 0) {
-        AlertWindow::showMessageBoxAsync(
-            MessageBoxIconType::WarningIcon, "Normalization Partial",
-            "Normalized " + String(completedCount) + " files.\n" +
-                String(failedCount) + " files failed.");
+        notifyUser(MessageBoxIconType::WarningIcon, "Normalization Partial",
+                   "Normalized " + String(completedCount) + " files.\n" +
+                       String(failedCount) + " files failed.", false);
       } else {
-        AlertWindow::showMessageBoxAsync(
-            MessageBoxIconType::InfoIcon, "Batch Complete",
-            "All " + String(totalFiles) + " files rendered and normalized!");
+        notifyUser(MessageBoxIconType::InfoIcon, "Batch Complete",
+                   "All " + String(totalFiles) +
+                       " files rendered and normalized!");
       }
     });
   }).detach(); // Detach so UI doesn't block
 }
 
 //==============================================================================
-void MainComponent::filterShortMidiFiles(const File &folder) {
-  // Check if midicsv is installed
-  String midicsvPath = "midicsv";
-  if (File("/usr/local/bin/midicsv").existsAsFile())
-    midicsvPath = "/usr/local/bin/midicsv";
-  else if (File("/opt/homebrew/bin/midicsv").existsAsFile())
-    midicsvPath = "/opt/homebrew/bin/midicsv";
-  else {
-    // Check if midicsv is available at all
-    ChildProcess checkMidicsv;
-    if (!checkMidicsv.start("which midicsv")) {
-      AlertWindow::showMessageBoxAsync(
-          MessageBoxIconType::WarningIcon, "midicsv Not Found",
-          "midicsv is required to filter short MIDI files.\n\n"
-          "Install with: brew install midicsv\n\n"
-          "MIDI files will be loaded without filtering.");
-      return;
-    }
-    checkMidicsv.waitForProcessToFinish(5000);
-    if (checkMidicsv.getExitCode() != 0) {
-      AlertWindow::showMessageBoxAsync(
-          MessageBoxIconType::WarningIcon, "midicsv Not Found",
-          "midicsv is required to filter short MIDI files.\n\n"
-          "Install with: brew install midicsv\n\n"
-          "MIDI files will be loaded without filtering.");
-      return;
-    }
-  }
-
-  DBG("Using midicsv at: " + midicsvPath);
-
-  // Find all MIDI files
-  Array<File> filesToCheck;
-  for (const auto &entry : RangedDirectoryIterator(
-           folder, false, "*.mid;*.midi", File::findFiles)) {
-    filesToCheck.add(entry.getFile());
-  }
-
-  StringArray filesToDelete;
-
-  for (const auto &midiFile : filesToCheck) {
-    // Run midicsv on the file
-    StringArray midicsvArgs;
-    midicsvArgs.add(midicsvPath);
-    midicsvArgs.add(midiFile.getFullPathName());
-
-    ChildProcess midicsv;
-    if (midicsv.start(midicsvArgs)) {
-      String output = midicsv.readAllProcessOutput();
-      midicsv.waitForProcessToFinish(10000);
-
-      // Parse PPQ from Header line (6th field)
-      int ppq = 0;
-      int lastTick = 0;
-
-      StringArray lines = StringArray::fromLines(output);
-      for (const auto &line : lines) {
-        if (line.contains("Header")) {
-          // Format: track, time, Header, format, nTracks, division
-          StringArray parts = StringArray::fromTokens(line, ",", "");
-          if (parts.size() >= 6)
-            ppq = parts[5].trim().getIntValue();
-        }
+void MainComponent::loadMidiFolder(const File &folder) {
+  midiFolder = folder;
 
-        // Get last tick (second field of each line)
-        StringArray parts = StringArray::fromTokens(line, ",", "");
-        if (parts.size() >= 2) {
-          int tick = parts[1].trim().getIntValue();
-          if (tick > lastTick)
-            lastTick = tick;
-        }
-      }
+  // Starts from the persisted index (sorted); the background scan reports
+  // the differences through applyMidiLibraryChanges
+  midiFiles = midiLibrary.openFolder(folder);
 
-      // Check if duration is less than 4 bars (16 beats = ppq * 16)
-      if (ppq > 0 && lastTick > 0) {
-        int threshold = ppq * 16; // 4 bars in 4/4
-        if (lastTick < threshold) {
-          filesToDelete.add(midiFile.getFileName());
-          midiFile.deleteFile();
-          DBG("Deleted short MIDI: " + midiFile.getFileName() +
-              " (ticks: " + String(lastTick) + " < " + String(threshold) + ")");
-        }
-      }
-    }
-  }
+  DBG("Found " << midiFiles.size() << " indexed MIDI files");
 
-  // Show summary if files were deleted
-  if (!filesToDelete.isEmpty()) {
-    String message = "Removed " + String(filesToDelete.size()) +
-                     " MIDI file(s) shorter than 4 bars:\n\n";
-    for (int i = 0; i < jmin(10, filesToDelete.size()); ++i)
-      message += "• " + filesToDelete[i] + "\n";
-    if (filesToDelete.size() > 10)
-      message += "...and " + String(filesToDelete.size() - 10) + " more.";
-
-    AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon,
-                                     "MIDI Files Filtered", message);
-  }
+  // Swap the columns of an existing grid so the row plugins survive, even
+  // if the folder is (still) empty
+  if (gridComponent != nullptr)
+    updateGridColumns();
+  else
+    rebuildGrid();
 }
 
-void MainComponent::loadMidiFolder(const File &folder) {
-  midiFolder = folder;
-  midiFiles.clear();
+void MainComponent::applyMidiLibraryChanges(const Array<File> &added,
+                                            const Array<File> &removed) {
+  // A first scan can report thousands of files, so avoid per-file searches
+  std::set<String> removedPaths;
+  for (auto &file : removed)
+    removedPaths.insert(file.getFullPathName());
 
-  // Find all MIDI files
-  for (const auto &entry : RangedDirectoryIterator(
-           folder, false, "*.mid;*.midi", File::findFiles)) {
-    midiFiles.add(entry.getFile());
-  }
+  midiFiles.removeIf([&removedPaths](const File &file) {
+    return removedPaths.count(file.getFullPathName()) > 0;
+  });
 
-  // Sort by name
+  // Keep the list sorted by name, without duplicates
+  midiFiles.addArray(added);
   midiFiles.sort();
+  for (int i = midiFiles.size(); --i > 0;)
+    if (midiFiles.getReference(i) == midiFiles.getReference(i - 1))
+      midiFiles.remove(i);
 
-  DBG("Found " << midiFiles.size() << " MIDI files");
+  // Patch the existing grid so rows, plugins and column settings survive,
+  // even when every file is gone for a moment
+  if (gridComponent != nullptr)
+    updateGridColumns();
+  else
+    rebuildGrid();
+}
 
-  rebuildGrid();
+void MainComponent::updateGridColumns() {
+  gridComponent->setMidiFiles(midiFiles);
+  renderButton.setEnabled(!midiFiles.isEmpty());
 }
 
 void MainComponent::rebuildGrid() {
@@ -537,6 +562,12 @@ void MainComponent::rebuildGrid() {
   gridComponent->setMidiFiles(midiFiles);
   gridComponent->setNumVariations(numVariations);
   gridComponent->setBpm(bpm);
+  auto *userSettings = ayra::app_properties->getUserSettings();
+  gridComponent->setRenderedAudioFolder(
+      File(userSettings->getValue("lastRenderOutputDir")));
+  gridComponent->onCellRenderNow = [this](int row, int column) {
+    renderCellNow(row, column);
+  };
   gridComponent->rebuild(); // Build grid after all settings are applied
 
   addAndMakeVisible(*gridComponent);
@@ -546,6 +577,23 @@ void MainComponent::rebuildGrid() {
   resized();
 }
 
+void MainComponent::applyBpm(double newBpm) {
+  bpm = newBpm;
+  // Update grid BPM immediately for playback
+  if (gridComponent != nullptr)
+    gridComponent->setBpm(bpm);
+}
+
+void MainComponent::applyNumVariations(int num) {
+  numVariations = num;
+
+  // Add or remove rows at the end, keeping the loaded plugins
+  if (gridComponent != nullptr)
+    gridComponent->setNumVariations(numVariations);
+  else
+    rebuildGrid();
+}
+
 void MainComponent::startRender() {
   if (gridComponent == nullptr || midiFiles.isEmpty())
     return;
@@ -554,29 +602,66 @@ void MainComponent::startRender() {
   FileChooser chooser("Select Output Directory",
                       File::getSpecialLocation(File::userDesktopDirectory));
 
-  if (chooser.browseForDirectory()) {
-    currentOutputDir = chooser.getResult();
+  if (chooser.browseForDirectory())
+    beginRender(chooser.getResult(), false);
+}
 
-    // Build render queue
-    renderQueue.clear();
-    initialBpm = bpm; // Save current state
+void MainComponent::beginRender(const File &outputDir, bool remote) {
+  currentOutputDir = outputDir;
+  remoteRender = remote;
+  renderPaused = false;
 
-    // Pass 1: Original BPM
-    renderQueue.push_back({bpm, ""});
+  // Build render queue
+  renderQueue.clear();
+  initialBpm = bpm; // Save current state
 
-    // Pass 2: Variation 1
-    if (configPanel.isVariation1Enabled()) {
-      renderQueue.push_back({configPanel.getVariation1Bpm(), " [Var1]"});
-    }
+  // Pass 1: Original BPM
+  renderQueue.push_back({bpm, ""});
 
-    // Pass 3: Variation 2
-    if (configPanel.isVariation2Enabled()) {
-      renderQueue.push_back({configPanel.getVariation2Bpm(), " [Var2]"});
-    }
+  // Pass 2: Variation 1
+  if (configPanel.isVariation1Enabled()) {
+    renderQueue.push_back({configPanel.getVariation1Bpm(), " [Var1]"});
+  }
 
-    // Start processing
-    processNextRenderPass(currentOutputDir);
+  // Pass 3: Variation 2
+  if (configPanel.isVariation2Enabled()) {
+    renderQueue.push_back({configPanel.getVariation2Bpm(), " [Var2]"});
   }
+
+  // Start processing
+  processNextRenderPass(currentOutputDir);
+}
+
+void MainComponent::cancelRender() {
+  renderQueue.clear();
+  renderPaused = false;
+
+  if (parallelRenderer != nullptr) {
+    parallelRenderer->cancelRendering();
+    parallelRenderer.reset();
+  }
+
+  if (progressWindow) {
+    progressWindow->setVisible(false);
+    progressWindow.reset();
+  }
+
+  // Restore state
+  bpm = initialBpm;
+  pluginHost->setBpm(bpm);
+  configPanel.setBpm(bpm);
+}
+
+bool MainComponent::isRenderInProgress() const {
+  return parallelRenderer != nullptr || !renderQueue.empty();
+}
+
+void MainComponent::notifyUser(MessageBoxIconType icon, const String &title,
+                               const String &message, bool succeeded) {
+  if (remoteRender)
+    oscTelemetry->sendAck("/render", succeeded, title + ": " + message);
+  else
+    AlertWindow::showMessageBoxAsync(icon, title, message);
 }
 
 void MainComponent::processNextRenderPass(const File &outputDir) {
@@ -587,6 +672,12 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
     pluginHost->setBpm(bpm);
     configPanel.setBpm(bpm);
 
+    // Finished cells can now be previewed from their renders
+    ayra::app_properties->getUserSettings()->setValue(
+        "lastRenderOutputDir", outputDir.getFullPathName());
+    if (gridComponent != nullptr)
+      gridComponent->setRenderedAudioFolder(outputDir);
+
     // Run batch normalization if enabled
     bool normalizeEnabled = configPanel.isNormalizationEnabled();
 
@@ -631,7 +722,8 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
         message = "All files have been rendered successfully!";
       }
 
-      AlertWindow::showMessageBoxAsync(icon, title, message);
+      notifyUser(icon, title, message,
+                 icon != MessageBoxIconType::WarningIcon);
     });
     return;
   }
@@ -651,6 +743,9 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
   ParallelBatchRenderer::RenderSettings settings;
   settings.sampleRate = 44100.0;
   settings.bitDepth = 24;
+  settings.outputFormats = ParallelBatchRenderer::parseOutputFormats(
+      ayra::app_properties->getUserSettings()->getValue("renderOutputFormats",
+                                                        "44.1k/24"));
   settings.bpm = bpm;
   settings.silenceThresholdDb = -50.0f;
   settings.masterGainDb = static_cast<float>(masterVolume.getValue());
@@ -658,20 +753,59 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
   settings.seamlessLoop = configPanel.isSeamlessLoopEnabled();
   settings.normalize = configPanel.isNormalizationEnabled();
   settings.normalizationLufs = configPanel.getNormalizationHeadroom();
+  settings.memoryBudgetMB =
+      ayra::app_properties->getUserSettings()->getIntValue(
+          "renderMemoryBudgetMB", 0);
+  settings.preferDoublePrecision =
+      ayra::app_properties->getUserSettings()->getBoolValue(
+          "renderDoublePrecision", false);
+  settings.writeStems = ayra::app_properties->getUserSettings()->getBoolValue(
+      "renderStems", false);
+  settings.skipEmptyStems =
+      ayra::app_properties->getUserSettings()->getBoolValue(
+          "renderSkipEmptyStems", true);
+  settings.flacCompression =
+      ayra::app_properties->getUserSettings()->getIntValue(
+          "renderFlacCompression", 5);
+  settings.maxWorkers = ayra::app_properties->getUserSettings()->getIntValue(
+      "renderMaxWorkers", 0);
+  settings.workerCpuSet = ayra::app_properties->getUserSettings()->getValue(
+      "renderWorkerCpuSet", {});
+  settings.workerNiceLevel =
+      ayra::app_properties->getUserSettings()->getIntValue(
+          "renderWorkerNiceLevel", 0);
+  settings.workerLowPriority =
+      ayra::app_properties->getUserSettings()->getBoolValue(
+          "renderWorkerLowPriority", false);
 
   parallelRenderer = std::make_unique<ParallelBatchRenderer>(
       pluginsManager, settings, outputDir);
+  oscTelemetry->beginRenderPass();
+
+  // Each row's state is read and hashed once, not once per column
+  std::vector<MidiGridComponent::RowData> rows;
+  std::vector<uint64> rowStateHashes;
+  for (int row = 0; row < numVariations; ++row) {
+    rows.push_back(gridComponent->getRowData(row));
+    rowStateHashes.push_back(
+        ContentHash().add(rows.back().pluginState).getValue());
+  }
 
   // Add all render jobs
   for (int col = 0; col < midiFiles.size(); ++col) {
     auto &midiFile = midiFiles.getReference(col);
     auto columnSettings = gridComponent->getColumnSettings(col);
 
+    MidiLibraryIndex::FileInfo fileInfo;
+    const double lengthBeats = midiLibrary.getFileInfo(midiFile, fileInfo)
+                                   ? fileInfo.lengthBeats
+                                   : 0.0;
+
     for (int row = 0; row < numVariations; ++row) {
       if (!gridComponent->isCellRenderizable(row, col))
         continue;
 
-      auto rowData = gridComponent->getRowData(row);
+      const auto &rowData = rows[static_cast<size_t>(row)];
 
       if (rowData.pluginDescription.name.isEmpty())
         continue; // Skip rows without plugins
@@ -683,11 +817,13 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
       job.variationName = rowData.name;
       job.pluginDesc = rowData.pluginDescription;
       job.pluginState = rowData.pluginState;
+      job.pluginStateHash = rowStateHashes[static_cast<size_t>(row)];
       job.pitchOffset = columnSettings.pitchOffset;
       job.velocityMultiplier = columnSettings.velocityMultiplier;
       job.volumeDb = rowData.volumeDb;
       job.bpm =
           bpm; // BPM for this job (variation BPM for tempo-synced plugins)
+      job.midiLengthBeats = lengthBeats;
 
       // File naming: add [Loop] or [Trail] suffix based on mode
       String modeSuffix = settings.loop ? " [Loop]" : " [Trail]";
@@ -707,9 +843,10 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
   }
 
   if (parallelRenderer->getTotalJobs() == 0) {
-    AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon,
-                                     "Nothing to Render",
-                                     "No items selected for rendering.");
+    parallelRenderer.reset();
+    renderQueue.clear();
+    notifyUser(MessageBoxIconType::InfoIcon, "Nothing to Render",
+               "No items selected for rendering.", false);
     return;
   }
 
@@ -717,13 +854,32 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
   parallelRenderer->onProgress = [this](float progress) {
     MessageManager::callAsync([this, progress] {
       renderProgress = progress;
-      // Repaint or update needed? ProgressBar pulls from renderProgress
-      // double variable automatically if setup correctly
+      // ProgressBar pulls from renderProgress; the text adds the ETA
+      if (progressBar != nullptr && parallelRenderer != nullptr)
+        progressBar->setTextToDisplay(formatRenderStatus(*parallelRenderer));
     });
   };
 
+  // Prioritized cells can be auditioned before the batch finishes
+  parallelRenderer->onPriorityJobDone = [this](int row,
+                                                const File &midiFile) {
+    if (gridComponent != nullptr)
+      gridComponent->setRenderedAudioFolder(currentOutputDir);
+
+    // Reported at the cell's current column; the library may have changed
+    const int column = midiFiles.indexOf(midiFile);
+    oscTelemetry->sendAck("/render/priority", true,
+                          String(row) + "/" +
+                              (column >= 0 ? String(column)
+                                           : midiFile.getFileName()) +
+                              " done");
+  };
+
   parallelRenderer->onComplete = [this] {
     MessageManager::callAsync([this] {
+      if (parallelRenderer == nullptr)
+        return; // Cancelled
+
       parallelRenderer.reset(); // Clean up current renderer
 
       // Continue with next render pass (if any)
@@ -737,24 +893,57 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
         progressWindow->setVisible(false);
         progressWindow.reset();
       }
-      AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
-                                       "Rendering Error", error);
+      notifyUser(MessageBoxIconType::WarningIcon, "Rendering Error", error,
+                 false);
       // Don't reset renderer immediately so user can retry or check logs?
       // For now reset it.
       parallelRenderer.reset();
+      renderQueue.clear(); // The remaining passes are dropped
     });
   };
 
+  // Remote renders report over OSC instead
+  if (remoteRender) {
+    parallelRenderer->startRendering(renderPaused);
+    return;
+  }
+
   // Show progress window
   renderProgress = 0.0;
   progressBar = std::make_unique<ProgressBar>(renderProgress);
 
   // Create a custom content component to hold the progress bar
   auto *content = new Component();
-  content->setSize(400, 60);
+  content->setSize(400, 130);
   content->addAndMakeVisible(progressBar.get());
   progressBar->setBounds(20, 20, 360, 20);
 
+  // Throttle, so a long batch can run at reduced load during the day and
+  // at full speed overnight
+  const int numCpus = SystemStats::getNumCpus();
+  workersSlider = std::make_unique<Slider>(Slider::LinearHorizontal,
+                                           Slider::TextBoxRight);
+  workersSlider->setTextBoxStyle(Slider::TextBoxRight, true, 150, 20);
+  workersSlider->textFromValueFunction = [numCpus](double value) {
+    return String(roundToInt(value)) + " workers (" +
+           String(roundToInt(100.0 * value / numCpus)) + "% CPU)";
+  };
+  workersSlider->setRange(1.0, numCpus, 1.0);
+  workersSlider->setValue(parallelRenderer->getMaxWorkers(),
+                          dontSendNotification);
+  workersSlider->updateText();
+  workersSlider->onValueChange = [this] {
+    setRenderWorkers(roundToInt(workersSlider->getValue()));
+  };
+  content->addAndMakeVisible(workersSlider.get());
+  workersSlider->setBounds(20, 55, 360, 24);
+
+  pauseButton = std::make_unique<TextButton>(renderPaused ? "Resume"
+                                                          : "Pause");
+  pauseButton->onClick = [this] { setRenderPaused(!renderPaused); };
+  content->addAndMakeVisible(pauseButton.get());
+  pauseButton->setBounds(150, 92, 100, 24);
+
   DialogWindow::LaunchOptions o;
   o.content.setOwned(content);
   o.dialogTitle = "Rendering Parallel";
@@ -768,7 +957,48 @@ void MainComponent::processNextRenderPass(const File &outputDir) {
   progressWindow.reset(o.create());
   progressWindow->setVisible(true);
 
-  parallelRenderer->startRendering();
+  parallelRenderer->startRendering(renderPaused);
+}
+
+void MainComponent::setRenderPaused(bool shouldPause) {
+  renderPaused = shouldPause;
+
+  if (parallelRenderer != nullptr) {
+    if (shouldPause)
+      parallelRenderer->pauseRendering();
+    else
+      parallelRenderer->resumeRendering();
+  }
+
+  if (pauseButton != nullptr)
+    pauseButton->setButtonText(shouldPause ? "Resume" : "Pause");
+}
+
+void MainComponent::setRenderWorkers(int maxWorkers) {
+  const int numCpus = SystemStats::getNumCpus();
+  maxWorkers = maxWorkers <= 0 ? numCpus : jmin(maxWorkers, numCpus);
+
+  if (parallelRenderer != nullptr)
+    parallelRenderer->setMaxWorkers(maxWorkers);
+  if (workersSlider != nullptr)
+    workersSlider->setValue(maxWorkers, dontSendNotification);
+
+  // Saved as 0 when unthrottled, so a machine with more cores uses them all
+  ayra::app_properties->getUserSettings()->setValue(
+      "renderMaxWorkers", maxWorkers < numCpus ? maxWorkers : 0);
+}
+
+void MainComponent::renderCellNow(int row, int column) {
+  String problem;
+  if (parallelRenderer == nullptr)
+    problem = "Cells can be moved ahead only while a batch is rendering.";
+  else if (!parallelRenderer->prioritizeJob(row, midiFiles[column]))
+    problem = "This cell is not waiting in the current batch: it is "
+              "rendering, already done, or not selected for rendering.";
+
+  if (problem.isNotEmpty())
+    AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon,
+                                     "Render Now", problem);
 }
 
 void MainComponent::showAudioSettings() {
@@ -812,9 +1042,110 @@ void MainComponent::showPluginList() {
   o.launchAsync();
 }
 
+//==============================================================================
+// Batch and project control over OSC. Each command is answered on the
+// telemetry targets with /fpc/ack; nothing here opens a dialog.
+void MainComponent::setupRemoteControl() {
+  oscController.onRenderStart = [this](const String &folderPath) {
+    auto *userSettings = ayra::app_properties->getUserSettings();
+    const String path =
+        folderPath.isNotEmpty()
+            ? folderPath
+            : userSettings->getValue(
+                  "oscRenderOutputDir",
+                  userSettings->getValue("lastRenderOutputDir"));
+
+    String refusal;
+    if (gridComponent == nullptr || midiFiles.isEmpty())
+      refusal = "no MIDI files loaded";
+    else if (isRenderInProgress())
+      refusal = "already rendering";
+    else if (!File::isAbsolutePath(path) ||
+             !File(path).createDirectory().wasOk())
+      refusal = "no usable output folder";
+
+    oscTelemetry->sendAck("/render/start", refusal.isEmpty(),
+                          refusal.isEmpty() ? path : refusal);
+    if (refusal.isEmpty())
+      beginRender(File(path), true);
+  };
+
+  oscController.onRenderCancel = [this] {
+    const bool wasRendering = isRenderInProgress();
+    cancelRender();
+    oscTelemetry->sendAck("/render/cancel", wasRendering,
+                          wasRendering ? String() : "not rendering");
+  };
+
+  oscController.onRenderPriority = [this](int row, int column) {
+    const bool queued = parallelRenderer != nullptr &&
+                        parallelRenderer->prioritizeJob(row, midiFiles[column]);
+    oscTelemetry->sendAck("/render/priority", queued,
+                          String(row) + "/" + String(column) +
+                              (queued ? "" : " not queued"));
+  };
+
+  oscController.onRenderPause = [this] {
+    const bool rendering = isRenderInProgress();
+    if (rendering)
+      setRenderPaused(true);
+    oscTelemetry->sendAck("/render/pause", rendering,
+                          rendering ? String() : "not rendering");
+  };
+
+  oscController.onRenderResume = [this] {
+    const bool rendering = isRenderInProgress();
+    if (rendering)
+      setRenderPaused(false);
+    oscTelemetry->sendAck("/render/resume", rendering,
+                          rendering ? String() : "not rendering");
+  };
+
+  oscController.onRenderWorkers = [this](int maxWorkers) {
+    const bool ok = maxWorkers >= 0;
+    if (ok)
+      setRenderWorkers(maxWorkers);
+    oscTelemetry->sendAck("/render/workers", ok,
+                          ok ? String(maxWorkers) : "invalid count");
+  };
+
+  oscController.onProjectLoad = [this](const String &projectPath) {
+    String refusal;
+    if (isRenderInProgress())
+      refusal = "rendering";
+    else if (!File::isAbsolutePath(projectPath) ||
+             !File(projectPath).existsAsFile())
+      refusal = "no such file";
+    else if (!loadProjectFile(File(projectPath)))
+      refusal = "could not load";
+
+    oscTelemetry->sendAck("/project/load", refusal.isEmpty(),
+                          refusal.isEmpty() ? projectPath : refusal);
+  };
+
+  oscController.onBpm = [this](double newBpm) {
+    const bool ok = !isRenderInProgress() && newBpm >= 20.0 && newBpm <= 300.0;
+    if (ok) {
+      configPanel.setBpm(newBpm);
+      applyBpm(newBpm);
+    }
+    oscTelemetry->sendAck("/bpm", ok, String(ok ? newBpm : bpm));
+  };
+
+  oscController.onVariations = [this](int num) {
+    const bool ok = !isRenderInProgress() && num >= 1 && num <= 100;
+    if (ok) {
+      configPanel.setNumVariations(num);
+      applyNumVariations(num);
+    }
+    oscTelemetry->sendAck("/variations", ok, String(numVariations));
+  };
+}
+
 void MainComponent::showOscSettings() {
-  auto *oscSettingsComp = new OSCSettingsComponent(oscController);
-  oscSettingsComp->setSize(400, 300);
+  auto *oscSettingsComp =
+      new OSCSettingsComponent(oscController, *oscTelemetry);
+  oscSettingsComp->setSize(420, 480);
 
   DialogWindow::LaunchOptions o;
   o.content.setOwned(oscSettingsComp);
@@ -829,6 +1160,27 @@ void MainComponent::showOscSettings() {
   o.launchAsync();
 }
 
+void MainComponent::exportTrace() {
+  auto chooser = std::make_shared<FileChooser>(
+      "Export Trace",
+      File::getSpecialLocation(File::userDocumentsDirectory)
+          .getChildFile("Fast Pack Creator Trace.json"),
+      "*.json");
+
+  chooser->launchAsync(
+      FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles,
+      [chooser](const FileChooser &fc) {
+        auto file = fc.getResult();
+        if (file == File())
+          return;
+
+        if (!TraceRecorder::exportChromeTrace(file.withFileExtension(".json")))
+          AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                           "Export Failed",
+                                           "Could not write the trace file.");
+      });
+}
+
 //==============================================================================
 void MainComponent::changeListenerCallback(ChangeBroadcaster *source) {
   ignoreUnused(source);
@@ -863,6 +1215,9 @@ PopupMenu MainComponent::getMenuForIndex(int menuIndex, const String &) {
     menu.addItem(FileLoad, "Load...");
   } else if (menuIndex == 1) {
     menu.addItem(1, "Panic");
+    menu.addSeparator();
+    menu.addItem(2, "Record Trace", true, TraceRecorder::isEnabled());
+    menu.addItem(3, "Export Trace...");
   } else if (menuIndex == 2) {
     menu.addItem(1, "Audio Settings");
     menu.addItem(2, "Plugin Scanner");
@@ -891,8 +1246,20 @@ void MainComponent::menuItemSelected(int menuItemID, int topLevelMenuIndex) {
       break;
     }
   } else if (topLevelMenuIndex == 1) {
-    if (configPanel.onMidiPanic)
-      configPanel.onMidiPanic();
+    switch (menuItemID) {
+    case 1:
+      if (configPanel.onMidiPanic)
+        configPanel.onMidiPanic();
+      break;
+    case 2:
+      TraceRecorder::setEnabled(!TraceRecorder::isEnabled());
+      break;
+    case 3:
+      exportTrace();
+      break;
+    default:
+      break;
+    }
   } else if (topLevelMenuIndex == 2) {
     switch (menuItemID) {
     case 1:
@@ -913,6 +1280,7 @@ void MainComponent::menuItemSelected(int menuItemID, int topLevelMenuIndex) {
 //==============================================================================
 // Project save/load
 void MainComponent::newProject() {
+  midiLibrary.close();
   midiFiles.clear();
   midiFolder = File();
   numVariations = 10;
@@ -982,20 +1350,26 @@ void MainComponent::loadProject() {
         if (file == File() || !file.existsAsFile())
           return;
 
-        ProjectSerializer::ProjectData data;
-        if (ProjectSerializer::loadProject(file, data)) {
-          applyProjectData(data);
-          currentProjectFile = file;
-          projectModified = false;
-        } else {
+        if (!loadProjectFile(file))
           AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
                                            "Load Failed",
                                            "Could not load the project file.");
-        }
       });
 }
 
-ProjectSerializer::ProjectData MainComponent::gatherProjectData() {
+bool MainComponent::loadProjectFile(const File &file) {
+  ProjectSerializer::ProjectData data;
+  if (!ProjectSerializer::loadProject(file, data))
+    return false;
+
+  applyProjectData(data);
+  currentProjectFile = file;
+  projectModified = false;
+  return true;
+}
+
+ProjectSerializer::ProjectData
+MainComponent::gatherProjectData(bool snapshotState) {
   ProjectSerializer::ProjectData data;
 
   data.midiFiles = midiFiles;
@@ -1005,11 +1379,13 @@ ProjectSerializer::ProjectData MainComponent::gatherProjectData() {
   if (gridComponent != nullptr) {
     // Gather row data
     for (int i = 0; i < numVariations; ++i) {
-      auto rowData = gridComponent->getRowData(i);
+      auto rowData = snapshotState ? gridComponent->getRowSnapshot(i)
+                                   : gridComponent->getRowData(i);
       ProjectSerializer::RowSettings row;
       row.name = rowData.name;
       row.pluginDesc = rowData.pluginDescription;
       row.pluginState = rowData.pluginState;
+      row.pluginStateLoader = rowData.pluginStateLoader;
       row.volumeDb = rowData.volumeDb;
       data.rows.add(row);
     }
@@ -1027,8 +1403,35 @@ ProjectSerializer::ProjectData MainComponent::gatherProjectData() {
   return data;
 }
 
+void MainComponent::setupAutosave() {
+  autosave.getSnapshot = [this] { return gatherProjectData(true); };
+  autosave.getStateFingerprint = [this] {
+    ContentHash fingerprint;
+    for (int i = 0; gridComponent != nullptr && i < numVariations; ++i)
+      fingerprint.add(static_cast<int64>(gridComponent->getRowStateVersion(i)));
+    return fingerprint.getValue();
+  };
+
+  // Offer the last autosave if the previous session did not end cleanly
+  const File recoveryFile = autosave.takeRecoveryFile();
+  if (!recoveryFile.existsAsFile())
+    return;
+
+  AlertWindow::showOkCancelBox(
+      MessageBoxIconType::QuestionIcon, "Recover Project",
+      "Fast Pack Creator did not shut down cleanly.\n"
+      "Open the last autosaved project?",
+      "Open", "Discard", nullptr,
+      ModalCallbackFunction::create([this, recoveryFile](int result) {
+        // Opened as untitled, so the next save asks for a location
+        if (result != 0 && loadProjectFile(recoveryFile))
+          currentProjectFile = File();
+      }));
+}
+
 void MainComponent::applyProjectData(
     const ProjectSerializer::ProjectData &data) {
+  midiLibrary.close(); // The project's file list is not watched
   midiFiles = data.midiFiles;
   numVariations = data.numVariations;
   bpm = data.bpm;
@@ -1040,7 +1443,45 @@ void MainComponent::applyProjectData(
   // Rebuild grid
   rebuildGrid();
 
-  // Apply row settings (plugins and volume) - this needs to be done after grid
-  // rebuild Note: Full plugin state restoration would require more complex
-  // implementation For now, the grid is rebuilt with the correct data
+  if (gridComponent == nullptr)
+    return;
+
+  // Apply row and column settings - needs the rebuilt grid
+  for (int i = 0; i < data.rows.size(); ++i) {
+    auto &row = data.rows.getReference(i);
+    MidiGridComponent::RowData rowData;
+    rowData.name = row.name;
+    rowData.pluginDescription = row.pluginDesc;
+    rowData.pluginState = row.pluginState;
+    rowData.volumeDb = row.volumeDb;
+
+    // States are read lazily, possibly on a worker thread and more than
+    // once (saves): an unreadable one is reported the first time only,
+    // rather than silently leaving the plugin on its defaults
+    if (row.pluginStateLoader != nullptr)
+      rowData.pluginStateLoader =
+          [loader = row.pluginStateLoader, name = row.name,
+           reported = std::make_shared<std::atomic<bool>>(false)] {
+            auto state = loader();
+            if (state.isEmpty() && !reported->exchange(true))
+              MessageManager::callAsync([name] {
+                AlertWindow::showMessageBoxAsync(
+                    MessageBoxIconType::WarningIcon, "Plugin State Lost",
+                    "The saved plugin state for \"" + name +
+                        "\" could not be read from the project file. The "
+                        "plugin uses its default settings instead.");
+              });
+            return state;
+          };
+
+    gridComponent->setRowData(i, rowData);
+  }
+
+  for (int i = 0; i < data.columns.size(); ++i) {
+    auto &col = data.columns.getReference(i);
+    gridComponent->setColumnSettings(i, {col.pitchOffset,
+                                         col.velocityMultiplier});
+  }
+
+  gridComponent->instantiateRowPlugins();
 }
@@ -12,10 +12,13 @@
 
 #pragma once
 
+#include "Audio/MidiLibraryIndex.h"
 #include "Audio/PluginHost.h"
 #include "ConfigurationPanel.h"
 #include "MidiGrid/MidiGridComponent.h"
 #include "OSC/OSCController.h"
+#include "OSC/OSCTelemetry.h"
+#include "ProjectAutosave.h"
 #include "ProjectSerializer.h"
 #include "Rendering/ParallelBatchRenderer.h"
 #include <JuceHeader.h>
@@ -24,7 +27,8 @@
 class MainComponent : public Component,
                       public ChangeListener,
                       public ayra::PluginsManager::Listener,
-                      public MenuBarModel {
+                      public MenuBarModel,
+                      private Timer {
 public:
   //==============================================================================
   MainComponent();
@@ -61,6 +65,10 @@ private:
 
   // OSC Remote Control
   OSCController oscController;
+  std::unique_ptr<OSCTelemetry> oscTelemetry; // Status out, to the targets
+
+  // Indexes and watches the chosen MIDI folder
+  MidiLibraryIndex midiLibrary;
 
   // Rendering
   struct RenderPass {
@@ -74,14 +82,19 @@ private:
   std::unique_ptr<ParallelBatchRenderer> parallelRenderer;
   std::unique_ptr<DialogWindow> progressWindow;
   std::unique_ptr<ProgressBar> progressBar;
+  std::unique_ptr<Slider> workersSlider; // Render throttle
+  std::unique_ptr<TextButton> pauseButton;
+  bool renderPaused = false; // Carried over to the next pass
   std::unique_ptr<FileChooser> fileChooser;
   double renderProgress = 0.0;
   File currentOutputDir; // Stored for multi-pass rendering
+  bool remoteRender = false; // Started over OSC: no dialogs, OSC replies
 
   // Level meter
   foleys::LevelMeterLookAndFeel meterLnF;
   foleys::LevelMeter levelMeter{foleys::LevelMeter::Default};
   Slider masterVolume{"MasterVolume"};
+  Label cpuLoadLabel; // Audio callback load and live layer count
 
   //==============================================================================
   // State
@@ -93,16 +106,33 @@ private:
   // Project state
   File currentProjectFile;
   bool projectModified = false;
+  ProjectAutosave autosave;
 
   //==============================================================================
   // Methods
   void loadMidiFolder(const File &folder);
-  void filterShortMidiFiles(const File &folder); // Remove MIDI files < 4 bars
+  void applyMidiLibraryChanges(const Array<File> &added,
+                               const Array<File> &removed);
   void rebuildGrid();
+  void updateGridColumns();
+  void applyBpm(double newBpm);
+  void applyNumVariations(int num);
   void startRender();
+  void beginRender(const File &outputDir, bool remote);
+  void cancelRender();
+  bool isRenderInProgress() const;
+  // Message box, or an OSC reply for renders started over OSC (succeeded
+  // sets the reply's status)
+  void notifyUser(MessageBoxIconType icon, const String &title,
+                  const String &message, bool succeeded = true);
+  void setupRemoteControl();
   void showAudioSettings();
   void showPluginList();
   void showOscSettings();
+  void exportTrace();
+  void renderCellNow(int row, int column);
+  void setRenderPaused(bool shouldPause);
+  void setRenderWorkers(int maxWorkers); // 0 = one per core
   void runBatchNormalization(
       const File &outputDir); // Post-render LUFS normalization
 
@@ -111,12 +141,18 @@ private:
   void saveProject();
   void saveProjectAs();
   void loadProject();
-  ProjectSerializer::ProjectData gatherProjectData();
+  bool loadProjectFile(const File &file);
+  // With snapshotState, unchanged plugin state is shared instead of read
+  ProjectSerializer::ProjectData gatherProjectData(bool snapshotState = false);
+  void setupAutosave();
   void applyProjectData(const ProjectSerializer::ProjectData &data);
 
   // ChangeListener
   void changeListenerCallback(ChangeBroadcaster *source) override;
 
+  // Timer (CPU load readout)
+  void timerCallback() override;
+
   // PluginsManager::Listener
   void onPluginListChanged(ayra::PluginsManager *) override;
   void onScanFinish(ayra::PluginsManager *) override;
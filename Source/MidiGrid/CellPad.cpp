@@ -24,9 +24,13 @@ CellPad::CellPad(int row, int column) : rowIndex(row), columnIndex(column) {
     
     addAndMakeVisible(renderizable);
     renderizable.setToggleState(true, dontSendNotification);
+
+  // The menu opens from anywhere on the pad, buttons included
+  addMouseListener(this, true);
 }
 
 CellPad::~CellPad() {
+  removeMouseListener(this);
   playButton.removeListener(this);
   stopButton.removeListener(this);
 }
@@ -73,6 +77,22 @@ void CellPad::buttonClicked(Button *button) {
   }
 }
 
+void CellPad::mouseDown(const MouseEvent &e) {
+  if (!e.mods.isPopupMenu() || !onRenderNow || rowIndex < 0)
+    return;
+
+  // Pads are recycled while scrolling: the cell is fixed when the menu opens
+  PopupMenu menu;
+  menu.addItem(1, "Render Now");
+  menu.showMenuAsync(
+      PopupMenu::Options().withTargetComponent(this),
+      [safeThis = SafePointer<CellPad>(this), row = rowIndex,
+       column = columnIndex](int result) {
+        if (result == 1 && safeThis != nullptr && safeThis->onRenderNow)
+          safeThis->onRenderNow(row, column);
+      });
+}
+
 void CellPad::setRowAndColumn(int row, int column) {
   rowIndex = row;
   columnIndex = column;
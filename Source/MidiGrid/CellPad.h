@@ -16,6 +16,16 @@
 
 //==============================================================================
 class CellPad : public Component, public Button::Listener {
+  // Right-clicks are left to the pad's menu instead of pressing the button
+  template <typename ButtonType> struct PadButton : public ButtonType {
+    using ButtonType::ButtonType;
+
+    void mouseDown(const MouseEvent &e) override {
+      if (!e.mods.isPopupMenu())
+        ButtonType::mouseDown(e);
+    }
+  };
+
 public:
   //==============================================================================
   CellPad(int row, int column);
@@ -24,10 +34,13 @@ public:
   //==============================================================================
   void paint(Graphics &) override;
   void resized() override;
+  void mouseDown(const MouseEvent &e) override;
 
   //==============================================================================
   std::function<void(int row, int column)> onPlay;
   std::function<void(int row, int column)> onStop;
+  // "Render Now" from the right-click menu
+  std::function<void(int row, int column)> onRenderNow;
 
   void setPlaying(bool playing);
   void setRowAndColumn(int row, int column);
@@ -44,7 +57,7 @@ public:
     void setRenderizable(bool on) { renderizable.setToggleState(on, dontSendNotification); }
     bool isRenderizable() const { return renderizable.getToggleState(); }
     
-    ToggleButton renderizable {"Renderizable"};
+    PadButton<ToggleButton> renderizable {"Renderizable"};
     
 private:
   //==============================================================================
@@ -52,8 +65,10 @@ private:
   int columnIndex;
   bool isPlaying = false;
 
-  TextButton playButton{juce::CharPointer_UTF8("\xe2\x96\xb6")}; // ▶
-  TextButton stopButton{juce::CharPointer_UTF8("\xe2\x96\xa0")}; // ■
+  PadButton<TextButton> playButton{
+      juce::CharPointer_UTF8("\xe2\x96\xb6")}; // ▶
+  PadButton<TextButton> stopButton{
+      juce::CharPointer_UTF8("\xe2\x96\xa0")}; // ■
 
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CellPad)
@@ -37,6 +37,10 @@ ColumnHeader::ColumnHeader(int colIndex, const File &file)
   pitchSlider.setValue(0, dontSendNotification);
   pitchSlider.setSliderStyle(Slider::LinearBar);
   pitchSlider.setNumDecimalPlacesToDisplay(0);
+  pitchSlider.onValueChange = [this] {
+    if (onSettingsChanged)
+      onSettingsChanged();
+  };
 
   addAndMakeVisible(pitchSlider);
 
@@ -48,6 +52,10 @@ ColumnHeader::ColumnHeader(int colIndex, const File &file)
   velocitySlider.setValue(1.0, dontSendNotification);
   velocitySlider.setSliderStyle(Slider::LinearBar);
   velocitySlider.setNumDecimalPlacesToDisplay(2);
+  velocitySlider.onValueChange = [this] {
+    if (onSettingsChanged)
+      onSettingsChanged();
+  };
 
   addAndMakeVisible(velocitySlider);
 }
@@ -91,3 +99,21 @@ int ColumnHeader::getPitchOffset() const {
 float ColumnHeader::getVelocityMultiplier() const {
   return static_cast<float>(velocitySlider.getValue());
 }
+
+void ColumnHeader::setColumn(int colIndex, const File &file) {
+  columnIndex = colIndex;
+
+  if (file != midiFile) {
+    midiFile = file;
+    fileNameLabel.setText(midiFile.getFileNameWithoutExtension(),
+                          dontSendNotification);
+  }
+}
+
+void ColumnHeader::setPitchOffset(int semitones) {
+  pitchSlider.setValue(semitones, dontSendNotification);
+}
+
+void ColumnHeader::setVelocityMultiplier(float multiplier) {
+  velocitySlider.setValue(multiplier, dontSendNotification);
+}
@@ -28,12 +28,19 @@ public:
   //==============================================================================
   int getPitchOffset() const;
   float getVelocityMultiplier() const;
+  void setPitchOffset(int semitones);
+  void setVelocityMultiplier(float multiplier);
 
   const File &getMidiFile() const { return midiFile; }
   int getColumnIndex() const { return columnIndex; }
 
+  // Rebind a recycled header to another column (grid virtualization)
+  void setColumn(int colIndex, const File &file);
+
   // Callback for macro toggle (toggle all cells in this column)
   std::function<void()> onMacroToggle;
+  // Called when the user moves the pitch or velocity slider
+  std::function<void()> onSettingsChanged;
 
 private:
   //==============================================================================
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    GridState.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "GridState.h"
+#include <algorithm>
+
+//==============================================================================
+void ColumnSettingsStore::resize(int numColumns) {
+  pitchOffsets.resize(static_cast<size_t>(numColumns), 0);
+  velocityMultipliers.resize(static_cast<size_t>(numColumns), 1.0f);
+}
+
+int ColumnSettingsStore::getPitchOffset(int column) const {
+  return isPositiveAndBelow(column, size()) ? pitchOffsets[(size_t)column] : 0;
+}
+
+float ColumnSettingsStore::getVelocityMultiplier(int column) const {
+  return isPositiveAndBelow(column, size())
+             ? velocityMultipliers[(size_t)column]
+             : 1.0f;
+}
+
+void ColumnSettingsStore::setPitchOffset(int column, int semitones) {
+  if (isPositiveAndBelow(column, size()))
+    pitchOffsets[(size_t)column] =
+        static_cast<int8>(jlimit(-127, 127, semitones));
+}
+
+void ColumnSettingsStore::setVelocityMultiplier(int column, float multiplier) {
+  if (isPositiveAndBelow(column, size()))
+    velocityMultipliers[(size_t)column] = multiplier;
+}
+
+void ColumnSettingsStore::remapColumns(
+    int newNumColumns, const std::function<int(int)> &sourceColumn) {
+  std::vector<int8> newPitchOffsets((size_t)newNumColumns, 0);
+  std::vector<float> newVelocityMultipliers((size_t)newNumColumns, 1.0f);
+
+  for (int column = 0; column < newNumColumns; ++column) {
+    const int source = sourceColumn(column);
+    if (isPositiveAndBelow(source, size())) {
+      newPitchOffsets[(size_t)column] = pitchOffsets[(size_t)source];
+      newVelocityMultipliers[(size_t)column] =
+          velocityMultipliers[(size_t)source];
+    }
+  }
+
+  pitchOffsets = std::move(newPitchOffsets);
+  velocityMultipliers = std::move(newVelocityMultipliers);
+}
+
+//==============================================================================
+void RenderMask::resize(int newNumRows, int newNumColumns, bool initialState) {
+  numRows = jmax(0, newNumRows);
+  numColumns = jmax(0, newNumColumns);
+  wordsPerRow = (numColumns + bitsPerWord - 1) / bitsPerWord;
+  words.assign(static_cast<size_t>(numRows * wordsPerRow), 0);
+  setAll(initialState);
+}
+
+bool RenderMask::get(int row, int column) const {
+  if (!isValid(row, column))
+    return false;
+
+  const Word word = rowWords(row)[column / bitsPerWord];
+  return (word >> (column % bitsPerWord)) & 1;
+}
+
+void RenderMask::set(int row, int column, bool state) {
+  if (!isValid(row, column))
+    return;
+
+  Word &word = rowWords(row)[column / bitsPerWord];
+  const Word bit = Word(1) << (column % bitsPerWord);
+  word = state ? (word | bit) : (word & ~bit);
+}
+
+//==============================================================================
+void RenderMask::setRow(int row, bool state) {
+  if (row < 0 || row >= numRows || wordsPerRow == 0)
+    return;
+
+  auto *first = rowWords(row);
+  std::fill(first, first + wordsPerRow, state ? ~Word(0) : Word(0));
+
+  // Keep the padding bits clear so counts stay exact
+  first[wordsPerRow - 1] &= getTailMask();
+}
+
+void RenderMask::setColumn(int column, bool state) {
+  for (int row = 0; row < numRows; ++row)
+    set(row, column, state);
+}
+
+void RenderMask::toggleColumn(int column) {
+  if (column < 0 || column >= numColumns)
+    return;
+
+  const Word bit = Word(1) << (column % bitsPerWord);
+  for (int row = 0; row < numRows; ++row)
+    rowWords(row)[column / bitsPerWord] ^= bit;
+}
+
+void RenderMask::setAll(bool state) {
+  for (int row = 0; row < numRows; ++row)
+    setRow(row, state);
+}
+
+RenderMask::Word RenderMask::getTailMask() const {
+  const int usedBits = numColumns % bitsPerWord;
+  return usedBits == 0 ? ~Word(0) : (Word(1) << usedBits) - 1;
+}
+
+//==============================================================================
+void RenderMask::insertRows(int index, int count, bool state) {
+  index = jlimit(0, numRows, index);
+  if (count <= 0)
+    return;
+
+  words.insert(words.begin() + index * wordsPerRow,
+               static_cast<size_t>(count * wordsPerRow), Word(0));
+  numRows += count;
+
+  for (int row = index; row < index + count; ++row)
+    setRow(row, state);
+}
+
+void RenderMask::removeRows(int index, int count) {
+  index = jlimit(0, numRows, index);
+  count = jlimit(0, numRows - index, count);
+
+  words.erase(words.begin() + index * wordsPerRow,
+              words.begin() + (index + count) * wordsPerRow);
+  numRows -= count;
+}
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    GridState.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Flat models behind the grid, sized for MIDI libraries with tens of
+    thousands of columns. Components only exist for the visible area and
+    read/write these.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+// Per-column transform settings, stored as parallel arrays
+class ColumnSettingsStore {
+public:
+  //==============================================================================
+  void resize(int numColumns);
+  int size() const { return static_cast<int>(pitchOffsets.size()); }
+
+  int getPitchOffset(int column) const;
+  float getVelocityMultiplier(int column) const;
+  void setPitchOffset(int column, int semitones);
+  void setVelocityMultiplier(int column, float multiplier);
+
+  // Rebuild with a new column count; sourceColumn maps each new column to
+  // the old one it takes its settings from, or -1 for defaults
+  void remapColumns(int newNumColumns,
+                    const std::function<int(int)> &sourceColumn);
+
+private:
+  std::vector<int8> pitchOffsets;
+  std::vector<float> velocityMultipliers;
+};
+
+//==============================================================================
+// Renderizable flag per cell, packed one bit per cell. Each row starts on a
+// word boundary so row-wide and grid-wide operations work on whole words.
+class RenderMask {
+public:
+  //==============================================================================
+  void resize(int numRows, int numColumns, bool initialState);
+  int getNumRows() const { return numRows; }
+  int getNumColumns() const { return numColumns; }
+
+  bool get(int row, int column) const;
+  void set(int row, int column, bool state);
+
+  //==============================================================================
+  void setRow(int row, bool state);
+  void setColumn(int column, bool state);
+  void toggleColumn(int column);
+  void setAll(bool state);
+
+  //==============================================================================
+  // Row edits keep the flags of all untouched cells; they move whole words
+  void insertRows(int index, int count, bool state);
+  void removeRows(int index, int count);
+
+  // Rebuild with a new column count; sourceColumn maps each new column to
+  // the old one it takes its flags from, or -1 to use fillState
+  void remapColumns(int newNumColumns,
+                    const std::function<int(int)> &sourceColumn,
+                    bool fillState);
+
+private:
+  //==============================================================================
+  using Word = uint64;
+  static constexpr int bitsPerWord = 64;
+
+  int numRows = 0;
+  int numColumns = 0;
+  int wordsPerRow = 0;
+  std::vector<Word> words;
+
+  bool isValid(int row, int column) const {
+    return row >= 0 && row < numRows && column >= 0 && column < numColumns;
+  }
+
+  Word *rowWords(int row) { return words.data() + row * wordsPerRow; }
+  const Word *rowWords(int row) const {
+    return words.data() + row * wordsPerRow;
+  }
+
+  // Mask of the valid bits in the last word of a row
+  Word getTailMask() const;
+};
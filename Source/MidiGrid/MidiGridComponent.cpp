@@ -4,7 +4,8 @@
     MidiGridComponent.cpp
     Fast Pack Creator - MIDI Batch Renderer
 
-    Refactored to use TableListBox for stability
+    Cells and column headers are virtualized: only the visible ones exist
+    as components, backed by the flat models in GridState.h
 
     Created: 2024
     Author:  Federico De Biase / Ayra Soft
@@ -16,7 +17,23 @@
 
 //==============================================================================
 MidiGridComponent::MidiGridComponent(ayra::PluginsManager &pm, PluginHost &host)
-    : pluginsManager(pm), pluginHost(host) {
+    : pluginsManager(pm), pluginHost(host), instancePool(pm),
+      previewCache(pm) {
+  // Live playback runs the plugin on the audio device: leave it the CPU
+  previewCache.shouldYield = [this] { return pluginHost.isPlaying(); };
+
+  instancePool.onInstanceCreated = [this](PluginInstancePool::SlotId slot) {
+    handleInstanceCreated(slot);
+  };
+  instancePool.onInstanceReleased =
+      [this](PluginInstancePool::SlotId, AudioPluginInstance *instance) {
+        handleInstanceReleased(instance);
+      };
+  instancePool.onPrewarmFinished = [this](PluginInstancePool::SlotId slot,
+                                          bool) {
+    handlePrewarmFinished(slot);
+  };
+
   // Setup row header viewport
   rowHeaderViewport.setViewedComponent(&rowHeaderContainer, false);
   rowHeaderViewport.setScrollBarsShown(false, false);
@@ -27,13 +44,17 @@ MidiGridComponent::MidiGridComponent(ayra::PluginsManager &pm, PluginHost &host)
   columnHeaderViewport.setScrollBarsShown(false, false);
   addAndMakeVisible(columnHeaderViewport);
 
-  // Setup table (disable built-in header since we use custom)
-  table.setModel(this);
-  table.setHeaderHeight(0); // Disable built-in header
-  table.setRowHeight(ROW_HEIGHT);
-  table.getViewport()->getVerticalScrollBar().addListener(this);
-  table.getViewport()->getHorizontalScrollBar().addListener(this);
-  addAndMakeVisible(table);
+  // Setup cell area; scrolling it drives the header viewports
+  cellViewport.setViewedComponent(&cellCanvas, false);
+  cellViewport.setScrollBarsShown(true, true);
+  cellViewport.setSingleStepSizes(COLUMN_WIDTH / 4, ROW_HEIGHT / 4);
+  cellViewport.onVisibleAreaChanged = [this] {
+    auto position = cellViewport.getViewPosition();
+    rowHeaderViewport.setViewPosition(0, position.y);
+    columnHeaderViewport.setViewPosition(position.x, 0);
+    updateVisibleComponents();
+  };
+  addAndMakeVisible(cellViewport);
 
   // Setup corner button for macro operations
   loadAllPluginsButton.onClick = [this] { loadPluginToAllRows(); };
@@ -47,15 +68,20 @@ MidiGridComponent::MidiGridComponent(ayra::PluginsManager &pm, PluginHost &host)
 
   renderizableAllOffButton.onClick = [this] { renderizableAllOff(); };
   addAndMakeVisible(renderizableAllOffButton);
+
+  addChildComponent(loadingOverlay);
 }
 
 MidiGridComponent::~MidiGridComponent() {
-  table.setModel(nullptr);
-
-  if (auto *viewport = table.getViewport()) {
-    viewport->getVerticalScrollBar().removeListener(this);
-    viewport->getHorizontalScrollBar().removeListener(this);
-  }
+  cellViewport.onVisibleAreaChanged = nullptr;
+
+  // The host only references the instances, which the pool is about to
+  // free. The row meters read from the host's layer nodes.
+  refreshRowMeters(true);
+  pluginHost.setActivePlugin(nullptr);
+  cuePool.removeAllJobs(true, 10000);
+  pluginHost.setCueTable(nullptr);
+  rowHeaders.clear();
 }
 
 //==============================================================================
@@ -90,16 +116,54 @@ void MidiGridComponent::resized() {
   rowHeaderContainer.setBounds(0, 0, ROW_HEADER_WIDTH,
                                numVariations * ROW_HEIGHT);
 
-  // Table takes remaining space
-  table.setBounds(bounds);
+  // Cells take remaining space
+  cellCanvas.setSize(totalColWidth, numVariations * ROW_HEIGHT);
+  cellViewport.setBounds(bounds);
+  loadingOverlay.setBounds(bounds);
+
+  updateVisibleComponents();
 }
 
 //==============================================================================
 void MidiGridComponent::setMidiFiles(const Array<File> &files) {
+  if (!isBuilt) {
+    midiFiles = files;
+    return;
+  }
+
+  // Columns are matched by file, so a library refresh keeps the settings
+  // and flags of files that are still there. Rows and plugins are kept.
+  HashMap<String, int> oldColumns;
+  for (int column = 0; column < midiFiles.size(); ++column)
+    oldColumns.set(midiFiles.getReference(column).getFullPathName(), column);
+
+  std::vector<int> sources((size_t)files.size(), -1);
+  for (int column = 0; column < files.size(); ++column) {
+    auto path = files.getReference(column).getFullPathName();
+    if (oldColumns.contains(path))
+      sources[(size_t)column] = oldColumns[path];
+  }
+
+  auto sourceColumn = [&sources](int column) {
+    return sources[(size_t)column];
+  };
+  columnSettings.remapColumns(files.size(), sourceColumn);
+  renderMask.remapColumns(files.size(), sourceColumn, true);
   midiFiles = files;
+
+  invalidateVisibleComponents();
 }
 
-void MidiGridComponent::setNumVariations(int num) { numVariations = num; }
+void MidiGridComponent::setNumVariations(int num) {
+  num = jmax(0, num);
+
+  if (!isBuilt)
+    numVariations = num;
+  else if (num > numVariations)
+    insertRows(numVariations, num - numVariations);
+  else if (num < numVariations)
+    removeRows(num, numVariations - num);
+}
 
 void MidiGridComponent::setBpm(double newBpm) {
   bpm = newBpm;
@@ -108,7 +172,8 @@ void MidiGridComponent::setBpm(double newBpm) {
 
 void MidiGridComponent::rebuild() {
   rebuildRowHeaders();
-  rebuildTable();
+  rebuildColumns();
+  isBuilt = true;
   resized();
 }
 
@@ -185,23 +250,25 @@ void MidiGridComponent::loadPluginToAllRows() {
       [this](int result) {
         if (result > 0) {
           auto desc = pluginsManager.getChosenType(result);
-          int loadedCount = 0;
-
-          for (auto *header : rowHeaders) {
-            String errorMessage;
-            auto plugin = pluginsManager.createPluginInstance(
-                desc, 44100.0, 2048, errorMessage);
 
-            if (plugin != nullptr) {
-              header->setPlugin(std::move(plugin), desc.pluginDescription);
-              loadedCount++;
-            }
+          // Instantiate once to validate the plugin, then assign it lazily:
+          // the pool creates the other rows' instances when they are used
+          String errorMessage;
+          auto plugin = pluginsManager.createPluginInstance(
+              desc, 44100.0, 2048, errorMessage);
+
+          if (plugin == nullptr) {
+            AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                             "Plugin Load Error",
+                                             errorMessage);
+            return;
           }
 
-          AlertWindow::showMessageBoxAsync(
-              MessageBoxIconType::InfoIcon, "Load All",
-              "Plugin loaded to " + String(loadedCount) + " of " +
-                  String(rowHeaders.size()) + " rows");
+          for (int row = 1; row < rowHeaders.size(); ++row)
+            rowHeaders[row]->setPluginDescription(desc.pluginDescription, {});
+          rowHeaders[0]->setPlugin(std::move(plugin), desc.pluginDescription);
+
+          instantiateRowPlugins();
         }
       });
 }
@@ -225,13 +292,26 @@ void MidiGridComponent::openCloseAllPluginsGui() {
 //==============================================================================
 MidiGridComponent::ColumnSettings
 MidiGridComponent::getColumnSettings(int columnIndex) const {
-  if (columnIndex >= 0 && columnIndex < columnHeaders.size()) {
-    return {columnHeaders[columnIndex]->getPitchOffset(),
-            columnHeaders[columnIndex]->getVelocityMultiplier()};
+  if (columnIndex >= 0 && columnIndex < columnSettings.size()) {
+    return {columnSettings.getPitchOffset(columnIndex),
+            columnSettings.getVelocityMultiplier(columnIndex)};
   }
   return {};
 }
 
+void MidiGridComponent::setColumnSettings(int columnIndex,
+                                          const ColumnSettings &settings) {
+  columnSettings.setPitchOffset(columnIndex, settings.pitchOffset);
+  columnSettings.setVelocityMultiplier(columnIndex,
+                                       settings.velocityMultiplier);
+  triggerAsyncUpdate();
+
+  if (auto *header = findVisibleColumnHeader(columnIndex)) {
+    header->setPitchOffset(settings.pitchOffset);
+    header->setVelocityMultiplier(settings.velocityMultiplier);
+  }
+}
+
 MidiGridComponent::RowData MidiGridComponent::getRowData(int rowIndex) const {
   if (rowIndex >= 0 && rowIndex < rowHeaders.size()) {
     RowData data;
@@ -244,33 +324,80 @@ MidiGridComponent::RowData MidiGridComponent::getRowData(int rowIndex) const {
   return {};
 }
 
+MidiGridComponent::RowData MidiGridComponent::getRowSnapshot(int rowIndex) {
+  if (rowIndex >= 0 && rowIndex < rowHeaders.size()) {
+    RowData data;
+    data.name = rowHeaders[rowIndex]->getVariationName();
+    data.pluginDescription = rowHeaders[rowIndex]->getPluginDescription();
+    data.pluginStateLoader = rowHeaders[rowIndex]->getPluginStateSnapshot();
+    data.volumeDb = rowHeaders[rowIndex]->getVolumeDb();
+    return data;
+  }
+  return {};
+}
+
+uint32 MidiGridComponent::getRowStateVersion(int rowIndex) const {
+  if (rowIndex >= 0 && rowIndex < rowHeaders.size())
+    return rowHeaders[rowIndex]->getPluginStateVersion();
+  return 0;
+}
+
+void MidiGridComponent::setRowData(int rowIndex, const RowData &data) {
+  auto *header = rowHeaders[rowIndex];
+  if (header == nullptr)
+    return;
+
+  header->setVariationName(data.name);
+  header->setVolumeDb(data.volumeDb);
+
+  if (data.pluginDescription.name.isNotEmpty())
+    header->setPluginDescription(data.pluginDescription, data.pluginState,
+                                 data.pluginStateLoader);
+}
+
+void MidiGridComponent::setRenderedAudioFolder(const File &folder) {
+  renderManifest.load(folder);
+}
+
+void MidiGridComponent::instantiateRowPlugins() {
+  // Start from the selected row so it is ready first; rows beyond the pool
+  // limit stay lazy and are created when used
+  const int firstRow = jmax(0, selectedRowIndex);
+  int remaining = instancePool.getMaxLiveInstances();
+  Array<PluginInstancePool::SlotId> slotsToCreate;
+
+  for (int i = 0; i < rowHeaders.size() && remaining > 0; ++i) {
+    auto *header = rowHeaders[(firstRow + i) % rowHeaders.size()];
+    if (!header->hasPlugin())
+      continue;
+
+    remaining--;
+    if (header->getPlugin() == nullptr)
+      slotsToCreate.add(header->getSlotId());
+  }
+
+  for (auto slot : slotsToCreate)
+    instantiationPending.insert(slot);
+
+  instantiationTotal = static_cast<int>(instantiationPending.size());
+  instantiationProgress = 0.0;
+  loadingOverlay.setVisible(instantiationTotal > 0);
+  loadingOverlay.toFront(false);
+
+  // All requests are issued at once: formats with async creation load
+  // concurrently, and state restores run in parallel on the pool
+  for (auto slot : slotsToCreate)
+    instancePool.prewarm(slot);
+}
+
 //==============================================================================
 void MidiGridComponent::rebuildRowHeaders() {
-  rowHeaders.clear();
+  rowHeaders.clear(); // Releases their slots (and the host's active plugin)
+  activeSlot = 0;
   rowHeaderContainer.removeAllChildren();
 
   for (int row = 0; row < numVariations; ++row) {
-    auto *header = new RowHeader(row, pluginsManager);
-    header->onSelected = [this, row] { handleRowSelection(row); };
-
-    // Connect macro toggle to toggle all cells in this row
-    header->onMacroToggle = [this, row] {
-      toggleRowRenderizable(row);
-      table.updateContent();
-    };
-
-    // Handle volume change
-    header->onVolumeChanged = [this, row](float db) {
-      // Update plugin host if this row's plugin is currently active?
-      // Actually, handleCellPlay sets the gain when playback starts.
-      // But if we change volume WHILE playing, we should update it.
-      // We can check if pluginHost active plugin matches this row's plugin.
-      auto *plugin = rowHeaders[row]->getPlugin();
-      if (plugin != nullptr && pluginHost.getActivePlugin() == plugin) {
-        pluginHost.setGain(Decibels::decibelsToGain(db));
-      }
-    };
-
+    auto *header = createRowHeader(row);
     header->setBounds(0, row * ROW_HEIGHT, ROW_HEADER_WIDTH, ROW_HEIGHT);
     rowHeaders.add(header);
     rowHeaderContainer.addAndMakeVisible(header);
@@ -279,205 +406,284 @@ void MidiGridComponent::rebuildRowHeaders() {
   rowHeaderContainer.setSize(ROW_HEADER_WIDTH, numVariations * ROW_HEIGHT);
 }
 
-void MidiGridComponent::rebuildTable() {
-  // Clear existing columns
-  table.getHeader().removeAllColumns();
-  columnHeaders.clear();
-  columnHeaderContainer.removeAllChildren();
-  // cells.clear(); // REMOVED
+RowHeader *MidiGridComponent::createRowHeader(int row) {
+  auto *header = new RowHeader(row, pluginsManager, instancePool);
+
+  // Callbacks look the row up when fired: rows can be inserted, removed
+  // and moved after the header was created
+  header->onSelected = [this, header] {
+    handleRowSelection(rowHeaders.indexOf(header));
+  };
+
+  // Connect macro toggle to toggle all cells in this row
+  header->onMacroToggle = [this, header] {
+    toggleRowRenderizable(rowHeaders.indexOf(header));
+  };
+
+  // Handle volume change
+  header->onVolumeChanged = [this, header](float db) {
+    // If we change volume WHILE playing, update the host when this row's
+    // plugin is the active one
+    auto *plugin = header->getPlugin();
+    if (pluginHost.hasLayer(plugin)) {
+      pluginHost.setLayerGain(plugin, Decibels::decibelsToGain(db));
+    }
+  };
 
-  // Resize state vector
-  cellRenderizableState.resize(numVariations);
-  for (int i = 0; i < numVariations; ++i) {
-    cellRenderizableState[i].resize(midiFiles.size(), true); // Default true
+  header->onLayerToggle = [this, header] {
+    toggleRowLayer(rowHeaders.indexOf(header));
+  };
+
+  return header;
+}
+
+void MidiGridComponent::layoutRowHeaders(int fromRow) {
+  for (int row = jmax(0, fromRow); row < rowHeaders.size(); ++row)
+    rowHeaders[row]->setBounds(0, row * ROW_HEIGHT, ROW_HEADER_WIDTH,
+                               ROW_HEIGHT);
+}
+
+void MidiGridComponent::invalidateVisibleComponents() {
+  // Hidden components are rebound by the next updateVisibleComponents()
+  for (auto *cell : cells)
+    cell->setVisible(false);
+  for (auto *header : columnHeaders)
+    header->setVisible(false);
+
+  resized();
+  triggerAsyncUpdate(); // Rows or columns moved: recompile the cues
+}
+
+//==============================================================================
+void MidiGridComponent::insertRows(int index, int count) {
+  index = jlimit(0, numVariations, index);
+  if (count <= 0)
+    return;
+
+  for (int row = index; row < index + count; ++row) {
+    auto *header = createRowHeader(row);
+    rowHeaders.insert(row, header);
+    rowHeaderContainer.addAndMakeVisible(header);
   }
 
-  // Add columns for each MIDI file
-  for (int col = 0; col < midiFiles.size(); ++col) {
-    auto &file = midiFiles.getReference(col);
+  renderMask.insertRows(index, count, true);
+  numVariations += count;
 
-    // Create custom column header component with pitch/velocity sliders
-    auto *header = new ColumnHeader(col, file);
-    header->setBounds(col * COLUMN_WIDTH, 0, COLUMN_WIDTH,
-                      COLUMN_HEADER_HEIGHT);
+  if (selectedRowIndex >= index)
+    selectedRowIndex += count;
 
-    // Connect macro toggle to toggle all cells in this column
-    header->onMacroToggle = [this, col] {
-      toggleColumnRenderizable(col);
-      table.updateContent();
-    };
+  layoutRowHeaders(index);
+  invalidateVisibleComponents();
+}
+
+void MidiGridComponent::removeRows(int index, int count) {
+  index = jlimit(0, numVariations, index);
+  count = jlimit(0, numVariations - index, count);
+  if (count == 0)
+    return;
 
-    columnHeaders.add(header);
-    columnHeaderContainer.addAndMakeVisible(header);
+  for (int row = index + count; --row >= index;) {
+    if (rowHeaders[row]->getSlotId() == activeSlot)
+      activeSlot = 0;
 
-    // Add column to table (invisible header since height=0)
-    table.getHeader().addColumn(file.getFileNameWithoutExtension(),
-                                col + 1, // columnId (1-based)
-                                COLUMN_WIDTH, 50, 200,
-                                TableHeaderComponent::notResizableOrSortable);
+    // Deleting the header releases its slot and instance
+    rowHeaders.remove(row);
   }
 
-  // Update column container size
+  renderMask.removeRows(index, count);
+  numVariations -= count;
+
+  if (selectedRowIndex >= index + count)
+    selectedRowIndex -= count;
+  else if (selectedRowIndex >= index)
+    selectedRowIndex = -1;
+
+  layoutRowHeaders(index);
+  invalidateVisibleComponents();
+}
+
+void MidiGridComponent::rebuildColumns() {
+  // Drop recycled components; they are recreated for the visible area
+  cells.clear();
+  cellPoolRows = cellPoolColumns = 0;
+  columnHeaders.clear();
+
+  columnSettings = ColumnSettingsStore();
+  columnSettings.resize(midiFiles.size());
+  renderMask.resize(numVariations, midiFiles.size(), true); // Default true
+
   columnHeaderContainer.setSize(midiFiles.size() * COLUMN_WIDTH,
                                 COLUMN_HEADER_HEIGHT);
+  cellCanvas.setSize(midiFiles.size() * COLUMN_WIDTH,
+                     numVariations * ROW_HEIGHT);
 
-  table.updateContent();
+  updateVisibleComponents();
+  triggerAsyncUpdate();
 }
 
 //==============================================================================
 // Old toggle implementations removed
 
 //==============================================================================
-// TableListBoxModel implementation
-
-int MidiGridComponent::getNumRows() { return numVariations; }
+// Virtualization
 
-void MidiGridComponent::paintRowBackground(Graphics &g, int rowNumber,
-                                           int width, int height,
-                                           bool rowIsSelected) {
+void MidiGridComponent::CellCanvas::paint(Graphics &g) {
+  // Alternating row backgrounds, only for the rows being repainted
   auto colour = getLookAndFeel().findColour(ListBox::backgroundColourId);
-  if (rowIsSelected)
-    colour = colour.brighter(0.2f);
-  else if (rowNumber % 2 == 1)
-    colour = colour.darker(0.05f);
+  auto clip = g.getClipBounds();
 
-  g.fillAll(colour);
-}
+  const int firstRow = jmax(0, clip.getY() / ROW_HEIGHT);
+  const int lastRow = jmin((getHeight() - 1) / ROW_HEIGHT,
+                           (clip.getBottom() - 1) / ROW_HEIGHT);
 
-void MidiGridComponent::paintCell(Graphics &g, int rowNumber, int columnId,
-                                  int width, int height, bool rowIsSelected) {
-  // Cells are rendered via refreshComponentForCell
+  for (int row = firstRow; row <= lastRow; ++row) {
+    g.setColour(row % 2 == 1 ? colour.darker(0.05f) : colour);
+    g.fillRect(clip.getX(), row * ROW_HEIGHT, clip.getWidth(), ROW_HEIGHT);
+  }
 }
 
-Component *MidiGridComponent::refreshComponentForCell(
-    int rowNumber, int columnId, bool isRowSelected,
-    Component *existingComponentToUpdate) {
-
-  int columnIndex = columnId - 1; // Convert to 0-based
-
-  if (columnIndex < 0 || columnIndex >= midiFiles.size())
-    return nullptr;
-
-  auto *cell = static_cast<CellPad *>(existingComponentToUpdate);
+void MidiGridComponent::updateVisibleComponents() {
+  const int numColumns = midiFiles.size();
+  auto visible = cellViewport.getViewArea();
+
+  // Pool sizes cover any scroll offset of the visible area
+  const int poolRows =
+      jmin(numVariations, visible.getHeight() / ROW_HEIGHT + 2);
+  const int poolColumns =
+      jmin(numColumns, visible.getWidth() / COLUMN_WIDTH + 2);
+
+  if (poolRows != cellPoolRows || poolColumns != cellPoolColumns) {
+    cells.clear();
+    columnHeaders.clear();
+    cellPoolRows = poolRows;
+    cellPoolColumns = poolColumns;
+
+    for (int i = 0; i < poolRows * poolColumns; ++i) {
+      auto *cell = new CellPad(-1, -1);
+      cell->onPlay = [this](int r, int c) { handleCellPlay(r, c); };
+      cell->onStop = [this](int r, int c) { handleCellStop(r, c); };
+      cell->onRenderNow = [this](int r, int c) {
+        if (onCellRenderNow)
+          onCellRenderNow(r, c);
+      };
+      cell->renderizable.onClick = [this, cell] {
+        onCellRenderizableChanged(cell->getRow(), cell->getColumn(),
+                                  cell->isRenderizable());
+      };
+      cells.add(cell);
+      cellCanvas.addChildComponent(cell);
+    }
 
-  if (cell == nullptr) {
-    cell = new CellPad(rowNumber, columnIndex);
-    // Play/Stop handlers...
-    cell->onPlay = [this](int r, int c) { handleCellPlay(r, c); };
-    cell->onStop = [this](int r, int c) { handleCellStop(r, c); };
+    for (int i = 0; i < poolColumns; ++i) {
+      auto *header = new ColumnHeader(-1, File());
+
+      // Callbacks look the column up when fired: headers are recycled
+      header->onMacroToggle = [this, header] {
+        toggleColumnRenderizable(header->getColumnIndex());
+      };
+      header->onSettingsChanged = [this, header] {
+        columnSettings.setPitchOffset(header->getColumnIndex(),
+                                      header->getPitchOffset());
+        columnSettings.setVelocityMultiplier(header->getColumnIndex(),
+                                             header->getVelocityMultiplier());
+        triggerAsyncUpdate();
+      };
+      columnHeaders.add(header);
+      columnHeaderContainer.addChildComponent(header);
+    }
+  }
 
-    // Renderizable toggle handler
-    cell->renderizable.onClick = [this, cell] {
-      onCellRenderizableChanged(cell->getRow(), cell->getColumn(),
-                                cell->isRenderizable());
-    };
+  if (poolRows == 0 || poolColumns == 0)
+    return;
 
-    // cells.add(cell); // REMOVED
-  } else {
-    // Update existing cell if row/column changed
-    cell->setRowAndColumn(rowNumber, columnIndex);
+  const int firstRow = jlimit(0, jmax(0, numVariations - poolRows),
+                              visible.getY() / ROW_HEIGHT);
+  const int firstColumn = jlimit(0, jmax(0, numColumns - poolColumns),
+                                 visible.getX() / COLUMN_WIDTH);
+
+  // Column c always lands on header c % poolColumns, so scrolling by one
+  // column rebinds only the header that scrolled in
+  for (int column = firstColumn; column < firstColumn + poolColumns;
+       ++column) {
+    auto *header = columnHeaders[column % poolColumns];
+    if (header->getColumnIndex() != column || !header->isVisible()) {
+      header->setColumn(column, midiFiles[column]);
+      header->setPitchOffset(columnSettings.getPitchOffset(column));
+      header->setVelocityMultiplier(
+          columnSettings.getVelocityMultiplier(column));
+      header->setBounds(column * COLUMN_WIDTH, 0, COLUMN_WIDTH,
+                        COLUMN_HEADER_HEIGHT);
+      header->setVisible(true);
+    }
   }
 
-  // Update cell UI from state
-  if (rowNumber >= 0 && rowNumber < cellRenderizableState.size()) {
-    if (columnIndex >= 0 &&
-        columnIndex < cellRenderizableState[rowNumber].size()) {
-      cell->setRenderizable(cellRenderizableState[rowNumber][columnIndex]);
+  for (int row = firstRow; row < firstRow + poolRows; ++row) {
+    for (int column = firstColumn; column < firstColumn + poolColumns;
+         ++column) {
+      auto *cell = cells[(row % poolRows) * poolColumns + column % poolColumns];
+      if (cell->getRow() != row || cell->getColumn() != column ||
+          !cell->isVisible()) {
+        cell->setRowAndColumn(row, column);
+        cell->setRenderizable(renderMask.get(row, column));
+        cell->setBounds(column * COLUMN_WIDTH, row * ROW_HEIGHT, COLUMN_WIDTH,
+                        ROW_HEIGHT);
+        cell->setVisible(true);
+      }
     }
   }
+}
 
-  return cell;
+void MidiGridComponent::refreshVisibleCells() {
+  for (auto *cell : cells)
+    if (cell->isVisible())
+      cell->setRenderizable(renderMask.get(cell->getRow(), cell->getColumn()));
 }
 
-//==============================================================================
-void MidiGridComponent::scrollBarMoved(ScrollBar *scrollBarThatHasMoved,
-                                       double newRangeStart) {
-  if (scrollBarThatHasMoved == &table.getViewport()->getVerticalScrollBar()) {
-    rowHeaderViewport.setViewPosition(0, static_cast<int>(newRangeStart));
-  } else if (scrollBarThatHasMoved ==
-             &table.getViewport()->getHorizontalScrollBar()) {
-    columnHeaderViewport.setViewPosition(static_cast<int>(newRangeStart), 0);
-  }
+ColumnHeader *MidiGridComponent::findVisibleColumnHeader(int column) const {
+  if (cellPoolColumns == 0 || column < 0)
+    return nullptr;
+
+  auto *header = columnHeaders[column % cellPoolColumns];
+  return header != nullptr && header->getColumnIndex() == column ? header
+                                                                  : nullptr;
 }
 
 //==============================================================================
 bool MidiGridComponent::isCellRenderizable(int row, int column) const {
-  if (row >= 0 && row < cellRenderizableState.size()) {
-    if (column >= 0 && column < cellRenderizableState[row].size()) {
-      return cellRenderizableState[row][column];
-    }
-  }
-  return false;
+  return renderMask.get(row, column);
 }
 
 void MidiGridComponent::setCellRenderizable(int row, int column,
                                             bool shouldBeRenderizable) {
-  if (row >= 0 && row < cellRenderizableState.size()) {
-    if (column >= 0 && column < cellRenderizableState[row].size()) {
-      cellRenderizableState[row][column] = shouldBeRenderizable;
-      // We should repaint that cell if visible, or just repaint table
-      table.repaint();
-    }
-  }
+  renderMask.set(row, column, shouldBeRenderizable);
+  refreshVisibleCells();
 }
 
 void MidiGridComponent::onCellRenderizableChanged(int row, int column,
                                                   bool newState) {
   // Update model from UI interaction
-  if (row >= 0 && row < cellRenderizableState.size()) {
-    if (column >= 0 && column < cellRenderizableState[row].size()) {
-      cellRenderizableState[row][column] = newState;
-    }
-  }
+  renderMask.set(row, column, newState);
 }
 
 void MidiGridComponent::toggleRowRenderizable(int rowIndex) {
-  if (rowIndex >= 0 && rowIndex < cellRenderizableState.size()) {
-    // Check first one to decide toggle direction
-    bool anyOn = false;
-    for (bool val : cellRenderizableState[rowIndex]) {
-      if (val) {
-        anyOn = true;
-        break;
-      }
-    }
-
-    bool newState =
-        !anyOn; // If any is On, turn all Off? Or if all Off turn On?
-    // Standard toggle: if all are Same, flip. If mixed, set to On.
-    // Let's simplified: If all are OFF, set ON. Else set OFF.
-
-    // Better: Toggle based on state?
-    // Let's just flip all? No, that's chaotic.
-    // Set all to !first?
-    if (cellRenderizableState[rowIndex].size() > 0)
-      newState = !cellRenderizableState[rowIndex][0];
-
-    for (size_t i = 0; i < cellRenderizableState[rowIndex].size(); ++i)
-      cellRenderizableState[rowIndex][i] = newState;
-
-    table.repaint();
-  }
+  // Standard toggle: flip the whole row based on its first cell
+  renderMask.setRow(rowIndex, !renderMask.get(rowIndex, 0));
+  refreshVisibleCells();
 }
 
 void MidiGridComponent::toggleColumnRenderizable(int columnIndex) {
-  for (auto &row : cellRenderizableState) {
-    if (columnIndex >= 0 && columnIndex < row.size())
-      row[columnIndex] = !row[columnIndex];
-  }
-  table.repaint();
+  renderMask.toggleColumn(columnIndex);
+  refreshVisibleCells();
 }
 
 void MidiGridComponent::renderizableAllOn() {
-  for (auto &row : cellRenderizableState)
-    std::fill(row.begin(), row.end(), true);
-  table.updateContent();
+  renderMask.setAll(true);
+  refreshVisibleCells();
 }
 
 void MidiGridComponent::renderizableAllOff() {
-  for (auto &row : cellRenderizableState)
-    std::fill(row.begin(), row.end(), false);
-  table.updateContent();
+  renderMask.setAll(false);
+  refreshVisibleCells();
 }
 
 // REMOVED getCellAt implementation
@@ -488,16 +694,44 @@ void MidiGridComponent::handleCellPlay(int row, int column) {
       column >= midiFiles.size())
     return;
 
+  lastPlayedRow = row;
+  lastPlayedColumn = column;
+
+  // A finished render of exactly this cell plays without the plugin, and
+  // so does a preview rendered in the background
+  auto rowData = getRowKeyData(row);
+  auto renderedClip = findRenderedClip(rowData, column);
+  if (renderedClip != File() && pluginHost.playClip(renderedClip)) {
+    queuePreviewRenders();
+    return;
+  }
+
+  if (rowData.pluginDescription.name.isNotEmpty()) {
+    auto key = RenderManifest::computeKey(getCellInputs(rowData, column));
+    if (auto clip = previewCache.find(key)) {
+      pluginHost.playBuffer(clip, PreviewRenderCache::sampleRate);
+      queuePreviewRenders();
+      return;
+    }
+  }
+
   auto *rowHeader = rowHeaders[row];
-  auto *plugin = rowHeader->getPlugin();
 
-  if (plugin == nullptr) {
+  if (!rowHeader->hasPlugin()) {
     AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
                                      "No Plugin",
                                      "Please load a plugin for this row first");
     return;
   }
 
+  // Instantiated on demand if the pool evicted it or never created it
+  String errorMessage;
+  if (rowHeader->acquirePlugin(errorMessage) == nullptr) {
+    AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                     "Plugin Load Error", errorMessage);
+    return;
+  }
+
   // Load and play MIDI
   auto midiSequence = loadMidiFile(midiFiles[column]);
   auto columnSettings = getColumnSettings(column);
@@ -506,9 +740,90 @@ void MidiGridComponent::handleCellPlay(int row, int column) {
                            columnSettings.velocityMultiplier);
 
   // Set active plugin and play with volume
-  pluginHost.setActivePlugin(plugin);
-  pluginHost.setGain(Decibels::decibelsToGain(rowHeader->getVolumeDb()));
+  setActiveRow(row);
   pluginHost.playMidiSequence(transformedSequence, bpm);
+  queuePreviewRenders();
+}
+
+// Enough to compute the row's cell keys: the state is left unread, and
+// the pool caches its hash per state version
+MidiGridComponent::RowData MidiGridComponent::getRowKeyData(int rowIndex) {
+  auto data = getRowSnapshot(rowIndex);
+  if (rowIndex >= 0 && rowIndex < rowHeaders.size())
+    data.pluginStateHash = rowHeaders[rowIndex]->getPluginStateHash();
+  return data;
+}
+
+RenderManifest::JobInputs
+MidiGridComponent::getCellInputs(const RowData &rowData, int column) const {
+  auto settings = getColumnSettings(column);
+
+  RenderManifest::JobInputs inputs;
+  inputs.pluginDesc = rowData.pluginDescription;
+  inputs.pluginState = rowData.pluginState;
+  inputs.pluginStateHash = rowData.pluginStateHash;
+  inputs.midiFile = midiFiles[column];
+  inputs.pitchOffset = settings.pitchOffset;
+  inputs.velocityMultiplier = settings.velocityMultiplier;
+  inputs.volumeDb = rowData.volumeDb;
+  inputs.bpm = bpm;
+  return inputs;
+}
+
+File MidiGridComponent::findRenderedClip(const RowData &rowData,
+                                         int column) const {
+  if (renderManifest.getOutputDirectory() == File() ||
+      rowData.pluginDescription.name.isEmpty())
+    return {};
+
+  return renderManifest.find(
+      RenderManifest::computeKey(getCellInputs(rowData, column)));
+}
+
+void MidiGridComponent::queuePreviewRenders() {
+  const auto view = cellViewport.getViewArea();
+  const int firstColumn = jmax(0, view.getX() / COLUMN_WIDTH);
+  const int lastColumn =
+      jmin(midiFiles.size() - 1, view.getRight() / COLUMN_WIDTH);
+
+  std::vector<RenderManifest::JobInputs> cells;
+  auto addVisibleCells = [&](int row) {
+    if (row < 0 || row >= rowHeaders.size())
+      return;
+
+    auto rowData = getRowKeyData(row);
+    if (rowData.pluginDescription.name.isEmpty())
+      return;
+
+    bool stateRead = false;
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+      auto inputs = getCellInputs(rowData, column);
+      const auto key = RenderManifest::computeKey(inputs);
+
+      // Cells with a finished render already play without the plugin
+      if (previewCache.find(key) != nullptr ||
+          (renderManifest.getOutputDirectory() != File() &&
+           renderManifest.find(key) != File()))
+        continue;
+
+      // The state is only needed to render, so it is read once per row and
+      // only if one of its cells is still missing
+      if (!stateRead) {
+        rowData.pluginState = rowData.pluginStateLoader();
+        stateRead = true;
+      }
+      inputs.pluginState = rowData.pluginState;
+      cells.push_back(std::move(inputs));
+    }
+  };
+
+  // The selected row first, then the rows around the last cell played
+  addVisibleCells(selectedRowIndex);
+  for (int row : {lastPlayedRow, lastPlayedRow + 1, lastPlayedRow - 1})
+    if (lastPlayedRow >= 0 && row != selectedRowIndex)
+      addVisibleCells(row);
+
+  previewCache.setPendingCells(cells);
 }
 
 void MidiGridComponent::handleCellStop(int row, int column) {
@@ -522,13 +837,144 @@ void MidiGridComponent::handleRowSelection(int rowIndex) {
   selectedRowIndex = rowIndex;
 
   if (selectedRowIndex >= 0 && selectedRowIndex < rowHeaders.size()) {
-    auto *header = rowHeaders[selectedRowIndex];
-    header->setSelected(true);
+    rowHeaders[selectedRowIndex]->setSelected(true);
+
+    // Set as active plugin for MIDI input if it is already live; otherwise
+    // it becomes active once the background prewarm finishes
+    if (rowHeaders[selectedRowIndex]->getPlugin() != nullptr)
+      setActiveRow(selectedRowIndex);
 
-    // Set as active plugin for MIDI input
-    pluginHost.setActivePlugin(header->getPlugin());
-    // Also update gain/volume for live input monitoring?
-    pluginHost.setGain(Decibels::decibelsToGain(header->getVolumeDb()));
+    prewarmAroundRow(selectedRowIndex);
+    queuePreviewRenders();
+  }
+}
+
+void MidiGridComponent::setActiveRow(int rowIndex) {
+  auto *header = rowHeaders[rowIndex];
+  if (header == nullptr)
+    return;
+
+  const auto slot = header->getSlotId();
+  if (slot != activeSlot) {
+    instancePool.pin(slot);
+    instancePool.unpin(activeSlot);
+    activeSlot = slot;
+  }
+
+  // A layered row that becomes the active one is no longer an extra layer
+  if (layeredSlots.erase(slot) > 0) {
+    instancePool.unpin(slot);
+    header->setLayered(false);
+  }
+
+  syncHostLayers();
+}
+
+void MidiGridComponent::toggleRowLayer(int rowIndex) {
+  auto *header = rowHeaders[rowIndex];
+  if (header == nullptr || !header->hasPlugin())
+    return;
+
+  const auto slot = header->getSlotId();
+  if (slot == activeSlot)
+    return; // Already playing
+
+  if (layeredSlots.erase(slot) > 0) {
+    instancePool.unpin(slot);
+  } else {
+    String errorMessage;
+    if (header->acquirePlugin(errorMessage) == nullptr) {
+      AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                       "Plugin Load Error", errorMessage);
+      return;
+    }
+
+    instancePool.pin(slot);
+    layeredSlots.insert(slot);
+  }
+
+  header->setLayered(layeredSlots.count(slot) > 0);
+  syncHostLayers();
+}
+
+void MidiGridComponent::syncHostLayers() {
+  // The active row plus every layered row that is live
+  Array<AudioPluginInstance *> wanted;
+  Array<float> gains;
+  for (auto *header : rowHeaders) {
+    const auto slot = header->getSlotId();
+    auto *plugin = header->getPlugin();
+    if (plugin != nullptr &&
+        (slot == activeSlot || layeredSlots.count(slot) > 0)) {
+      wanted.add(plugin);
+      gains.add(Decibels::decibelsToGain(header->getVolumeDb()));
+    }
+  }
+
+  // Meters read from the host's layer nodes: detach before editing them
+  refreshRowMeters(true);
+
+  for (auto *plugin : pluginHost.getActivePlugins())
+    if (!wanted.contains(plugin))
+      pluginHost.removeLayer(plugin);
+
+  for (int i = 0; i < wanted.size(); ++i) {
+    if (pluginHost.hasLayer(wanted[i]))
+      pluginHost.setLayerGain(wanted[i], gains[i]);
+    else
+      pluginHost.addLayer(wanted[i], gains[i]);
+  }
+
+  refreshRowMeters();
+  triggerAsyncUpdate(); // The cue row follows the active plugin
+}
+
+void MidiGridComponent::refreshRowMeters(bool detach) {
+  for (auto *header : rowHeaders)
+    header->setMeterSource(
+        detach ? nullptr : pluginHost.getLayerMeterSource(header->getPlugin()));
+}
+
+void MidiGridComponent::prewarmAroundRow(int rowIndex) {
+  if (rowIndex < 0 || rowIndex >= rowHeaders.size())
+    return;
+
+  // Selected row first, then its neighbours
+  for (int row : {rowIndex, rowIndex + 1, rowIndex - 1})
+    if (row >= 0 && row < rowHeaders.size())
+      instancePool.prewarm(rowHeaders[row]->getSlotId());
+}
+
+void MidiGridComponent::handleInstanceCreated(
+    PluginInstancePool::SlotId slot) {
+  if (selectedRowIndex >= 0 && selectedRowIndex < rowHeaders.size() &&
+      rowHeaders[selectedRowIndex]->getSlotId() == slot &&
+      !pluginHost.hasLayer(instancePool.getInstance(slot)))
+    setActiveRow(selectedRowIndex);
+}
+
+void MidiGridComponent::handlePrewarmFinished(
+    PluginInstancePool::SlotId slot) {
+  if (instantiationPending.erase(slot) == 0 || instantiationTotal == 0)
+    return;
+
+  const int done =
+      instantiationTotal - static_cast<int>(instantiationPending.size());
+  instantiationProgress = done / static_cast<double>(instantiationTotal);
+
+  if (instantiationPending.empty()) {
+    loadingOverlay.setVisible(false);
+    instantiationTotal = 0;
+  }
+}
+
+void MidiGridComponent::handleInstanceReleased(AudioPluginInstance *instance) {
+  // Only happens when the row's plugin is replaced or removed - active and
+  // layered instances are pinned and never evicted
+  if (pluginHost.hasLayer(instance)) {
+    refreshRowMeters(true);
+    pluginHost.removeLayer(instance);
+    refreshRowMeters();
   }
 }
 
@@ -542,6 +988,84 @@ void MidiGridComponent::triggerCellStop(int row, int column) {
   handleCellStop(row, column);
 }
 
+void MidiGridComponent::notifyCellCued(int row, int column) {
+  lastPlayedRow = row;
+  lastPlayedColumn = column;
+  queuePreviewRenders();
+}
+
+//==============================================================================
+void MidiGridComponent::handleAsyncUpdate() { compileCues(); }
+
+void MidiGridComponent::compileCues() {
+  int cueRow = -1;
+
+  // Only the active row: playing any other one changes which plugins are
+  // in the graph, which has to happen on the message thread
+  for (int row = 0; row < rowHeaders.size(); ++row) {
+    auto *header = rowHeaders[row];
+    if (header->getSlotId() == activeSlot && header->getPlugin() != nullptr &&
+        pluginHost.hasLayer(header->getPlugin()))
+      cueRow = row;
+  }
+
+  const int generation = ++cueGeneration;
+  cuePool.removeAllJobs(false, 0); // Superseded, unless already running
+
+  if (cueRow < 0) {
+    pluginHost.setCueTable(nullptr);
+    return;
+  }
+
+  // Stating and parsing the files happens on the pool; the table is
+  // swapped in back here, unless the grid changed again in the meantime
+  std::vector<ColumnSettings> settings;
+  for (int column = 0; column < midiFiles.size(); ++column)
+    settings.push_back(getColumnSettings(column));
+
+  cuePool.addJob([this, safeThis = SafePointer<MidiGridComponent>(this),
+                  files = midiFiles, settings, cueRow, generation] {
+    auto table = std::make_shared<PluginHost::CueTable>();
+    table->row = cueRow;
+    table->columns.reserve(static_cast<size_t>(files.size()));
+
+    // Columns whose file and settings are unchanged reuse their sequence
+    std::map<String, std::shared_ptr<const MidiMessageSequence>> compiled;
+
+    for (int column = 0; column < files.size(); ++column) {
+      const auto &file = files.getReference(column);
+      const auto &columnSettings = settings[static_cast<size_t>(column)];
+      const String key =
+          file.getFullPathName() + "/" +
+          String(file.getLastModificationTime().toMilliseconds()) + "/" +
+          String(columnSettings.pitchOffset) + "/" +
+          String(columnSettings.velocityMultiplier);
+
+      auto &sequence = compiled[key];
+      if (sequence == nullptr) {
+        auto cached = cueSequences.find(key);
+        if (cached != cueSequences.end())
+          sequence = cached->second;
+        else
+          sequence = std::make_shared<MidiMessageSequence>(
+              applyTransformations(loadMidiFile(file),
+                                   columnSettings.pitchOffset,
+                                   columnSettings.velocityMultiplier));
+      }
+
+      table->columns.push_back(sequence);
+    }
+
+    cueSequences = std::move(compiled);
+
+    MessageManager::callAsync([safeThis, table, generation] {
+      if (safeThis != nullptr && safeThis->cueGeneration == generation)
+        safeThis->pluginHost.setCueTable(
+            std::make_unique<PluginHost::CueTable>(std::move(*table)));
+    });
+  });
+}
+
 void MidiGridComponent::togglePluginGui(int row) {
   if (row >= 0 && row < rowHeaders.size()) {
     if (rowHeaders[row]->isPluginEditorShown())
@@ -562,3 +1086,19 @@ void MidiGridComponent::closePluginGui(int row) {
     rowHeaders[row]->closePluginEditor();
   }
 }
+
+//==============================================================================
+MidiGridComponent::LoadingOverlay::LoadingOverlay(double &progress)
+    : progressBar(progress) {
+  progressBar.setTextToDisplay("Loading plugins...");
+  addAndMakeVisible(progressBar);
+}
+
+void MidiGridComponent::LoadingOverlay::paint(Graphics &g) {
+  g.fillAll(Colours::black.withAlpha(0.5f));
+}
+
+void MidiGridComponent::LoadingOverlay::resized() {
+  progressBar.setBounds(getLocalBounds().withSizeKeepingCentre(
+      jmin(300, getWidth() - 20), 24));
+}
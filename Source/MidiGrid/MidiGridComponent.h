@@ -4,7 +4,8 @@
     MidiGridComponent.h
     Fast Pack Creator - MIDI Batch Renderer
 
-    Refactored to use TableListBox for stability
+    Cells and column headers are virtualized: only the visible ones exist
+    as components, backed by the flat models in GridState.h
 
     Created: 2024
     Author:  Federico De Biase / Ayra Soft
@@ -15,15 +16,19 @@
 #pragma once
 
 #include "../Audio/PluginHost.h"
+#include "../Audio/PluginInstancePool.h"
+#include "../Audio/PreviewRenderCache.h"
+#include "../Rendering/RenderManifest.h"
 #include "CellPad.h"
 #include "ColumnHeader.h"
+#include "GridState.h"
 #include "RowHeader.h"
 #include <JuceHeader.h>
+#include <map>
+#include <set>
 
 //==============================================================================
-class MidiGridComponent : public Component,
-                          public TableListBoxModel,
-                          public ScrollBar::Listener {
+class MidiGridComponent : public Component, private AsyncUpdater {
 public:
   //==============================================================================
   struct ColumnSettings {
@@ -35,6 +40,10 @@ public:
     String name;
     PluginDescription pluginDescription;
     MemoryBlock pluginState;
+    // Read on demand instead of pluginState: set by getRowSnapshot, and
+    // passed to setRowData for state still in the project file
+    PluginInstancePool::StateLoader pluginStateLoader;
+    uint64 pluginStateHash = 0; // Set by getRowKeyData
     float volumeDb = 0.0f;
   };
 
@@ -53,23 +62,33 @@ public:
   void rebuild();
 
   ColumnSettings getColumnSettings(int columnIndex) const;
+  void setColumnSettings(int columnIndex, const ColumnSettings &settings);
   RowData getRowData(int rowIndex) const;
+  // Like getRowData, but only reads plugin state that changed since the
+  // last snapshot. Cheap enough to call periodically.
+  RowData getRowSnapshot(int rowIndex);
+  uint32 getRowStateVersion(int rowIndex) const;
+  // Assigns the row's plugin lazily; see instantiateRowPlugins()
+  void setRowData(int rowIndex, const RowData &data);
 
   //==============================================================================
-  // TableListBoxModel
-  int getNumRows() override;
-  void paintRowBackground(Graphics &g, int rowNumber, int width, int height,
-                          bool rowIsSelected) override;
-  void paintCell(Graphics &g, int rowNumber, int columnId, int width,
-                 int height, bool rowIsSelected) override;
-  Component *
-  refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected,
-                          Component *existingComponentToUpdate) override;
-
-  // ScrollBar::Listener - to sync row headers with table scroll
-  void scrollBarMoved(ScrollBar *scrollBarThatHasMoved,
-                      double newRangeStart) override;
+  // Incremental edits: untouched rows keep their plugin instances and state,
+  // and every cell keeps its renderizable flag
+  void insertRows(int index, int count);
+  void removeRows(int index, int count);
 
+  // Cells already rendered into this folder (with the same inputs) are
+  // previewed from their WAV instead of the live plugin
+  void setRenderedAudioFolder(const File &folder);
+
+  // "Render Now" picked on a cell
+  std::function<void(int row, int column)> onCellRenderNow;
+
+  // Create the row plugins concurrently (up to the preview pool limit),
+  // showing a progress overlay until they are all live
+  void instantiateRowPlugins();
+
+  //==============================================================================
   // CellPad *getCellAt(int row, int column); // REMOVED - unsafe with
   // virtualization
   bool isCellRenderizable(int row, int column) const;
@@ -79,6 +98,8 @@ public:
   // OSC Remote Control - Public methods for external triggering
   void triggerCellPlay(int row, int column);
   void triggerCellStop(int row, int column);
+  // A cell the audio callback started on its own (see PluginHost::cueCell)
+  void notifyCellCued(int row, int column);
   void togglePluginGui(int row);
   void openPluginGui(int row);
   void closePluginGui(int row);
@@ -95,9 +116,31 @@ private:
   ayra::PluginsManager &pluginsManager;
   PluginHost &pluginHost;
 
+  // Live preview instances; declared before the row headers that own slots
+  PluginInstancePool instancePool;
+  PluginInstancePool::SlotId activeSlot = 0; // Pinned while in the host
+  // Rows layered on top of the active row in the host, pinned as well
+  std::set<PluginInstancePool::SlotId> layeredSlots;
+
+  // Offline renders of the cells around the selection, for glitch-free
+  // audition of heavy plugins
+  PreviewRenderCache previewCache;
+  int lastPlayedRow = -1;
+  int lastPlayedColumn = -1;
+
   Array<File> midiFiles;
   int numVariations = 10;
   double bpm = 120.0;
+  bool isBuilt = false; // After rebuild(), setters edit the grid in place
+
+  RenderManifest renderManifest;
+
+  // Compiled column sequences for the host's cue table, keyed by file,
+  // modification time and column settings. Only touched by cuePool's
+  // single thread, which stats and parses the files.
+  std::map<String, std::shared_ptr<const MidiMessageSequence>> cueSequences;
+  ThreadPool cuePool{1};
+  int cueGeneration = 0; // Drops tables compiled for an older grid state
 
   //==============================================================================
   // Row headers (left side)
@@ -105,14 +148,37 @@ private:
   Viewport rowHeaderViewport;
   Component rowHeaderContainer;
 
-  // Column headers (top, with pitch/velocity sliders)
+  // Column headers (top, with pitch/velocity sliders). Only the visible
+  // ones exist; header i serves every column c with c % count == i.
   OwnedArray<ColumnHeader> columnHeaders;
   Viewport columnHeaderViewport;
   Component columnHeaderContainer;
   static constexpr int COLUMN_HEADER_HEIGHT = 80;
 
-  // Main table
-  TableListBox table;
+  // Cell area. Cells are recycled the same way, tiled over the visible
+  // rows and columns.
+  class CellViewport : public Viewport {
+  public:
+    std::function<void()> onVisibleAreaChanged;
+    void visibleAreaChanged(const Rectangle<int> &) override {
+      if (onVisibleAreaChanged)
+        onVisibleAreaChanged();
+    }
+  };
+
+  class CellCanvas : public Component {
+  public:
+    void paint(Graphics &g) override;
+  };
+
+  CellViewport cellViewport;
+  CellCanvas cellCanvas;
+  OwnedArray<CellPad> cells;
+  int cellPoolRows = 0;
+  int cellPoolColumns = 0;
+
+  ColumnSettingsStore columnSettings;
+  RenderMask renderMask;
 
   // Corner area controls (top-left, above row headers)
   TextButton loadAllPluginsButton{"Load All"};
@@ -120,25 +186,56 @@ private:
   TextButton renderizableAllOnButton{"Renderizable All On"};
   TextButton renderizableAllOffButton{"Renderizable All Off"};
 
-  // Cells managed by the table
-  // OwnedArray<CellPad> cells; // REMOVED to fix double-ownership crash
+  // Progress overlay shown while row plugins are instantiated
+  struct LoadingOverlay : public Component {
+    explicit LoadingOverlay(double &progress);
+    void paint(Graphics &g) override;
+    void resized() override;
+
+    ProgressBar progressBar;
+  };
 
-  // Persistent state for cells (since components are virtualized)
-  std::vector<std::vector<bool>> cellRenderizableState;
+  double instantiationProgress = 0.0;
+  int instantiationTotal = 0;
+  std::set<PluginInstancePool::SlotId> instantiationPending;
+  LoadingOverlay loadingOverlay{instantiationProgress};
 
   int selectedRowIndex = -1;
 
   //==============================================================================
   void rebuildRowHeaders();
-  void rebuildTable();
+  void rebuildColumns();
+  RowHeader *createRowHeader(int row);
+  void layoutRowHeaders(int fromRow);
+  void invalidateVisibleComponents();
+  void updateVisibleComponents();
+  void refreshVisibleCells();
+  ColumnHeader *findVisibleColumnHeader(int column) const;
   void handleCellPlay(int row, int column);
+  RowData getRowKeyData(int rowIndex);
+  RenderManifest::JobInputs getCellInputs(const RowData &rowData,
+                                          int column) const;
+  File findRenderedClip(const RowData &rowData, int column) const;
+  void queuePreviewRenders();
   void handleCellStop(int row, int column);
   void handleRowSelection(int rowIndex);
-
-  MidiMessageSequence loadMidiFile(const File &file);
-  MidiMessageSequence applyTransformations(const MidiMessageSequence &seq,
-                                           int pitchOffset,
-                                           float velocityMultiplier);
+  void setActiveRow(int rowIndex);
+  void toggleRowLayer(int rowIndex);
+  void syncHostLayers();
+  void refreshRowMeters(bool detach = false);
+  void prewarmAroundRow(int rowIndex);
+  void handleInstanceCreated(PluginInstancePool::SlotId slot);
+  void handleInstanceReleased(AudioPluginInstance *instance);
+  void handlePrewarmFinished(PluginInstancePool::SlotId slot);
+
+  // The cue table is recompiled once per batch of edits
+  void handleAsyncUpdate() override;
+  void compileCues();
+
+  static MidiMessageSequence loadMidiFile(const File &file);
+  static MidiMessageSequence
+  applyTransformations(const MidiMessageSequence &seq, int pitchOffset,
+                       float velocityMultiplier);
 
   void loadPluginToAllRows();
 
@@ -13,8 +13,10 @@
 #include "RowHeader.h"
 
 //==============================================================================
-RowHeader::RowHeader(int variationIndex, ayra::PluginsManager &pm)
-    : index(variationIndex), pluginsManager(pm) {
+RowHeader::RowHeader(int variationIndex, ayra::PluginsManager &pm,
+                     PluginInstancePool &pool)
+    : index(variationIndex), pluginsManager(pm), instancePool(pool),
+      slotId(pool.createSlot()) {
   // Name label (editable)
   nameLabel.setText("Var " + String(index + 1), dontSendNotification);
   nameLabel.setEditable(true);
@@ -59,6 +61,9 @@ RowHeader::RowHeader(int variationIndex, ayra::PluginsManager &pm)
   volumeSlider.addListener(this);
   addAndMakeVisible(volumeSlider);
 
+  levelMeter.setInterceptsMouseClicks(false, false);
+  addChildComponent(levelMeter);
+
   // Volume label
   //  volumeLabel.setJustificationType(Justification::centred);
   //  volumeLabel.setFont(Font(10.0f));
@@ -67,11 +72,12 @@ RowHeader::RowHeader(int variationIndex, ayra::PluginsManager &pm)
 }
 
 RowHeader::~RowHeader() {
-  pluginEditorWindow = nullptr; // Close any open editor window
+  closePluginEditor(); // Close any open editor window
   loadPluginButton.removeListener(this);
   editPluginButton.removeListener(this);
   removePluginButton.removeListener(this);
   volumeSlider.removeListener(this);
+  instancePool.removeSlot(slotId);
 }
 
 //==============================================================================
@@ -86,8 +92,11 @@ void RowHeader::paint(Graphics &g) {
   g.setColour(bgColour);
   g.fillRoundedRectangle(getLocalBounds().reduced(2).toFloat(), 4.0f);
 
-  g.setColour(selected ? Colours::steelblue : Colours::grey);
-  g.drawRoundedRectangle(getLocalBounds().reduced(2).toFloat(), 4.0f, 1.0f);
+  g.setColour(selected  ? Colours::steelblue
+              : layered ? Colours::orange
+                        : Colours::grey);
+  g.drawRoundedRectangle(getLocalBounds().reduced(2).toFloat(), 4.0f,
+                         layered ? 2.0f : 1.0f);
 }
 
 void RowHeader::resized() {
@@ -113,6 +122,9 @@ void RowHeader::resized() {
   auto volumeRow = bounds.removeFromTop(20);
   //  volumeLabel.setBounds(volumeRow.removeFromRight(50));
   volumeSlider.setBounds(volumeRow);
+
+  bounds.removeFromTop(2);
+  levelMeter.setBounds(bounds.removeFromTop(6));
 }
 
 //==============================================================================
@@ -123,12 +135,46 @@ void RowHeader::setSelected(bool shouldBeSelected) {
   }
 }
 
-MemoryBlock RowHeader::getPluginState() const {
-  MemoryBlock state;
-  if (plugin != nullptr) {
-    plugin->getStateInformation(state);
+void RowHeader::setLayered(bool shouldBeLayered) {
+  if (layered != shouldBeLayered) {
+    layered = shouldBeLayered;
+    repaint();
   }
-  return state;
+}
+
+void RowHeader::setMeterSource(foleys::LevelMeterSource *source) {
+  levelMeter.setMeterSource(source);
+  levelMeter.setVisible(source != nullptr);
+}
+
+AudioPluginInstance *RowHeader::getPlugin() const {
+  return instancePool.getInstance(slotId);
+}
+
+AudioPluginInstance *RowHeader::acquirePlugin(String &errorMessage) {
+  return instancePool.acquire(slotId, errorMessage);
+}
+
+bool RowHeader::hasPlugin() const { return instancePool.hasPlugin(slotId); }
+
+PluginDescription RowHeader::getPluginDescription() const {
+  return instancePool.getDescription(slotId);
+}
+
+MemoryBlock RowHeader::getPluginState() const {
+  return instancePool.getState(slotId);
+}
+
+PluginInstancePool::StateLoader RowHeader::getPluginStateSnapshot() {
+  return instancePool.getStateSnapshot(slotId);
+}
+
+uint32 RowHeader::getPluginStateVersion() const {
+  return instancePool.getStateVersion(slotId);
+}
+
+uint64 RowHeader::getPluginStateHash() {
+  return instancePool.getStateHash(slotId);
 }
 
 void RowHeader::setVolumeDb(float db) {
@@ -181,20 +227,13 @@ void RowHeader::showPluginMenu() {
 void RowHeader::loadPlugin(const ayra::PluginDescriptionAndPreference &desc) {
   String errorMessage;
 
-  plugin = pluginsManager.createPluginInstance(desc,
+  auto plugin = pluginsManager.createPluginInstance(desc,
                                                44100.0, // Default sample rate
                                                2048,     // Default block size
                                                errorMessage);
 
   if (plugin != nullptr) {
-    pluginDesc = desc.pluginDescription;
-    pluginNameLabel.setText(plugin->getName(), dontSendNotification);
-    pluginNameLabel.setColour(Label::textColourId, Colours::white);
-    editPluginButton.setEnabled(true);
-    removePluginButton.setEnabled(true);
-
-    if (onPluginLoaded)
-      onPluginLoaded();
+    setPlugin(std::move(plugin), desc.pluginDescription);
   } else {
     AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
                                      "Plugin Load Error", errorMessage);
@@ -202,34 +241,57 @@ void RowHeader::loadPlugin(const ayra::PluginDescriptionAndPreference &desc) {
 }
 
 void RowHeader::removePlugin() {
-  pluginEditorWindow = nullptr; // Close any open editor
-  plugin.reset();
-  pluginDesc = {};
-  pluginNameLabel.setText("No plugin", dontSendNotification);
-  pluginNameLabel.setColour(Label::textColourId, Colours::grey);
-  editPluginButton.setEnabled(false);
-  removePluginButton.setEnabled(false);
+  closePluginEditor(); // Close any open editor
+  instancePool.clearSlot(slotId);
+  updatePluginControls();
 }
 
 void RowHeader::setPlugin(std::unique_ptr<AudioPluginInstance> newPlugin,
                           const PluginDescription &desc) {
-  pluginEditorWindow = nullptr; // Close any existing editor
-  plugin = std::move(newPlugin);
-  pluginDesc = desc;
+  if (newPlugin == nullptr)
+    return;
 
-  if (plugin != nullptr) {
-    pluginNameLabel.setText(plugin->getName(), dontSendNotification);
-    pluginNameLabel.setColour(Label::textColourId, Colours::white);
-    editPluginButton.setEnabled(true);
-    removePluginButton.setEnabled(true);
+  closePluginEditor(); // Close any existing editor
+  instancePool.setSlotPlugin(slotId, std::move(newPlugin), desc);
+  updatePluginControls();
+
+  if (onPluginLoaded)
+    onPluginLoaded();
+}
+
+void RowHeader::setPluginDescription(
+    const PluginDescription &desc, const MemoryBlock &state,
+    PluginInstancePool::StateLoader stateLoader) {
+  closePluginEditor();
+  instancePool.setSlotDescription(slotId, desc, state, std::move(stateLoader));
+  updatePluginControls();
+
+  if (onPluginLoaded)
+    onPluginLoaded();
+}
+
+void RowHeader::updatePluginControls() {
+  const bool loaded = hasPlugin();
 
-    if (onPluginLoaded)
-      onPluginLoaded();
+  // Use the description: the instance may not exist yet
+  pluginNameLabel.setText(loaded ? getPluginDescription().name : "No plugin",
+                          dontSendNotification);
+  pluginNameLabel.setColour(Label::textColourId,
+                            loaded ? Colours::white : Colours::grey);
+  editPluginButton.setEnabled(loaded);
+  removePluginButton.setEnabled(loaded);
+}
+
+void RowHeader::closePluginEditor() {
+  if (pluginEditorWindow.get()) {
+    pluginEditorWindow.reset();
+    instancePool.unpin(slotId);
+    repaint();
   }
 }
 
 void RowHeader::showPluginEditor() {
-  if (plugin == nullptr)
+  if (!hasPlugin())
     return;
 
   // If window already exists, bring to front
@@ -240,6 +302,14 @@ void RowHeader::showPluginEditor() {
     return;
   }
 
+  String errorMessage;
+  auto *plugin = acquirePlugin(errorMessage);
+  if (plugin == nullptr) {
+    AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon,
+                                     "Plugin Load Error", errorMessage);
+    return;
+  }
+
   // Create plugin editor
   auto *editor = plugin->createEditor();
   if (editor == nullptr) {
@@ -271,6 +341,7 @@ void RowHeader::showPluginEditor() {
   auto *window = new PluginEditorWindow(
       plugin->getName() + " - " + nameLabel.getText(), &pluginEditorWindow);
   pluginEditorWindow.reset(window);
+  instancePool.pin(slotId); // The editor references the instance
   window->setContentOwned(editor, true);
   window->setResizable(false, false);
   window->centreWithSize(editor->getWidth(), editor->getHeight());
@@ -281,6 +352,12 @@ void RowHeader::showPluginEditor() {
 
 //==============================================================================
 void RowHeader::mouseDown(const MouseEvent &e) {
+  if (e.mods.isCommandDown()) {
+    if (onLayerToggle)
+      onLayerToggle();
+    return;
+  }
+
   if (onSelected)
     onSelected();
 
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include "../Audio/PluginInstancePool.h"
 #include <JuceHeader.h>
 
 //==============================================================================
@@ -20,7 +21,8 @@ class RowHeader : public Component,
                   public Slider::Listener {
 public:
   //==============================================================================
-  RowHeader(int variationIndex, ayra::PluginsManager &pm);
+  RowHeader(int variationIndex, ayra::PluginsManager &pm,
+            PluginInstancePool &pool);
   ~RowHeader() override;
 
   //==============================================================================
@@ -33,14 +35,38 @@ public:
   void setSelected(bool selected);
   bool isSelected() const { return selected; }
 
-  AudioPluginInstance *getPlugin() const { return plugin.get(); }
-  PluginDescription getPluginDescription() const { return pluginDesc; }
+  // Layered rows play together with the active row
+  void setLayered(bool layered);
+  bool isLayered() const { return layered; }
+
+  // Level of the row's plugin while it is live in the host (nullptr hides)
+  void setMeterSource(foleys::LevelMeterSource *source);
+
+  // Live instance, or nullptr while the row's plugin is evicted
+  AudioPluginInstance *getPlugin() const;
+  // Live instance, instantiated on demand
+  AudioPluginInstance *acquirePlugin(String &errorMessage);
+  bool hasPlugin() const;
+
+  PluginDescription getPluginDescription() const;
   MemoryBlock getPluginState() const;
+  // See PluginInstancePool::getStateSnapshot
+  PluginInstancePool::StateLoader getPluginStateSnapshot();
+  uint32 getPluginStateVersion() const;
+  uint64 getPluginStateHash();
   String getVariationName() const { return nameLabel.getText(); }
+  void setVariationName(const String &name) {
+    nameLabel.setText(name, dontSendNotification);
+  }
+  PluginInstancePool::SlotId getSlotId() const { return slotId; }
 
   // Load plugin programmatically (for macro operations)
   void setPlugin(std::unique_ptr<AudioPluginInstance> newPlugin,
                  const PluginDescription &desc);
+  // Assign a plugin without instantiating it
+  void setPluginDescription(const PluginDescription &desc,
+                            const MemoryBlock &state,
+                            PluginInstancePool::StateLoader stateLoader = {});
 
   //==============================================================================
   // Volume control (-96dB as mute, to +12dB)
@@ -53,6 +79,7 @@ public:
   std::function<void()>
       onMacroToggle; // Called when macro toggle button clicked
   std::function<void(float)> onVolumeChanged;
+  std::function<void()> onLayerToggle; // Cmd/Ctrl-click on the header
 
   //==============================================================================
   // Button::Listener
@@ -66,19 +93,18 @@ public:
   }
 
   void showPluginEditor();
-  void closePluginEditor() {
-    if (pluginEditorWindow.get()) {
-      pluginEditorWindow.reset();
-    }
-  }
+  void closePluginEditor();
 
 private:
   //==============================================================================
   int index;
   bool selected = false;
+  bool layered = false;
   float volumeDb = 0.0f;
 
   ayra::PluginsManager &pluginsManager;
+  PluginInstancePool &instancePool;
+  PluginInstancePool::SlotId slotId;
 
   Label nameLabel;
   TextButton loadPluginButton{"Load"};
@@ -94,13 +120,14 @@ private:
 
   TextButton macroToggle{""}; // 30x30 toggle button at left
 
-  PluginDescription pluginDesc;
-  std::unique_ptr<AudioPluginInstance> plugin;
+  foleys::LevelMeter levelMeter{foleys::LevelMeter::MeterFlags(
+      foleys::LevelMeter::Horizontal | foleys::LevelMeter::Minimal)};
 
   //==============================================================================
   void showPluginMenu();
   void loadPlugin(const ayra::PluginDescriptionAndPreference &desc);
   void removePlugin();
+  void updatePluginControls();
 
   //  void updateVolumeLabel();
 
@@ -46,112 +46,252 @@ void OSCController::disconnect() {
 }
 
 //==============================================================================
-void OSCController::oscMessageReceived(const juce::OSCMessage &message) {
-  juce::String address = message.getAddressPattern().toString();
-  DBG("OSC: Received " + address);
+namespace {
+enum class Action {
+  cellPlay,
+  cellStop,
+  cellTrigger,
+  cellToggle,
+  pluginGuiToggle,
+  pluginGuiOpen,
+  pluginGuiClose,
+  panic,
+  renderStart,
+  renderCancel,
+  renderPriority,
+  renderPause,
+  renderResume,
+  renderWorkers,
+  projectLoad,
+  bpm,
+  variations
+};
 
-  // Parse address pattern
-  juce::StringArray parts;
-  parts.addTokens(address, "/", "");
-  parts.removeEmptyStrings();
+// '#' matches an unsigned integer argument
+struct Route {
+  const char *pattern;
+  Action action;
+};
 
-  if (parts.size() == 0)
-    return;
+constexpr Route routes[] = {
+    {"/cell/play/#/#", Action::cellPlay},
+    {"/cell/stop/#/#", Action::cellStop},
+    {"/cell/trigger/#/#", Action::cellTrigger}, // value 1=play, 0=stop
+    {"/cell/toggle/#/#", Action::cellToggle},   // play (legacy)
+    {"/plugin/gui/toggle/#", Action::pluginGuiToggle},
+    {"/plugin/gui/open/#", Action::pluginGuiOpen},
+    {"/plugin/gui/close/#", Action::pluginGuiClose},
+    {"/panic", Action::panic},
+    {"/render/start", Action::renderStart},   // [output folder]
+    {"/render/cancel", Action::renderCancel},
+    {"/render/priority/#/#", Action::renderPriority},
+    {"/render/pause", Action::renderPause},
+    {"/render/resume", Action::renderResume},
+    {"/render/workers", Action::renderWorkers}, // value, 0 = all cores
+    {"/project/load", Action::projectLoad},   // project file
+    {"/bpm", Action::bpm},                    // value
+    {"/variations", Action::variations},      // value
+};
 
-  // /cell/play/{row}/{column}
-  // /cell/stop/{row}/{column}
-  // /cell/trigger/{row}/{column} - value 1=play, 0=stop
-  if (parts[0] == "cell" && parts.size() >= 4) {
-    int row = parts[2].getIntValue();
-    int column = parts[3].getIntValue();
-
-    if (parts[1] == "play") {
-      if (onCellPlay)
-        juce::MessageManager::callAsync([this, row, column] {
-          if (onCellPlay)
-            onCellPlay(row, column);
-        });
-    } else if (parts[1] == "stop") {
-      if (onCellStop)
-        juce::MessageManager::callAsync([this, row, column] {
-          if (onCellStop)
-            onCellStop(row, column);
-        });
-    } else if (parts[1] == "trigger") {
-      // TouchOSC push button: value 1 = pressed, value 0 = released
-      float value = 0.0f;
-      if (message.size() > 0 && message[0].isFloat32())
-        value = message[0].getFloat32();
-      else if (message.size() > 0 && message[0].isInt32())
-        value = static_cast<float>(message[0].getInt32());
-
-      if (value > 0.5f) {
-        // Button pressed = play
-        if (onCellPlay)
-          juce::MessageManager::callAsync([this, row, column] {
-            if (onCellPlay)
-              onCellPlay(row, column);
-          });
-      } else {
-        // Button released = stop
-        if (onCellStop)
-          juce::MessageManager::callAsync([this, row, column] {
-            if (onCellStop)
-              onCellStop(row, column);
-          });
-      }
-    } else if (parts[1] == "toggle") {
-      // Toggle = play (legacy)
-      if (onCellPlay)
-        juce::MessageManager::callAsync([this, row, column] {
-          if (onCellPlay)
-            onCellPlay(row, column);
-        });
-    }
-  }
-  // /plugin/gui/toggle/{row}
-  // /plugin/gui/open/{row}
-  // /plugin/gui/close/{row}
-  else if (parts[0] == "plugin" && parts.size() >= 4) {
-    if (parts[1] == "gui") {
-      int row = parts[3].getIntValue();
-
-      if (parts[2] == "toggle") {
-        if (onPluginGuiToggle)
-          juce::MessageManager::callAsync([this, row] {
-            if (onPluginGuiToggle)
-              onPluginGuiToggle(row);
-          });
-      } else if (parts[2] == "open") {
-        if (onPluginGuiOpen)
-          juce::MessageManager::callAsync([this, row] {
-            if (onPluginGuiOpen)
-              onPluginGuiOpen(row);
-          });
-      } else if (parts[2] == "close") {
-        if (onPluginGuiClose)
-          juce::MessageManager::callAsync([this, row] {
-            if (onPluginGuiClose)
-              onPluginGuiClose(row);
-          });
-      }
+constexpr int maxRouteArgs = 2;
+
+// Walks the address in place: no tokenizing, no allocation
+bool matchRoute(const char *pattern, juce::String::CharPointerType address,
+                int *args) {
+  int numArgs = 0;
+
+  for (; *pattern != 0; ++pattern) {
+    if (*pattern == '#') {
+      if (!address.isDigit() || numArgs == maxRouteArgs)
+        return false;
+
+      int value = 0;
+      for (; address.isDigit(); ++address)
+        value = juce::jmin(value * 10 + static_cast<int>(*address - '0'),
+                           1 << 24);
+      args[numArgs++] = value;
+    } else {
+      if (*address != static_cast<juce::juce_wchar>(*pattern))
+        return false;
+      ++address;
     }
   }
-  // /panic
-  else if (parts[0] == "panic") {
-    if (onPanic)
-      juce::MessageManager::callAsync([this] {
-        if (onPanic)
-          onPanic();
-      });
-  }
+
+  return address.isEmpty();
+}
+
+float getFirstArgument(const juce::OSCMessage &message) {
+  if (message.size() > 0 && message[0].isFloat32())
+    return message[0].getFloat32();
+  if (message.size() > 0 && message[0].isInt32())
+    return static_cast<float>(message[0].getInt32());
+  return 0.0f;
+}
+
+juce::String getStringArgument(const juce::OSCMessage &message) {
+  if (message.size() > 0 && message[0].isString())
+    return message[0].getString();
+  return {};
+}
+
+// Later than this is more likely a sender clock that disagrees with ours
+constexpr double maxScheduleAheadMs = 10000.0;
+} // namespace
+
+//==============================================================================
+template <typename Callback, typename... Args>
+void OSCController::post(Callback &callback, Args... args) {
+  if (callback)
+    juce::MessageManager::callAsync([&callback, args...] {
+      if (callback)
+        callback(args...);
+    });
+}
+
+void OSCController::oscMessageReceived(const juce::OSCMessage &message) {
+  handleMessage(message, 0.0);
 }
 
 void OSCController::oscBundleReceived(const juce::OSCBundle &bundle) {
+  handleBundle(bundle, toMillisecondCounter(bundle.getTimeTag()));
+}
+
+void OSCController::handleBundle(const juce::OSCBundle &bundle,
+                                 double timeMs) {
   for (auto &element : bundle) {
-    if (element.isMessage())
-      oscMessageReceived(element.getMessage());
-    else if (element.isBundle())
-      oscBundleReceived(element.getBundle());
+    if (element.isMessage()) {
+      handleMessage(element.getMessage(), timeMs);
+    } else if (element.isBundle()) {
+      // A nested bundle may carry its own, later, time
+      auto &nested = element.getBundle();
+      handleBundle(nested, nested.getTimeTag().isImmediately()
+                               ? timeMs
+                               : toMillisecondCounter(nested.getTimeTag()));
+    }
+  }
+}
+
+void OSCController::handleMessage(const juce::OSCMessage &message,
+                                  double timeMs) {
+  const auto address = message.getAddressPattern().toString();
+
+  for (auto &route : routes) {
+    int args[maxRouteArgs] = {};
+    if (!matchRoute(route.pattern, address.getCharPointer(), args))
+      continue;
+
+    const int row = args[0];
+    const int column = args[1];
+
+    switch (route.action) {
+    case Action::cellPlay:
+    case Action::cellToggle:
+      playCell(row, column, timeMs);
+      break;
+
+    case Action::cellStop:
+      stopCell(row, column, timeMs);
+      break;
+
+    case Action::cellTrigger:
+      // TouchOSC push button: value 1 = pressed, value 0 = released
+      if (getFirstArgument(message) > 0.5f)
+        playCell(row, column, timeMs);
+      else
+        stopCell(row, column, timeMs);
+      break;
+
+    case Action::pluginGuiToggle:
+      post(onPluginGuiToggle, row);
+      break;
+
+    case Action::pluginGuiOpen:
+      post(onPluginGuiOpen, row);
+      break;
+
+    case Action::pluginGuiClose:
+      post(onPluginGuiClose, row);
+      break;
+
+    case Action::panic:
+      post(onPanic);
+      break;
+
+    case Action::renderStart:
+      post(onRenderStart, getStringArgument(message));
+      break;
+
+    case Action::renderCancel:
+      post(onRenderCancel);
+      break;
+
+    case Action::renderPriority:
+      post(onRenderPriority, row, column);
+      break;
+
+    case Action::renderPause:
+      post(onRenderPause);
+      break;
+
+    case Action::renderResume:
+      post(onRenderResume);
+      break;
+
+    case Action::renderWorkers:
+      post(onRenderWorkers, juce::roundToInt(getFirstArgument(message)));
+      break;
+
+    case Action::projectLoad:
+      post(onProjectLoad, getStringArgument(message));
+      break;
+
+    case Action::bpm:
+      post(onBpm, static_cast<double>(getFirstArgument(message)));
+      break;
+
+    case Action::variations:
+      post(onVariations, juce::roundToInt(getFirstArgument(message)));
+      break;
+    }
+
+    return;
   }
 }
+
+//==============================================================================
+void OSCController::playCell(int row, int column, double timeMs) {
+  lastPlayWasCued = onCellCue && onCellCue(row, column, timeMs);
+
+  // When cued it is already playing: the grid only has to catch up
+  if (lastPlayWasCued)
+    post(onCellCued, row, column);
+  else
+    post(onCellPlay, row, column);
+}
+
+void OSCController::stopCell(int row, int column, double timeMs) {
+  if (lastPlayWasCued && onStopCue && onStopCue(timeMs))
+    return;
+
+  post(onCellStop, row, column);
+}
+
+double OSCController::toMillisecondCounter(const juce::OSCTimeTag &timeTag) {
+  if (timeTag.isImmediately())
+    return 0.0;
+
+  // NTP time: seconds since 1900 in the high word, fraction in the low one
+  const auto raw = timeTag.getRawTimeTag();
+  constexpr double secondsFrom1900To1970 = 2208988800.0;
+  const double epochMs =
+      (static_cast<double>(raw >> 32) - secondsFrom1900To1970 +
+       static_cast<double>(raw & 0xffffffff) / 4294967296.0) *
+      1000.0;
+
+  const double delayMs =
+      epochMs - static_cast<double>(juce::Time::currentTimeMillis());
+  if (delayMs <= 0.0 || delayMs > maxScheduleAheadMs)
+    return 0.0; // Late, or not meant for this clock: play now
+
+  return juce::Time::getMillisecondCounterHiRes() + delayMs;
+}
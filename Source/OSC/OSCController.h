@@ -17,9 +17,13 @@
 #include <JuceHeader.h>
 
 //==============================================================================
+// Messages are decoded on the OSC receive thread. Cell triggers go straight
+// to the audio callback through onCellCue/onStopCue, scheduled at the
+// bundle's time tag; everything else (and cells that cannot be cued) is
+// forwarded to the message thread.
 class OSCController : public juce::OSCReceiver,
                       public juce::OSCReceiver::Listener<
-                          juce::OSCReceiver::MessageLoopCallback> {
+                          juce::OSCReceiver::RealtimeCallback> {
 public:
   //==============================================================================
   OSCController();
@@ -32,22 +36,55 @@ public:
   int getPort() const { return currentPort; }
 
   //==============================================================================
-  // Callbacks for external actions
+  // Called on the OSC thread. timeMs is a
+  // juce::Time::getMillisecondCounterHiRes() time, or 0 for immediately.
+  // Return false to have the trigger handled by onCellPlay/onCellStop.
+  std::function<bool(int row, int column, double timeMs)> onCellCue;
+  std::function<bool(double timeMs)> onStopCue;
+
+  // Callbacks for external actions, called on the message thread
   std::function<void(int row, int column)> onCellPlay;
   std::function<void(int row, int column)> onCellStop;
+  std::function<void(int row, int column)> onCellCued; // After onCellCue
   std::function<void(int row)> onPluginGuiToggle;
   std::function<void(int row)> onPluginGuiOpen;
   std::function<void(int row)> onPluginGuiClose;
   std::function<void()> onPanic;
 
+  // Batch and project control, for driving the app without its GUI
+  std::function<void(const juce::String &outputDir)> onRenderStart;
+  std::function<void()> onRenderCancel;
+  std::function<void(int row, int column)> onRenderPriority;
+  std::function<void()> onRenderPause;
+  std::function<void()> onRenderResume;
+  std::function<void(int maxWorkers)> onRenderWorkers;
+  std::function<void(const juce::String &projectFile)> onProjectLoad;
+  std::function<void(double bpm)> onBpm;
+  std::function<void(int numVariations)> onVariations;
+
 private:
   //==============================================================================
   void oscMessageReceived(const juce::OSCMessage &message) override;
   void oscBundleReceived(const juce::OSCBundle &bundle) override;
 
+  void handleMessage(const juce::OSCMessage &message, double timeMs);
+  void handleBundle(const juce::OSCBundle &bundle, double timeMs);
+  void playCell(int row, int column, double timeMs);
+  void stopCell(int row, int column, double timeMs);
+
+  // Runs a callback on the message thread if it is set
+  template <typename Callback, typename... Args>
+  void post(Callback &callback, Args... args);
+
+  static double toMillisecondCounter(const juce::OSCTimeTag &timeTag);
+
   //==============================================================================
   bool connected = false;
   int currentPort = 9000; // Default OSC port
 
+  // OSC thread only: a stop must not overtake a play that is still on its
+  // way through the message thread
+  bool lastPlayWasCued = false;
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OSCController)
 };
@@ -15,8 +15,9 @@
 #include "OSCSettingsComponent.h"
 
 //==============================================================================
-OSCSettingsComponent::OSCSettingsComponent(OSCController &controller)
-    : oscController(controller) {
+OSCSettingsComponent::OSCSettingsComponent(OSCController &controller,
+                                           OSCTelemetry &telemetry)
+    : oscController(controller), oscTelemetry(telemetry) {
 
   // Enable toggle
   enableToggle.setToggleState(oscController.isConnected(),
@@ -56,6 +57,52 @@ OSCSettingsComponent::OSCSettingsComponent(OSCController &controller)
   addAndMakeVisible(statusLabel);
   updateStatus();
 
+  // Telemetry output
+  telemetryToggle.setToggleState(oscTelemetry.isEnabled(),
+                                 dontSendNotification);
+  telemetryToggle.onClick = [this] {
+    oscTelemetry.setEnabled(telemetryToggle.getToggleState());
+  };
+  addAndMakeVisible(telemetryToggle);
+
+  addAndMakeVisible(telemetryTargetsLabel);
+  telemetryTargetsEditor.setText(oscTelemetry.getTargets(),
+                                 dontSendNotification);
+  telemetryTargetsEditor.setTextToShowWhenEmpty("host:port, host:port",
+                                                Colours::grey);
+  telemetryTargetsEditor.onReturnKey = [this] {
+    const bool ok = oscTelemetry.setTargets(telemetryTargetsEditor.getText());
+    telemetryTargetsEditor.setColour(TextEditor::outlineColourId,
+                                     ok ? Colours::transparentBlack
+                                        : Colours::red);
+    telemetryTargetsEditor.setText(oscTelemetry.getTargets(),
+                                   dontSendNotification);
+  };
+  telemetryTargetsEditor.onFocusLost = telemetryTargetsEditor.onReturnKey;
+  addAndMakeVisible(telemetryTargetsEditor);
+
+  addAndMakeVisible(telemetryRateLabel);
+  telemetryRateSlider.setSliderStyle(Slider::LinearBar);
+  telemetryRateSlider.setRange(1.0, 60.0, 1.0);
+  telemetryRateSlider.setValue(oscTelemetry.getRateHz(), dontSendNotification);
+  telemetryRateSlider.onValueChange = [this] {
+    oscTelemetry.setRateHz(roundToInt(telemetryRateSlider.getValue()));
+  };
+  addAndMakeVisible(telemetryRateSlider);
+
+  addAndMakeVisible(renderFolderLabel);
+  renderFolderEditor.setText(
+      ayra::app_properties->getUserSettings()->getValue("oscRenderOutputDir"),
+      dontSendNotification);
+  renderFolderEditor.setTextToShowWhenEmpty("Last render folder",
+                                            Colours::grey);
+  renderFolderEditor.onReturnKey = [this] {
+    ayra::app_properties->getUserSettings()->setValue(
+        "oscRenderOutputDir", renderFolderEditor.getText().trim());
+  };
+  renderFolderEditor.onFocusLost = renderFolderEditor.onReturnKey;
+  addAndMakeVisible(renderFolderEditor);
+
   // Protocol info
   String protocolText = "OSC Protocol:\n"
                         "  /cell/play/{row}/{col}  - Play cell\n"
@@ -63,7 +110,15 @@ OSCSettingsComponent::OSCSettingsComponent(OSCController &controller)
                         "  /plugin/gui/toggle/{row} - Toggle plugin GUI\n"
                         "  /plugin/gui/open/{row}  - Open plugin GUI\n"
                         "  /plugin/gui/close/{row} - Close plugin GUI\n"
-                        "  /panic                  - Stop all";
+                        "  /panic                  - Stop all\n"
+                        "  /render/start [folder], /render/cancel\n"
+                        "  /render/priority/{row}/{col}\n"
+                        "  /project/load {file}, /bpm {n}, /variations {n}\n"
+                        "Telemetry out (under /fpc):\n"
+                        "  /render/active, /render/progress, /render/jobs\n"
+                        "  /render/rate, /render/eta, /render/failed\n"
+                        "  /render/row/{row}/progress\n"
+                        "  /cpu, /meter/peak, /meter/rms, /ack";
   protocolInfoLabel.setText(protocolText, dontSendNotification);
   protocolInfoLabel.setJustificationType(Justification::topLeft);
   protocolInfoLabel.setFont(
@@ -90,6 +145,23 @@ void OSCSettingsComponent::resized() {
   bounds.removeFromTop(10);
   statusLabel.setBounds(bounds.removeFromTop(25));
 
+  bounds.removeFromTop(10);
+  auto row2 = bounds.removeFromTop(30);
+  telemetryToggle.setBounds(row2.removeFromLeft(120));
+  row2.removeFromLeft(10);
+  telemetryRateLabel.setBounds(row2.removeFromLeft(30));
+  telemetryRateSlider.setBounds(row2.removeFromLeft(60));
+
+  bounds.removeFromTop(5);
+  auto row3 = bounds.removeFromTop(26);
+  telemetryTargetsLabel.setBounds(row3.removeFromLeft(30));
+  telemetryTargetsEditor.setBounds(row3);
+
+  bounds.removeFromTop(5);
+  auto row4 = bounds.removeFromTop(26);
+  renderFolderLabel.setBounds(row4.removeFromLeft(70));
+  renderFolderEditor.setBounds(row4);
+
   bounds.removeFromTop(20);
   protocolInfoLabel.setBounds(bounds);
 }
@@ -15,13 +15,14 @@
 #pragma once
 
 #include "OSCController.h"
+#include "OSCTelemetry.h"
 #include <JuceHeader.h>
 
 //==============================================================================
 class OSCSettingsComponent : public Component {
 public:
   //==============================================================================
-  OSCSettingsComponent(OSCController &controller);
+  OSCSettingsComponent(OSCController &controller, OSCTelemetry &telemetry);
   ~OSCSettingsComponent() override = default;
 
   //==============================================================================
@@ -31,6 +32,7 @@ public:
 private:
   //==============================================================================
   OSCController &oscController;
+  OSCTelemetry &oscTelemetry;
 
   ToggleButton enableToggle{"Enable OSC"};
   Label portLabel{{}, "Port:"};
@@ -38,6 +40,17 @@ private:
   TextButton applyButton{"Apply"};
   Label statusLabel{{}, "Status: Disconnected"};
 
+  // Telemetry output
+  ToggleButton telemetryToggle{"Send telemetry"};
+  Label telemetryTargetsLabel{{}, "To:"};
+  TextEditor telemetryTargetsEditor;
+  Label telemetryRateLabel{{}, "Hz:"};
+  Slider telemetryRateSlider;
+
+  // Output folder for /render/start without an argument
+  Label renderFolderLabel{{}, "Render to:"};
+  TextEditor renderFolderEditor;
+
   // Protocol info
   Label protocolInfoLabel;
 
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    OSCTelemetry.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    OSC status output for monitoring and TouchOSC panels
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "OSCTelemetry.h"
+
+//==============================================================================
+OSCTelemetry::OSCTelemetry(PluginHost &host) : pluginHost(host) {
+  auto *userSettings = ayra::app_properties->getUserSettings();
+  rateHz = juce::jlimit(1, 60, userSettings->getIntValue("oscTelemetryRateHz",
+                                                         rateHz));
+  setTargets(userSettings->getValue("oscTelemetryTargets", "127.0.0.1:9001"));
+  setEnabled(userSettings->getBoolValue("oscTelemetryEnabled", false));
+}
+
+OSCTelemetry::~OSCTelemetry() { stopTimer(); }
+
+//==============================================================================
+void OSCTelemetry::setEnabled(bool shouldBeEnabled) {
+  enabled = shouldBeEnabled;
+  ayra::app_properties->getUserSettings()->setValue("oscTelemetryEnabled",
+                                                    enabled);
+  updateTimer();
+}
+
+bool OSCTelemetry::setTargets(const juce::String &targetList) {
+  juce::StringArray entries;
+  entries.addTokens(targetList, ", ", "");
+  entries.removeEmptyStrings();
+
+  senders.clear();
+  bool allConnected = true;
+
+  for (auto &entry : entries) {
+    const auto host = entry.upToLastOccurrenceOf(":", false, false);
+    const int port =
+        entry.fromLastOccurrenceOf(":", false, false).getIntValue();
+
+    auto sender = std::make_unique<juce::OSCSender>();
+    if (host.isEmpty() || port <= 0 || port > 65535 ||
+        !sender->connect(host, port)) {
+      DBG("OSC telemetry: cannot send to " + entry);
+      allConnected = false;
+      continue;
+    }
+
+    senders.add(sender.release());
+  }
+
+  targets = entries.joinIntoString(", ");
+  ayra::app_properties->getUserSettings()->setValue("oscTelemetryTargets",
+                                                    targets);
+  updateTimer();
+  return allConnected;
+}
+
+void OSCTelemetry::setRateHz(int newRateHz) {
+  rateHz = juce::jlimit(1, 60, newRateHz);
+  ayra::app_properties->getUserSettings()->setValue("oscTelemetryRateHz",
+                                                    rateHz);
+  updateTimer();
+}
+
+void OSCTelemetry::sendAck(const juce::String &command, bool succeeded,
+                           const juce::String &detail) {
+  DBG("OSC ack: " + command + (succeeded ? " ok " : " refused ") + detail);
+
+  std::vector<juce::OSCMessage> messages;
+  messages.emplace_back("/fpc/ack", command, succeeded ? 1 : 0, detail);
+  send(messages);
+}
+
+void OSCTelemetry::updateTimer() {
+  if (enabled && !senders.isEmpty())
+    startTimerHz(rateHz);
+  else
+    stopTimer();
+}
+
+//==============================================================================
+void OSCTelemetry::timerCallback() {
+  std::vector<juce::OSCMessage> messages;
+  addRenderStatus(messages);
+  addAudioStatus(messages);
+  send(messages);
+}
+
+void OSCTelemetry::beginRenderPass() {
+  lastFinishedJobs = 0;
+  lastTickMs = juce::Time::getMillisecondCounterHiRes();
+  jobsPerSecond = 0.0;
+  failuresSent = 0;
+}
+
+void OSCTelemetry::addRenderStatus(std::vector<juce::OSCMessage> &messages) {
+  auto *renderer = getRenderer != nullptr ? getRenderer() : nullptr;
+  const double nowMs = juce::Time::getMillisecondCounterHiRes();
+
+  const bool active = renderer != nullptr && renderer->isRendering();
+  messages.emplace_back("/fpc/render/active", active ? 1 : 0);
+
+  if (renderer == nullptr)
+    return;
+
+  const int completed = renderer->getCompletedJobs();
+  const int failed = renderer->getFailedJobs();
+  const int finished = completed + failed;
+
+  // Smoothed over about a second, whatever the tick rate
+  const double elapsed = (nowMs - lastTickMs) / 1000.0;
+  if (elapsed > 0.0) {
+    const double instant = (finished - lastFinishedJobs) / elapsed;
+    const double smoothing = juce::jmin(1.0, elapsed);
+    jobsPerSecond += (instant - jobsPerSecond) * smoothing;
+  }
+  lastFinishedJobs = finished;
+  lastTickMs = nowMs;
+
+  messages.emplace_back("/fpc/render/progress", renderer->getProgress());
+  messages.emplace_back("/fpc/render/jobs", completed, failed,
+                        renderer->getTotalJobs());
+  messages.emplace_back("/fpc/render/rate",
+                        static_cast<float>(jobsPerSecond));
+  messages.emplace_back(
+      "/fpc/render/eta",
+      static_cast<float>(renderer->getEstimatedSecondsRemaining()));
+
+  for (auto &row : renderer->getRowProgress()) {
+    const float progress =
+        row.totalJobs > 0 ? row.finishedJobs / static_cast<float>(row.totalJobs)
+                          : 1.0f;
+    messages.emplace_back(
+        juce::OSCAddressPattern("/fpc/render/row/" +
+                                juce::String(row.rowIndex) + "/progress"),
+        progress);
+  }
+
+  // Failures are events: each one is sent once
+  for (auto &failure : renderer->getFailedJobsSince(failuresSent)) {
+    messages.emplace_back("/fpc/render/failed", failure.rowIndex,
+                          failure.columnIndex, failure.error);
+    failuresSent++;
+  }
+}
+
+void OSCTelemetry::addAudioStatus(std::vector<juce::OSCMessage> &messages) {
+  messages.emplace_back("/fpc/cpu",
+                        static_cast<float>(pluginHost.getCpuLoad()));
+
+  auto *meter = pluginHost.getMeterSource();
+  if (meter == nullptr)
+    return;
+
+  // Linear gain, one argument per channel
+  juce::OSCMessage peak("/fpc/meter/peak");
+  juce::OSCMessage rms("/fpc/meter/rms");
+  for (int ch = 0; ch < meter->getNumChannels(); ++ch) {
+    peak.addFloat32(meter->getMaxLevel(ch));
+    rms.addFloat32(meter->getRMSLevel(ch));
+  }
+
+  messages.push_back(std::move(peak));
+  messages.push_back(std::move(rms));
+}
+
+void OSCTelemetry::send(const std::vector<juce::OSCMessage> &messages) {
+  for (size_t start = 0; start < messages.size();
+       start += maxMessagesPerBundle) {
+    juce::OSCBundle bundle;
+    const auto end =
+        juce::jmin(messages.size(), start + (size_t)maxMessagesPerBundle);
+    for (auto i = start; i < end; ++i)
+      bundle.addElement(messages[i]);
+
+    for (auto *sender : senders)
+      sender->send(bundle);
+  }
+}
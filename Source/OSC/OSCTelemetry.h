@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    OSCTelemetry.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    OSC status output for monitoring and TouchOSC panels
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Publishes render progress (overall and per row), throughput, ETA,
+    failed jobs, CPU load and the output meter to a list of targets at a
+    fixed rate. Each tick goes out as a few bundles rather than one packet
+    per value.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Audio/PluginHost.h"
+#include "../Rendering/ParallelBatchRenderer.h"
+#include <JuceHeader.h>
+
+//==============================================================================
+class OSCTelemetry : private juce::Timer {
+public:
+  //==============================================================================
+  explicit OSCTelemetry(PluginHost &host);
+  ~OSCTelemetry() override;
+
+  //==============================================================================
+  // Settings are persisted as they are changed
+  void setEnabled(bool shouldBeEnabled);
+  bool isEnabled() const { return enabled; }
+
+  // "host:port" entries, separated by commas or spaces. Returns false if
+  // any entry could not be used.
+  bool setTargets(const juce::String &targetList);
+  juce::String getTargets() const { return targets; }
+
+  void setRateHz(int newRateHz);
+  int getRateHz() const { return rateHz; }
+
+  // The batch renderer to report on, or nullptr when idle
+  std::function<ParallelBatchRenderer *()> getRenderer;
+
+  // Call when a render pass starts: throughput and the failures already
+  // sent are counted from zero again
+  void beginRenderPass();
+
+  // Reply to a remote command: /fpc/ack <command> <1 = done, 0 = refused>
+  // <detail>. Sent to the targets even while periodic telemetry is off.
+  void sendAck(const juce::String &command, bool succeeded,
+               const juce::String &detail = {});
+
+private:
+  //==============================================================================
+  void timerCallback() override;
+  void updateTimer();
+
+  void addRenderStatus(std::vector<juce::OSCMessage> &messages);
+  void addAudioStatus(std::vector<juce::OSCMessage> &messages);
+  void send(const std::vector<juce::OSCMessage> &messages);
+
+  //==============================================================================
+  PluginHost &pluginHost;
+
+  bool enabled = false;
+  juce::String targets;
+  int rateHz = 10;
+  juce::OwnedArray<juce::OSCSender> senders; // One per target
+
+  // Throughput, measured between ticks
+  int lastFinishedJobs = 0;
+  double lastTickMs = 0.0;
+  double jobsPerSecond = 0.0;
+  int failuresSent = 0;
+
+  // Keeps each bundle well inside a UDP datagram
+  static constexpr int maxMessagesPerBundle = 32;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OSCTelemetry)
+};
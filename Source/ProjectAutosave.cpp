@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    ProjectAutosave.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "ProjectAutosave.h"
+#include "Rendering/ContentHash.h"
+
+static const char *const sessionOpenKey = "autosaveSessionOpen";
+
+//==============================================================================
+ProjectAutosave::ProjectAutosave() : Thread("Project Autosave") {
+  auto *userSettings = ayra::app_properties->getUserSettings();
+  numRecoveryFiles =
+      jlimit(1, 20, userSettings->getIntValue("autosaveRecoveryFiles", 3));
+
+  // Cleared again on a clean shutdown
+  previousSessionCrashed = userSettings->getBoolValue(sessionOpenKey, false);
+  userSettings->setValue(sessionOpenKey, true);
+  userSettings->saveIfNeeded();
+
+  startThread(Thread::Priority::background);
+  setIntervalSeconds(
+      userSettings->getIntValue("autosaveIntervalSeconds", 120));
+}
+
+ProjectAutosave::~ProjectAutosave() {
+  stopTimer();
+
+  // Wakes the writer; a write in progress is allowed to finish
+  notify();
+  stopThread(30000);
+
+  auto *userSettings = ayra::app_properties->getUserSettings();
+  userSettings->setValue(sessionOpenKey, false);
+  userSettings->saveIfNeeded();
+}
+
+//==============================================================================
+void ProjectAutosave::setIntervalSeconds(int seconds) {
+  intervalSeconds = jmax(0, seconds);
+  ayra::app_properties->getUserSettings()->setValue("autosaveIntervalSeconds",
+                                                    intervalSeconds);
+
+  if (intervalSeconds > 0)
+    startTimer(intervalSeconds * 1000);
+  else
+    stopTimer();
+}
+
+File ProjectAutosave::takeRecoveryFile() {
+  if (!previousSessionCrashed)
+    return {};
+
+  previousSessionCrashed = false;
+
+  const File newest = getNewestRecoveryFile();
+  if (newest == File())
+    return {};
+
+  const File recovered = getRecoveryFolder().getChildFile("Recovered.fpc");
+  return newest.moveFileTo(recovered) ? recovered : File();
+}
+
+//==============================================================================
+void ProjectAutosave::timerCallback() {
+  if (getSnapshot == nullptr || writing)
+    return;
+
+  {
+    const ScopedLock sl(lock);
+    if (pending != nullptr)
+      return; // The writer has not picked up the last one yet
+  }
+
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->data = getSnapshot();
+  if (getStateFingerprint != nullptr)
+    snapshot->stateFingerprint = getStateFingerprint();
+
+  {
+    const ScopedLock sl(lock);
+    pending = std::move(snapshot);
+  }
+
+  notify();
+}
+
+void ProjectAutosave::run() {
+  while (!threadShouldExit()) {
+    std::unique_ptr<Snapshot> snapshot;
+    {
+      const ScopedLock sl(lock);
+      snapshot = std::move(pending);
+    }
+
+    if (snapshot == nullptr) {
+      wait(-1);
+      continue;
+    }
+
+    const uint64 hash =
+        ContentHash()
+            .add(static_cast<int64>(snapshot->stateFingerprint))
+            .add(static_cast<int64>(
+                ProjectSerializer::getSettingsHash(snapshot->data)))
+            .getValue();
+    if (hash == lastSavedHash)
+      continue; // Nothing changed since the last autosave
+
+    writing = true;
+
+    // Plugin state still in the project file is read here, off the
+    // message thread
+    const File file = getNextRecoveryFile();
+    if (file.getParentDirectory().createDirectory().wasOk() &&
+        ProjectSerializer::saveProject(file, snapshot->data)) {
+      lastSavedHash = hash;
+      DBG("Autosaved to " + file.getFullPathName());
+    } else {
+      DBG("Autosave failed: " + file.getFullPathName());
+    }
+
+    writing = false;
+  }
+}
+
+//==============================================================================
+File ProjectAutosave::getNextRecoveryFile() const {
+  // The first free slot, otherwise the oldest snapshot
+  File oldest;
+  for (int i = 1; i <= numRecoveryFiles; ++i) {
+    auto file = getRecoveryFolder().getChildFile("Autosave " + String(i) +
+                                                 ".fpc");
+    if (!file.existsAsFile())
+      return file;
+
+    if (oldest == File() ||
+        file.getLastModificationTime() < oldest.getLastModificationTime())
+      oldest = file;
+  }
+  return oldest;
+}
+
+File ProjectAutosave::getNewestRecoveryFile() const {
+  File newest;
+  for (int i = 1; i <= numRecoveryFiles; ++i) {
+    auto file = getRecoveryFolder().getChildFile("Autosave " + String(i) +
+                                                 ".fpc");
+    if (file.existsAsFile() &&
+        (newest == File() ||
+         file.getLastModificationTime() > newest.getLastModificationTime()))
+      newest = file;
+  }
+  return newest;
+}
+
+File ProjectAutosave::getRecoveryFolder() {
+  return ayra::app_properties->getUserSettings()->getFile().getSiblingFile(
+      "Recovery");
+}
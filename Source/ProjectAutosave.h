@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ProjectAutosave.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Periodic crash-recovery snapshots of the open project. The snapshot is
+    taken on the message thread, where only plugins that reported a change
+    are asked for their state; serializing and writing happen on a
+    background thread. Snapshots rotate through a small ring of files, and
+    are offered back on the next start if the session did not end cleanly.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ProjectSerializer.h"
+#include <JuceHeader.h>
+
+//==============================================================================
+class ProjectAutosave : private Timer, private Thread {
+public:
+  //==============================================================================
+  ProjectAutosave();
+  ~ProjectAutosave() override;
+
+  //==============================================================================
+  // Message thread, once per interval: the project to save, and a value
+  // that changes whenever plugin state does (the rest is compared by hash)
+  std::function<ProjectSerializer::ProjectData()> getSnapshot;
+  std::function<uint64()> getStateFingerprint;
+
+  void setIntervalSeconds(int seconds); // 0 disables autosave
+  int getIntervalSeconds() const { return intervalSeconds; }
+
+  // Newest snapshot left by a session that did not shut down cleanly, or
+  // File(). It is moved out of the ring, so later autosaves never overwrite
+  // a file whose plugin state is still being read from.
+  File takeRecoveryFile();
+
+private:
+  //==============================================================================
+  struct Snapshot {
+    ProjectSerializer::ProjectData data;
+    uint64 stateFingerprint = 0;
+  };
+
+  int intervalSeconds = 0;
+  int numRecoveryFiles = 3;
+  bool previousSessionCrashed = false;
+
+  CriticalSection lock;
+  std::unique_ptr<Snapshot> pending;
+  std::atomic<bool> writing{false};
+  uint64 lastSavedHash = 0; // Writer thread only
+
+  //==============================================================================
+  void timerCallback() override;
+  void run() override;
+
+  File getNextRecoveryFile() const;
+  File getNewestRecoveryFile() const;
+  static File getRecoveryFolder();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectAutosave)
+};
@@ -11,20 +11,39 @@
 */
 
 #include "ProjectSerializer.h"
+#include "Rendering/ContentHash.h"
+#include "TraceRecorder.h"
+#include <map>
 
 const char *const ProjectSerializer::projectFileExtension = ".fpc";
 const char *const ProjectSerializer::projectTagName = "FastPackCreatorProject";
 
+// Binary layout, little endian:
+//   header  magic, version, chunk count, reserved       (4 x uint32)
+//   index   type, id, offset, stored size, raw size     (per chunk)
+//   chunks  zlib compressed, in index order
+static constexpr uint32 binaryMagic = ByteOrder::makeInt('F', 'P', 'C', '2');
+static constexpr uint32 binaryVersion = 2;
+static constexpr uint32 settingsChunkType =
+    ByteOrder::makeInt('M', 'E', 'T', 'A');
+static constexpr uint32 stateChunkType = ByteOrder::makeInt('S', 'T', 'A', 'T');
+static constexpr int64 headerSize = 16;
+static constexpr int64 indexEntrySize = 36;
+static constexpr uint32 maxChunks = 1 << 16;
+
 //==============================================================================
 bool ProjectSerializer::saveProject(const File &file, const ProjectData &data) {
-  auto xml = toXml(data);
-  if (xml == nullptr)
-    return false;
-
-  return xml->writeTo(file);
+  TRACE_SCOPE("Project", "Project save");
+  return saveBinary(file, data);
 }
 
 bool ProjectSerializer::loadProject(const File &file, ProjectData &data) {
+  TRACE_SCOPE("Project", "Project load");
+
+  if (isBinaryProject(file))
+    return loadBinary(file, data);
+
+  // Projects saved before the binary format
   auto xml = XmlDocument::parse(file);
   if (xml == nullptr)
     return false;
@@ -32,8 +51,241 @@ bool ProjectSerializer::loadProject(const File &file, ProjectData &data) {
   return fromXml(*xml, data);
 }
 
+//==============================================================================
+bool ProjectSerializer::saveBinary(const File &file, const ProjectData &data) {
+  // Rows still backed by a project file are read once here, so the new
+  // file never depends on the old one
+  std::vector<MemoryBlock> loadedStates;
+  loadedStates.reserve(static_cast<size_t>(data.rows.size()));
+
+  Array<uint64> stateHashes;
+  std::map<uint64, const MemoryBlock *> uniqueStates;
+
+  for (auto &row : data.rows) {
+    const MemoryBlock *state = &row.pluginState;
+    if (state->getSize() == 0 && row.pluginStateLoader != nullptr) {
+      loadedStates.push_back(row.pluginStateLoader());
+      state = &loadedStates.back();
+    }
+
+    if (state->getSize() == 0) {
+      stateHashes.add(0);
+      continue;
+    }
+
+    // Identical states (duplicated rows, same preset) are stored once
+    const uint64 hash = ContentHash().add(*state).getValue();
+    stateHashes.add(hash);
+    uniqueStates.emplace(hash, state);
+  }
+
+  auto xml = createXml(data, &stateHashes);
+  if (xml == nullptr)
+    return false;
+  const String settingsText = xml->toString();
+
+  const auto numChunks = static_cast<uint32>(1 + uniqueStates.size());
+  Array<ChunkInfo> index;
+
+  // Written next to the target and moved into place, so a failed save
+  // leaves the previous project intact
+  TemporaryFile temp(file);
+  {
+    FileOutputStream out(temp.getFile());
+    if (!out.openedOk())
+      return false;
+
+    out.writeInt(static_cast<int>(binaryMagic));
+    out.writeInt(static_cast<int>(binaryVersion));
+    out.writeInt(static_cast<int>(numChunks));
+    out.writeInt(0);
+
+    // Placeholder index, filled in once the chunk sizes are known
+    out.writeRepeatedByte(0, static_cast<size_t>(numChunks * indexEntrySize));
+
+    auto utf8 = settingsText.toUTF8();
+    if (!writeChunk(out, settingsChunkType, 0, utf8.getAddress(),
+                    utf8.sizeInBytes() - 1, index))
+      return false;
+
+    for (auto &[hash, state] : uniqueStates)
+      if (!writeChunk(out, stateChunkType, hash, state->getData(),
+                      state->getSize(), index))
+        return false;
+
+    if (!out.setPosition(headerSize))
+      return false;
+
+    for (auto &chunk : index) {
+      out.writeInt(static_cast<int>(chunk.type));
+      out.writeInt64(static_cast<int64>(chunk.id));
+      out.writeInt64(chunk.offset);
+      out.writeInt64(chunk.storedSize);
+      out.writeInt64(chunk.rawSize);
+    }
+
+    out.flush();
+    if (out.getStatus().failed())
+      return false;
+  }
+
+  return temp.overwriteTargetFileWithTemporary();
+}
+
+bool ProjectSerializer::loadBinary(const File &file, ProjectData &data) {
+  Array<ChunkInfo> index;
+  if (!readIndex(file, index))
+    return false;
+
+  const ChunkInfo *settingsChunk = nullptr;
+  for (auto &chunk : index)
+    if (chunk.type == settingsChunkType)
+      settingsChunk = &chunk;
+
+  if (settingsChunk == nullptr)
+    return false;
+
+  const auto settingsText = readChunk(file, *settingsChunk);
+  auto xml = parseXML(settingsText.toString());
+  if (xml == nullptr || !fromXml(*xml, data))
+    return false;
+
+  // Hook each row up to its state chunk; nothing is read until needed
+  auto *rowsXml = xml->getChildByName("Rows");
+  if (rowsXml == nullptr)
+    return true;
+
+  int rowIndex = 0;
+  for (auto *rowXml : rowsXml->getChildWithTagNameIterator("Row")) {
+    if (rowIndex >= data.rows.size())
+      break;
+
+    auto &row = data.rows.getReference(rowIndex++);
+    const String hashText = rowXml->getStringAttribute("stateHash");
+    if (hashText.isEmpty())
+      continue;
+
+    // A missing chunk fails when the state is read, like a damaged one
+    const auto id = static_cast<uint64>(hashText.getHexValue64());
+    row.pluginStateLoader = [file, id] { return readState(file, id); };
+  }
+
+  return true;
+}
+
+bool ProjectSerializer::readIndex(const File &file, Array<ChunkInfo> &index) {
+  FileInputStream in(file);
+  if (!in.openedOk())
+    return false;
+
+  const auto magic = static_cast<uint32>(in.readInt());
+  const auto version = static_cast<uint32>(in.readInt());
+  const auto numChunks = static_cast<uint32>(in.readInt());
+  in.readInt(); // Reserved
+
+  if (magic != binaryMagic || version != binaryVersion || numChunks == 0 ||
+      numChunks > maxChunks)
+    return false;
+
+  const int64 fileSize = in.getTotalLength();
+
+  for (uint32 i = 0; i < numChunks; ++i) {
+    ChunkInfo chunk;
+    chunk.type = static_cast<uint32>(in.readInt());
+    chunk.id = static_cast<uint64>(in.readInt64());
+    chunk.offset = in.readInt64();
+    chunk.storedSize = in.readInt64();
+    chunk.rawSize = in.readInt64();
+
+    if (chunk.offset < headerSize || chunk.storedSize < 0 ||
+        chunk.rawSize < 0 || chunk.offset + chunk.storedSize > fileSize)
+      return false;
+
+    index.add(chunk);
+  }
+
+  return true;
+}
+
+MemoryBlock ProjectSerializer::readState(const File &file, uint64 id) {
+  // Looked up by hash on every read rather than by a remembered offset:
+  // saving over the project moves the chunks around, but keeps every
+  // state that was loaded from it
+  Array<ChunkInfo> index;
+  if (readIndex(file, index)) {
+    for (auto &chunk : index) {
+      if (chunk.type != stateChunkType || chunk.id != id)
+        continue;
+
+      auto state = readChunk(file, chunk);
+      if (ContentHash().add(state).getValue() == id)
+        return state;
+    }
+  }
+
+  DBG("Plugin state chunk missing or damaged: " + file.getFullPathName());
+  return {};
+}
+
+uint64 ProjectSerializer::getSettingsHash(const ProjectData &data) {
+  Array<uint64> noState;
+  noState.insertMultiple(0, 0, data.rows.size());
+
+  auto xml = createXml(data, &noState);
+  return xml != nullptr ? ContentHash().add(xml->toString()).getValue() : 0;
+}
+
+bool ProjectSerializer::isBinaryProject(const File &file) {
+  FileInputStream in(file);
+  return in.openedOk() && static_cast<uint32>(in.readInt()) == binaryMagic;
+}
+
+bool ProjectSerializer::writeChunk(OutputStream &out, uint32 type, uint64 id,
+                                   const void *data, size_t numBytes,
+                                   Array<ChunkInfo> &index) {
+  ChunkInfo chunk;
+  chunk.type = type;
+  chunk.id = id;
+  chunk.offset = out.getPosition();
+  chunk.rawSize = static_cast<int64>(numBytes);
+
+  {
+    GZIPCompressorOutputStream compressor(out);
+    if (!compressor.write(data, numBytes))
+      return false;
+  }
+
+  chunk.storedSize = out.getPosition() - chunk.offset;
+  index.add(chunk);
+  return true;
+}
+
+MemoryBlock ProjectSerializer::readChunk(const File &file,
+                                         const ChunkInfo &chunk) {
+  FileInputStream in(file);
+  if (!in.openedOk())
+    return {};
+
+  SubregionStream region(&in, chunk.offset, chunk.storedSize, false);
+  GZIPDecompressorInputStream decompressor(
+      &region, false, GZIPDecompressorInputStream::zlibFormat, chunk.rawSize);
+
+  MemoryBlock result;
+  if (decompressor.readIntoMemoryBlock(result, chunk.rawSize) !=
+      static_cast<size_t>(chunk.rawSize))
+    return {};
+
+  return result;
+}
+
 //==============================================================================
 std::unique_ptr<XmlElement> ProjectSerializer::toXml(const ProjectData &data) {
+  return createXml(data, nullptr);
+}
+
+std::unique_ptr<XmlElement>
+ProjectSerializer::createXml(const ProjectData &data,
+                             const Array<uint64> *stateHashes) {
   auto xml = std::make_unique<XmlElement>(projectTagName);
 
   // Settings
@@ -49,7 +301,8 @@ std::unique_ptr<XmlElement> ProjectSerializer::toXml(const ProjectData &data) {
 
   // Rows
   auto rowsXml = xml->createNewChildElement("Rows");
-  for (auto &row : data.rows) {
+  for (int i = 0; i < data.rows.size(); ++i) {
+    auto &row = data.rows.getReference(i);
     auto rowXml = rowsXml->createNewChildElement("Row");
     rowXml->setAttribute("name", row.name);
     rowXml->setAttribute("volumeDb", row.volumeDb);
@@ -63,9 +316,19 @@ std::unique_ptr<XmlElement> ProjectSerializer::toXml(const ProjectData &data) {
     }
 
     // Plugin state
-    if (row.pluginState.getSize() > 0) {
-      auto stateXml = rowXml->createNewChildElement("PluginState");
-      stateXml->addTextElement(row.pluginState.toBase64Encoding());
+    if (stateHashes != nullptr) {
+      if (const auto hash = (*stateHashes)[i]; hash != 0)
+        rowXml->setAttribute(
+            "stateHash", String::toHexString(static_cast<int64>(hash)));
+    } else {
+      const auto state = row.pluginState.getSize() == 0 &&
+                                 row.pluginStateLoader != nullptr
+                             ? row.pluginStateLoader()
+                             : row.pluginState;
+      if (state.getSize() > 0) {
+        auto stateXml = rowXml->createNewChildElement("PluginState");
+        stateXml->addTextElement(state.toBase64Encoding());
+      }
     }
   }
 
@@ -7,6 +7,13 @@
     Created: 2024
     Author:  Federico De Biase / Ayra Soft
 
+    Projects are saved as a chunked binary container: a header and chunk
+    index, a compressed XML chunk with the settings, and one compressed
+    chunk per distinct plugin state, named by its content hash. Loading
+    reads the index and settings only; plugin state is read from the file
+    when a row's plugin is first needed. XML projects from older versions
+    are still loaded.
+
   ==============================================================================
 */
 
@@ -18,10 +25,16 @@
 class ProjectSerializer {
 public:
   //==============================================================================
+  // Reads a plugin state on demand. Safe to call from any thread. Returns
+  // an empty block if the state can no longer be read.
+  using StateLoader = std::function<MemoryBlock()>;
+
   struct RowSettings {
     String name;
     PluginDescription pluginDesc;
     MemoryBlock pluginState;
+    // Set instead of pluginState when the state is still in the file
+    StateLoader pluginStateLoader;
     float volumeDb = 0.0f;
   };
 
@@ -45,7 +58,35 @@ public:
   static std::unique_ptr<XmlElement> toXml(const ProjectData &data);
   static bool fromXml(const XmlElement &xml, ProjectData &data);
 
+  // Hash of everything but the plugin state, to skip saving unchanged data
+  static uint64 getSettingsHash(const ProjectData &data);
+
 private:
+  //==============================================================================
+  struct ChunkInfo {
+    uint32 type = 0;
+    uint64 id = 0; // Content hash for state chunks
+    int64 offset = 0;
+    int64 storedSize = 0;
+    int64 rawSize = 0;
+  };
+
   static const char *const projectFileExtension;
   static const char *const projectTagName;
+
+  static bool saveBinary(const File &file, const ProjectData &data);
+  static bool loadBinary(const File &file, ProjectData &data);
+  static bool readIndex(const File &file, Array<ChunkInfo> &index);
+  // Empty if the file no longer holds the state
+  static MemoryBlock readState(const File &file, uint64 id);
+  static bool isBinaryProject(const File &file);
+
+  // With stateHashes, rows reference state chunks instead of embedding it
+  static std::unique_ptr<XmlElement>
+  createXml(const ProjectData &data, const Array<uint64> *stateHashes);
+
+  static bool writeChunk(OutputStream &out, uint32 type, uint64 id,
+                         const void *data, size_t numBytes,
+                         Array<ChunkInfo> &index);
+  static MemoryBlock readChunk(const File &file, const ChunkInfo &chunk);
 };
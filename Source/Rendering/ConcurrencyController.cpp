@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    ConcurrencyController.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "ConcurrencyController.h"
+
+//==============================================================================
+ConcurrencyController::ConcurrencyController(int initialLimit, int maximum)
+    : limit(jlimit(1, jmax(1, maximum), initialLimit)),
+      maxLimit(jmax(1, maximum)), direction(limit < maxLimit ? 1 : -1) {}
+
+int ConcurrencyController::getBestLimit() const {
+  if (throughputByLimit.size() < 2)
+    return 0;
+
+  auto best = throughputByLimit.begin();
+  for (auto it = throughputByLimit.begin(); it != throughputByLimit.end(); ++it)
+    if (it->second > best->second * (1.0 + tolerance))
+      best = it; // Ties go to the lower limit: same speed, less memory
+  return best->first;
+}
+
+bool ConcurrencyController::recordJob(double clipSeconds, double nowSeconds,
+                                      bool limitBinding) {
+  // Running below the limit measures whatever held the jobs back instead,
+  // and would step the limit down for no reason
+  if (!limitBinding) {
+    windowStartSeconds = -1.0;
+    windowClipSeconds = 0.0;
+    windowJobs = 0;
+    return false;
+  }
+
+  // Jobs that started under the previous limit still finish early in a
+  // window, so its clock starts at the first completion, which isn't counted
+  if (windowStartSeconds < 0.0) {
+    windowStartSeconds = nowSeconds;
+    return false;
+  }
+
+  windowClipSeconds += clipSeconds;
+  windowJobs++;
+
+  const double elapsed = nowSeconds - windowStartSeconds;
+  if (windowJobs < jmax(2, limit) || elapsed < minWindowSeconds)
+    return false;
+
+  const double throughput = windowClipSeconds / elapsed;
+  throughputByLimit[limit] = throughput;
+
+  if (previousThroughput > 0.0) {
+    if (throughput < previousThroughput * (1.0 - tolerance))
+      direction = -direction; // Worse: head back
+    else if (throughput < previousThroughput * (1.0 + tolerance))
+      direction = -1; // No gain: fewer jobs do as well
+  }
+  previousThroughput = throughput;
+
+  windowStartSeconds = -1.0;
+  windowClipSeconds = 0.0;
+  windowJobs = 0;
+
+  // Bounce off the ends of the range
+  if (limit + direction < 1 || limit + direction > maxLimit)
+    direction = -direction;
+
+  const int newLimit = jlimit(1, maxLimit, limit + direction);
+  const bool changed = newLimit != limit;
+  limit = newLimit;
+  return changed;
+}
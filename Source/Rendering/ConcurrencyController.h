@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    ConcurrencyController.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    How many jobs of one plugin may render at once. Plugins that spread
+    their DSP over their own threads slow each other down when too many
+    run side by side, while single-threaded ones want as many as there are
+    cores. The limit hill-climbs on measured throughput (seconds of audio
+    rendered per second), one step per measurement window.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class ConcurrencyController {
+public:
+  //==============================================================================
+  ConcurrencyController(int initialLimit, int maxLimit);
+
+  int getLimit() const { return limit; }
+
+  // Limit with the best throughput measured so far, or 0 if fewer than
+  // two limits have been measured
+  int getBestLimit() const;
+
+  // A job finished synthesizing clipSeconds of audio. limitBinding tells
+  // whether the plugin had as many jobs in flight as the limit allows; if
+  // not, something else capped it and the current window is dropped.
+  // Returns true if the limit changed.
+  bool recordJob(double clipSeconds, double nowSeconds, bool limitBinding);
+
+  // Throughput within this fraction counts as unchanged
+  static constexpr double tolerance = 0.05;
+  static constexpr double minWindowSeconds = 1.0;
+
+private:
+  //==============================================================================
+  int limit = 1;
+  int maxLimit = 1;
+  int direction = 1;
+
+  // Current window: opened by the first job to finish under the limit
+  double windowStartSeconds = -1.0;
+  double windowClipSeconds = 0.0;
+  int windowJobs = 0;
+
+  double previousThroughput = 0.0;
+  std::map<int, double> throughputByLimit;
+};
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    ContentHash.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    64-bit FNV-1a hash for identifying content (render inputs, state blobs).
+    Not cryptographic - only used to detect identical inputs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class ContentHash {
+public:
+  //==============================================================================
+  ContentHash &add(const void *data, size_t numBytes) {
+    auto *bytes = static_cast<const uint8 *>(data);
+    for (size_t i = 0; i < numBytes; ++i) {
+      value ^= bytes[i];
+      value *= 0x100000001b3ull;
+    }
+    return *this;
+  }
+
+  ContentHash &add(const MemoryBlock &block) {
+    add(static_cast<int64>(block.getSize()));
+    return add(block.getData(), block.getSize());
+  }
+
+  ContentHash &add(const String &text) {
+    auto utf8 = text.toUTF8();
+    const auto numBytes = utf8.sizeInBytes(); // Includes the terminator
+    return add(utf8.getAddress(), numBytes);
+  }
+
+  ContentHash &add(int64 number) { return add(&number, sizeof(number)); }
+  ContentHash &add(int number) { return add(static_cast<int64>(number)); }
+  ContentHash &add(double number) { return add(&number, sizeof(number)); }
+  ContentHash &add(float number) { return add(static_cast<double>(number)); }
+
+  //==============================================================================
+  uint64 getValue() const { return value; }
+  String toString() const {
+    return String::toHexString(static_cast<int64>(value)).paddedLeft('0', 16);
+  }
+
+  static String of(const MemoryBlock &block) {
+    return ContentHash().add(block).toString();
+  }
+
+private:
+  uint64 value = 0xcbf29ce484222325ull;
+};
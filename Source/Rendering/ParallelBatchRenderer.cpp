@@ -12,6 +12,9 @@
 
 #include "ParallelBatchRenderer.h"
 #include "../Audio/MidiPlayer.h"
+#include "../TraceRecorder.h"
+#include "PolyphaseResampler.h"
+#include <set>
 
 //==============================================================================
 // Custom playhead for offline rendering - provides tempo info to plugins (JUCE
@@ -47,20 +50,168 @@ private:
 };
 
 //==============================================================================
+std::atomic<int> ParallelBatchRenderer::activeRenderers{0};
+const char *const ParallelBatchRenderer::stemsFolderName = "Stems";
+
 ParallelBatchRenderer::ParallelBatchRenderer(ayra::PluginsManager &pm,
                                              const RenderSettings &settings,
                                              const File &outputDir)
-    : pluginsManager(pm), settings(settings), outputDirectory(outputDir) {
+    : pluginsManager(pm), settings(withOutputFormats(settings)),
+      outputDirectory(outputDir), manifest(outputDir),
+      threadPolicy(settings.workerCpuSet, settings.workerNiceLevel,
+                   settings.workerLowPriority),
+      // Encoding (FLAC especially) is real CPU work, not just disk I/O
+      writerPool(jlimit(2, 8, SystemStats::getNumCpus() / 2)) {
   // Prepare thread pool
-  threadPool.prepare(settings.sampleRate, 2048);
+  threadPool.prepare(this->settings.sampleRate, 2048);
+
+  // Memory budget: explicit setting, or 60% of physical RAM
+  int budgetMB = settings.memoryBudgetMB;
+  if (budgetMB <= 0)
+    budgetMB = jmax(1024, SystemStats::getMemorySizeInMegabytes() * 6 / 10);
+  memoryBudgetBytes = static_cast<int64>(budgetMB) * 1024 * 1024;
+
+  setMaxWorkers(settings.maxWorkers);
 }
 
-ParallelBatchRenderer::~ParallelBatchRenderer() { cancelRendering(); }
+ParallelBatchRenderer::~ParallelBatchRenderer() {
+  cancelRendering();
+
+  // Renders stop at their next block, but files already handed to the
+  // writers are finished, and both still report back to this object
+  while (unfinishedJobs.load() > 0)
+    Thread::sleep(5);
+
+  costModel.save();
+  manifest.save();
+}
+
+//==============================================================================
+String ParallelBatchRenderer::OutputFormat::getName() const {
+  const String rate = String(sampleRate / 1000.0, 1)
+                          .trimCharactersAtEnd("0")
+                          .trimCharactersAtEnd(".");
+  String name = rate + "k " + String(bitDepth) + "-bit";
+  if (container != Container::wav)
+    name << " " << getFileExtension().substring(1).toUpperCase();
+  return name;
+}
+
+String ParallelBatchRenderer::OutputFormat::getFileExtension() const {
+  switch (container) {
+  case Container::flac:
+    return ".flac";
+  case Container::aiff:
+    return ".aiff";
+  case Container::wav:
+    break;
+  }
+  return ".wav";
+}
+
+std::vector<ParallelBatchRenderer::OutputFormat>
+ParallelBatchRenderer::parseOutputFormats(const String &text) {
+  std::vector<OutputFormat> formats;
+
+  for (auto &entry : StringArray::fromTokens(text, ",", {})) {
+    const auto fields = StringArray::fromTokens(entry.toLowerCase(), "/", {});
+    const String rateText = fields[0].trim();
+    const String containerText = fields[2].trim();
+
+    OutputFormat format;
+    format.sampleRate = rateText.getDoubleValue();
+    if (rateText.endsWithChar('k'))
+      format.sampleRate *= 1000.0;
+    format.bitDepth = fields[1].trim().getIntValue();
+
+    if (containerText == "flac")
+      format.container = OutputFormat::Container::flac;
+    else if (containerText == "aiff" || containerText == "aif")
+      format.container = OutputFormat::Container::aiff;
+    else if (containerText.isNotEmpty() && containerText != "wav")
+      continue;
+
+    // Float output is only written as WAV
+    const bool validDepth =
+        format.bitDepth == 16 || format.bitDepth == 24 ||
+        (format.bitDepth == 32 &&
+         format.container == OutputFormat::Container::wav);
+    if (format.sampleRate < 8000.0 || format.sampleRate > 384000.0 ||
+        !validDepth)
+      continue;
+
+    // "48k/24" and "48000/24" name the same file: write it once
+    const bool duplicate = std::any_of(
+        formats.begin(), formats.end(), [&format](const OutputFormat &other) {
+          return other.getName() == format.getName();
+        });
+    if (!duplicate)
+      formats.push_back(format);
+  }
+
+  return formats;
+}
+
+ParallelBatchRenderer::RenderSettings
+ParallelBatchRenderer::withOutputFormats(RenderSettings settings) {
+  if (settings.outputFormats.empty())
+    settings.outputFormats.push_back({settings.sampleRate, settings.bitDepth});
+
+  // Synthesize once at the highest rate; lower ones are resampled from it
+  settings.sampleRate = 0.0;
+  for (auto &format : settings.outputFormats)
+    settings.sampleRate = jmax(settings.sampleRate, format.sampleRate);
+
+  return settings;
+}
+
+File ParallelBatchRenderer::getOutputFile(const RenderJob &job,
+                                          size_t formatIndex,
+                                          const String &busName) const {
+  const auto &format = settings.outputFormats[formatIndex];
+  File file = job.outputFile.withFileExtension(format.getFileExtension());
+  if (settings.outputFormats.size() > 1) {
+    const String relativePath = file.getRelativePathFrom(outputDirectory);
+    file = outputDirectory.getChildFile(format.getName())
+               .getChildFile(relativePath);
+  }
+
+  if (busName.isEmpty())
+    return file;
+
+  // Kept apart from the main files, which batch normalization works on
+  return file.getSiblingFile(stemsFolderName)
+      .getChildFile(file.getFileNameWithoutExtension() + " [" +
+                    File::createLegalFileName(busName) + "]" +
+                    file.getFileExtension());
+}
 
 //==============================================================================
 void ParallelBatchRenderer::addJob(const RenderJob &job) {
+  RenderJob estimatedJob = job;
+  estimatedJob.pluginKey = RenderCostModel::getPluginKey(job.pluginDesc);
+  estimatedJob.renderSeconds = estimateRenderSeconds(job);
+  estimatedJob.estimatedBytes = estimateJobBytes(estimatedJob);
+  estimatedJob.predictedSeconds =
+      costModel.predictJobSeconds(job.pluginDesc, estimatedJob.renderSeconds);
+
   const ScopedLock sl(queueLock);
 
+  if (pluginLimits.count(estimatedJob.pluginKey) == 0) {
+    // Unmeasured plugins start with a job per core and climb down if that
+    // turns out slower
+    const int maxJobs = SystemStats::getNumCpus();
+    int initialJobs = costModel.getConcurrency(job.pluginDesc);
+    if (initialJobs <= 0)
+      initialJobs = maxJobs;
+
+    pluginLimits.emplace(
+        estimatedJob.pluginKey,
+        PluginLimit{job.pluginDesc,
+                    ConcurrencyController(initialJobs, maxJobs), 0, 0});
+  }
+  pluginLimits.at(estimatedJob.pluginKey).jobsQueued++;
+
   // Find or create queue for this row
   RowQueue *queue = nullptr;
   for (auto *q : rowQueues) {
@@ -76,46 +227,133 @@ void ParallelBatchRenderer::addJob(const RenderJob &job) {
     rowQueues.add(queue);
   }
 
-  queue->jobs.push(job);
+  // Keep the row sorted longest-first so short jobs fill the tail of the batch
+  auto insertPos = std::upper_bound(
+      queue->jobs.begin(), queue->jobs.end(), estimatedJob,
+      [](const RenderJob &a, const RenderJob &b) {
+        return a.predictedSeconds > b.predictedSeconds;
+      });
+  queue->jobs.insert(insertPos, estimatedJob);
+  queue->queuedSeconds += estimatedJob.predictedSeconds;
+  queue->numJobs++;
   totalJobs++;
 }
 
-void ParallelBatchRenderer::startRendering() {
+void ParallelBatchRenderer::startRendering(bool startPaused) {
   if (rendering.load())
     return;
 
-  const ScopedLock sl(queueLock);
+  {
+    const ScopedLock sl(queueLock);
 
-  if (rowQueues.isEmpty())
-    return;
+    if (rowQueues.isEmpty())
+      return;
 
-  rendering.store(true);
-  cancelled.store(false);
-  completedCount.store(0);
-  failedCount.store(0);
+    setRendering(true);
+    cancelled.store(false);
+    paused.store(startPaused);
+    completedCount.store(0);
+    failedCount.store(0);
+    cancelledCount.store(0);
+    completedPredictedSeconds = 0.0;
+    completedActualSeconds = 0.0;
 
-  // Start processing first job from each row in parallel
-  for (auto *queue : rowQueues) {
-    processNextJobForRow(queue->rowIndex);
+    for (auto *queue : rowQueues)
+      queue->numFinished = 0;
   }
 
+  {
+    const ScopedLock sl(problemFilesLock);
+    failedJobs.clear();
+  }
+
+  // Admit as many rows as the memory budget allows
+  scheduleJobs();
+
   // Start timer for progress updates
   startTimerHz(10);
 }
 
 void ParallelBatchRenderer::cancelRendering() {
+  // Jobs still in flight - paused or not - wind down as cancelled, never
+  // through onJobCompleted
   cancelled.store(true);
+  paused.store(false);
   stopTimer();
-  rendering.store(false);
+  setRendering(false);
 
   const ScopedLock sl(queueLock);
 
-  // Clear all queues
+  // Clear all queues; jobs in flight stop at their next block
   for (auto *queue : rowQueues) {
-    while (!queue->jobs.empty())
-      queue->jobs.pop();
-    queue->isProcessing.store(false);
+    queue->jobs.clear();
+    queue->queuedSeconds = 0.0;
   }
+
+  for (auto &entry : pluginLimits)
+    entry.second.jobsQueued = 0;
+}
+
+void ParallelBatchRenderer::pauseRendering() { paused.store(true); }
+
+void ParallelBatchRenderer::resumeRendering() {
+  if (paused.exchange(false) && rendering.load())
+    scheduleJobs();
+}
+
+void ParallelBatchRenderer::setMaxWorkers(int newMaxWorkers) {
+  {
+    const ScopedLock sl(queueLock);
+    const int numCpus = SystemStats::getNumCpus();
+    maxWorkers = newMaxWorkers > 0 ? jmin(newMaxWorkers, numCpus) : numCpus;
+  }
+
+  // Raising the limit can let queued jobs start right away; lowering it
+  // lets the jobs in flight finish
+  if (rendering.load())
+    scheduleJobs();
+}
+
+int ParallelBatchRenderer::getMaxWorkers() const {
+  const ScopedLock sl(queueLock);
+  return maxWorkers;
+}
+
+bool ParallelBatchRenderer::prioritizeJob(int rowIndex, const File &midiFile) {
+  {
+    const ScopedLock sl(queueLock);
+
+    RowQueue *queue = nullptr;
+    for (auto *q : rowQueues)
+      if (q->rowIndex == rowIndex)
+        queue = q;
+
+    if (queue == nullptr)
+      return false;
+
+    auto it = std::find_if(queue->jobs.begin(), queue->jobs.end(),
+                           [&midiFile](const RenderJob &job) {
+                             return job.midiFile == midiFile;
+                           });
+    if (it == queue->jobs.end())
+      return false;
+
+    auto job = *it;
+    job.isPriority = true;
+    queue->jobs.erase(it);
+    queue->jobs.push_front(job);
+  }
+
+  // A worker may be free with room in the budget
+  if (rendering.load())
+    scheduleJobs();
+
+  return true;
+}
+
+void ParallelBatchRenderer::setRendering(bool isNowRendering) {
+  if (rendering.exchange(isNowRendering) != isNowRendering)
+    activeRenderers += isNowRendering ? 1 : -1;
 }
 
 //==============================================================================
@@ -126,15 +364,90 @@ float ParallelBatchRenderer::getProgress() const {
          static_cast<float>(totalJobs);
 }
 
+double ParallelBatchRenderer::getEstimatedSecondsRemaining() const {
+  const ScopedLock sl(queueLock);
+
+  const double nowMs = Time::getMillisecondCounterHiRes();
+  double totalSeconds = 0.0;
+  double longestJobSeconds = 0.0;
+
+  for (auto *queue : rowQueues) {
+    totalSeconds += queue->queuedSeconds;
+    for (auto &job : queue->jobs)
+      if (!job.isPriority) {
+        // Sorted longest first, apart from a prioritized job in front
+        longestJobSeconds = jmax(longestJobSeconds, job.predictedSeconds);
+        break;
+      }
+
+    for (auto &[startMs, predictedSeconds] : queue->running) {
+      const double left =
+          jmax(0.0, predictedSeconds - (nowMs - startMs) / 1000.0);
+      totalSeconds += left;
+      longestJobSeconds = jmax(longestJobSeconds, left);
+    }
+  }
+
+  if (totalSeconds <= 0.0)
+    return 0.0;
+
+  // Each plugin runs up to its limit of jobs, and all of them share the
+  // workers. The batch can't finish before its longest job.
+  int parallelism = 0;
+  for (auto &entry : pluginLimits)
+    parallelism += jmin(entry.second.controller.getLimit(),
+                        entry.second.jobsQueued + entry.second.jobsInFlight);
+  parallelism = jlimit(1, maxWorkers, parallelism);
+  double eta = jmax(longestJobSeconds, totalSeconds / parallelism);
+
+  // Calibrate the model against what this batch has actually taken
+  if (completedPredictedSeconds > 0.0)
+    eta *= completedActualSeconds / completedPredictedSeconds;
+
+  return eta;
+}
+
+std::vector<ParallelBatchRenderer::RowProgress>
+ParallelBatchRenderer::getRowProgress() const {
+  const ScopedLock sl(queueLock);
+
+  std::vector<RowProgress> rows;
+  rows.reserve(static_cast<size_t>(rowQueues.size()));
+  for (auto *queue : rowQueues)
+    rows.push_back({queue->rowIndex, queue->numFinished, queue->numJobs});
+  return rows;
+}
+
+std::vector<ParallelBatchRenderer::FailedJob>
+ParallelBatchRenderer::getFailedJobsSince(int index) const {
+  const ScopedLock sl(problemFilesLock);
+
+  if (index < 0 || index >= static_cast<int>(failedJobs.size()))
+    return {};
+  return {failedJobs.begin() + index, failedJobs.end()};
+}
+
 //==============================================================================
 void ParallelBatchRenderer::timerCallback() {
   if (onProgress)
     onProgress(getProgress());
 
+  std::vector<std::pair<int, File>> priorityJobsDone;
+  {
+    const ScopedLock sl(problemFilesLock);
+    priorityJobsDone.swap(finishedPriorityJobs);
+  }
+
+  if (onPriorityJobDone)
+    for (auto &[row, midiFile] : priorityJobsDone)
+      onPriorityJobDone(row, midiFile);
+
   // Check if all complete
   if (completedCount.load() + failedCount.load() >= totalJobs) {
     stopTimer();
-    rendering.store(false);
+    setRendering(false);
+    manifest.save();
+    saveConcurrencyLimits();
 
     if (failedCount.load() > 0 && onError) {
       onError("Some renders failed: " + lastError);
@@ -144,98 +457,482 @@ void ParallelBatchRenderer::timerCallback() {
   }
 }
 
-void ParallelBatchRenderer::processNextJobForRow(int rowIndex) {
+//==============================================================================
+// Scheduling: a row's next job is only admitted while the estimated
+// footprint of everything in flight fits the budget and its plugin is below
+// its concurrency limit. Among the rows that fit, the one with the most
+// predicted work left goes first so the longest chains start early.
+void ParallelBatchRenderer::scheduleJobs() {
   if (cancelled.load())
     return;
 
   const ScopedLock sl(queueLock);
 
-  // Find the queue for this row
-  RowQueue *queue = nullptr;
-  for (auto *q : rowQueues) {
-    if (q->rowIndex == rowIndex) {
-      queue = q;
-      break;
+  while (auto *queue = pickNextRow())
+    submitJob(*queue);
+}
+
+ParallelBatchRenderer::RowQueue *ParallelBatchRenderer::pickNextRow() {
+  if (inFlightJobs >= maxWorkers)
+    return nullptr;
+
+  RowQueue *best = nullptr;
+
+  for (auto *queue : rowQueues) {
+    if (queue->jobs.empty())
+      continue;
+
+    const auto &job = queue->jobs.front();
+    if (paused.load() && !job.isPriority)
+      continue;
+
+    // Always let one job through so an oversized job can't stall the batch.
+    // That is when nothing holds memory: rendered jobs keep their buffers
+    // until the writer stage is done with them. A priority job borrows the
+    // next free worker regardless of load.
+    const bool borrowsWorker = job.isPriority && priorityJobsInFlight == 0;
+    if (inFlightBytes > 0 && !borrowsWorker) {
+      if (inFlightBytes + job.estimatedBytes > memoryBudgetBytes)
+        continue;
+
+      // Keep large jobs from coinciding - they peak together otherwise
+      if (isLargeJob(job) && largeJobsInFlight > 0)
+        continue;
+
+      const auto &pluginLimit = pluginLimits.at(job.pluginKey);
+      if (pluginLimit.jobsInFlight >= pluginLimit.controller.getLimit())
+        continue;
     }
-  }
 
-  if (queue == nullptr || queue->jobs.empty()) {
-    if (queue)
-      queue->isProcessing.store(false);
-    return;
+    // Prioritized jobs go first, then the longest row
+    if (best == nullptr || queue->hasPriorityJob() > best->hasPriorityJob() ||
+        (queue->hasPriorityJob() == best->hasPriorityJob() &&
+         queue->queuedSeconds > best->queuedSeconds))
+      best = queue;
   }
 
-  // Check if already processing
-  if (queue->isProcessing.exchange(true))
-    return;
+  return best;
+}
 
-  // Get next job
-  RenderJob job = queue->jobs.front();
-  queue->jobs.pop();
+void ParallelBatchRenderer::submitJob(RowQueue &queue) {
+  RenderJob job = queue.jobs.front();
+  queue.jobs.pop_front();
+
+  queue.queuedSeconds = jmax(0.0, queue.queuedSeconds - job.predictedSeconds);
+  job.startMs = Time::getMillisecondCounterHiRes();
+  queue.running.emplace(job.startMs, job.predictedSeconds);
+
+  inFlightBytes += job.estimatedBytes;
+  inFlightJobs++;
+  if (isLargeJob(job))
+    largeJobsInFlight++;
+  auto &pluginLimit = pluginLimits.at(job.pluginKey);
+  pluginLimit.jobsInFlight++;
+  pluginLimit.jobsQueued--;
+  if (job.isPriority)
+    priorityJobsInFlight++;
+
+  unfinishedJobs++;
+
+  // Submit to thread pool. The worker only synthesizes: writing the files
+  // is handed to the writer stage, which completes the job.
+  threadPool.addJob([this, job]() {
+    threadPolicy.applyToCurrentThread();
+    ScopedNoDenormals noDenormals; // Decaying tails crawl as denormals
+
+    auto rendered = renderSingleJob(job);
+    onJobRendered(job, rendered != nullptr);
+
+    if (rendered != nullptr) {
+      unfinishedJobs++; // Until the writer stage completes the job
+      writeOutputs(std::move(rendered));
+    } else if (cancelled.load()) {
+      onJobCancelled(job);
+    } else {
+      onJobCompleted(job, false, lastError);
+    }
 
-  // Submit to thread pool
-  threadPool.addJob([this, job, rowIndex]() {
-    bool success = renderSingleJob(job);
-    onJobCompleted(rowIndex, success, lastError);
+    unfinishedJobs--;
   });
 }
 
-void ParallelBatchRenderer::onJobCompleted(int rowIndex, bool success,
+void ParallelBatchRenderer::onJobRendered(const RenderJob &job, bool success) {
+  // The worker is free again; the job's memory is released once its files
+  // are written
+  {
+    const ScopedLock sl(queueLock);
+    const double nowMs = Time::getMillisecondCounterHiRes();
+
+    inFlightJobs--;
+    if (job.isPriority)
+      priorityJobsInFlight--;
+
+    // Throughput only says something about the limit while the limit is
+    // what holds the plugin back - not the workers, the budget or running
+    // out of queued jobs
+    auto &pluginLimit = pluginLimits.at(job.pluginKey);
+    const bool limitBinding =
+        pluginLimit.jobsInFlight >= pluginLimit.controller.getLimit();
+    pluginLimit.jobsInFlight--;
+    if (success && pluginLimit.controller.recordJob(
+                       job.renderSeconds, nowMs / 1000.0, limitBinding))
+      DBG("Concurrency for " + job.pluginDesc.name + ": " +
+          String(pluginLimit.controller.getLimit()) + " jobs");
+
+    if (success) {
+      completedPredictedSeconds += job.predictedSeconds;
+      completedActualSeconds += (nowMs - job.startMs) / 1000.0;
+    }
+
+    for (auto *queue : rowQueues) {
+      if (queue->rowIndex == job.rowIndex) {
+        auto range = queue->running.equal_range(job.startMs);
+        for (auto it = range.first; it != range.second; ++it) {
+          if (it->second == job.predictedSeconds) {
+            queue->running.erase(it);
+            break;
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  // Admit whatever fits now (including this plugin's next job)
+  if (!cancelled.load()) {
+    scheduleJobs();
+  }
+}
+
+void ParallelBatchRenderer::onJobCompleted(const RenderJob &job, bool success,
                                            const String &error) {
   if (success) {
     completedCount++;
+    // Any WAV format will do for auditioning; the first listed is used
+    for (size_t i = 0; i < settings.outputFormats.size(); ++i) {
+      if (settings.outputFormats[i].container ==
+          OutputFormat::Container::wav) {
+        const File renderedFile = getOutputFile(job, i);
+        if (renderedFile.existsAsFile())
+          manifest.add(RenderManifest::computeKey(getManifestInputs(job)),
+                       renderedFile);
+        break;
+      }
+    }
+
+    // Someone is waiting to hear this one: publish it now rather than at
+    // the end of the batch
+    if (job.isPriority) {
+      manifest.save();
+
+      const ScopedLock sl(problemFilesLock);
+      finishedPriorityJobs.push_back({job.rowIndex, job.midiFile});
+    }
   } else {
     failedCount++;
     if (!error.isEmpty())
       lastError = error;
+
+    const ScopedLock sl(problemFilesLock);
+    failedJobs.push_back({job.rowIndex, job.columnIndex, error});
   }
 
-  // Find queue and mark as not processing
-  {
-    const ScopedLock sl(queueLock);
+  releaseJob(job, true);
+
+  // Admit whatever fits now
+  if (!cancelled.load()) {
+    scheduleJobs();
+  }
+}
+
+// A job stopped by cancelRendering is neither a render nor a failure: it
+// only gives its budget back
+void ParallelBatchRenderer::onJobCancelled(const RenderJob &job) {
+  cancelledCount++;
+  releaseJob(job, false);
+}
+
+void ParallelBatchRenderer::releaseJob(const RenderJob &job, bool finished) {
+  const ScopedLock sl(queueLock);
+
+  inFlightBytes -= job.estimatedBytes;
+  if (isLargeJob(job))
+    largeJobsInFlight--;
+
+  if (finished) {
     for (auto *queue : rowQueues) {
-      if (queue->rowIndex == rowIndex) {
-        queue->isProcessing.store(false);
+      if (queue->rowIndex == job.rowIndex) {
+        queue->numFinished++;
         break;
       }
     }
   }
+}
 
-  // Process next job for this row (sequential per row)
-  if (!cancelled.load()) {
-    processNextJobForRow(rowIndex);
+// Later batches start from the best concurrency found here. Only finished
+// batches get here: a cancelled one may not have measured enough.
+void ParallelBatchRenderer::saveConcurrencyLimits() {
+  {
+    const ScopedLock sl(queueLock);
+    for (auto &entry : pluginLimits)
+      costModel.recordConcurrency(entry.second.desc,
+                                  entry.second.controller.getBestLimit());
   }
+
+  costModel.save();
+}
+
+RenderManifest::JobInputs
+ParallelBatchRenderer::getManifestInputs(const RenderJob &job) {
+  RenderManifest::JobInputs inputs;
+  inputs.pluginDesc = job.pluginDesc;
+  inputs.pluginStateHash = job.pluginStateHash;
+  inputs.midiFile = job.midiFile;
+  inputs.pitchOffset = job.pitchOffset;
+  inputs.velocityMultiplier = job.velocityMultiplier;
+  inputs.volumeDb = job.volumeDb;
+  inputs.bpm = job.bpm;
+  return inputs;
 }
 
 //==============================================================================
-bool ParallelBatchRenderer::renderSingleJob(const RenderJob &job) {
+double ParallelBatchRenderer::estimateRenderSeconds(const RenderJob &job) {
+  // Mirrors the duration logic in renderSingleJob()
+  const String key = job.midiFile.getFullPathName() + "@" + String(job.bpm);
+
+  {
+    const ScopedLock sl(queueLock);
+    auto it = clipDurationCache.find(key);
+    if (it != clipDurationCache.end())
+      return it->second;
+  }
+
+  double renderSeconds = 0.0;
+  if (job.midiLengthBeats > 0.0) {
+    // Seamless loops are rounded up to whole 4/4 bars, like
+    // MidiPlayer::getMidiFileDuration()
+    const double secondsPerBeat = 60.0 / job.bpm;
+    const double loopBeats =
+        (std::floor(job.midiLengthBeats / 4.0) + 1.0) * 4.0;
+    renderSeconds = settings.seamlessLoop
+                        ? loopBeats * secondsPerBeat * 2 + 5.0
+                        : job.midiLengthBeats * secondsPerBeat + 10.0;
+  } else if (settings.seamlessLoop) {
+    renderSeconds =
+        MidiPlayer::getMidiFileDuration(job.midiFile, job.bpm) * 2 + 5.0;
+  } else {
+    renderSeconds = MidiPlayer::getSequenceDuration(MidiPlayer::loadMidiFile(
+                        job.midiFile, job.bpm)) +
+                    10.0;
+  }
+
+  const ScopedLock sl(queueLock);
+  clipDurationCache[key] = renderSeconds;
+  return renderSeconds;
+}
+
+int64 ParallelBatchRenderer::estimateJobBytes(const RenderJob &job) const {
+  // Mirrors the render buffer allocated in renderSingleJob(). Until the
+  // plugin has rendered once, its description stands in for the channels
+  // and the latency is unknown.
+  int numChannels = costModel.getBufferChannels(job.pluginDesc);
+  if (numChannels <= 0)
+    numChannels = jmax(2, job.pluginDesc.numOutputChannels,
+                       job.pluginDesc.numInputChannels);
+
+  const auto numSamples =
+      static_cast<int64>(job.renderSeconds * settings.sampleRate) +
+      costModel.getLatencySamples(job.pluginDesc);
+
+  int64 bufferBytes =
+      numSamples * numChannels * static_cast<int64>(sizeof(float));
+
+  // Plus one resampled copy per extra sample rate
+  std::set<int> extraRates;
+  for (auto &format : settings.outputFormats)
+    if (roundToInt(format.sampleRate) != roundToInt(settings.sampleRate))
+      extraRates.insert(roundToInt(format.sampleRate));
+
+  double copies = 1.0;
+  for (auto rate : extraRates)
+    copies += rate / settings.sampleRate;
+  bufferBytes = static_cast<int64>(bufferBytes * copies);
+
+  return bufferBytes + costModel.getInstanceBytes(job.pluginDesc);
+}
+
+bool ParallelBatchRenderer::isLargeJob(const RenderJob &job) const {
+  return job.estimatedBytes > memoryBudgetBytes / 4;
+}
+
+//==============================================================================
+bool ParallelBatchRenderer::renderSequence(
+    AudioPluginInstance &plugin, const MidiMessageSequence &midiSeq,
+    double sampleRate, double bpm, bool useDoublePrecision,
+    AudioBuffer<float> &output, const std::function<bool()> &shouldContinue,
+    std::vector<float> *channelPeaks) {
+  // Playhead with the job's BPM for tempo-synced plugins (arpeggiators, etc.)
+  OfflinePlayHead playhead(bpm, sampleRate);
+  plugin.setPlayHead(&playhead);
+
+  const int numChannels = output.getNumChannels();
+  const int64 totalSamples = output.getNumSamples();
+  output.clear();
+
+  if (channelPeaks != nullptr)
+    channelPeaks->assign(static_cast<size_t>(numChannels), 0.0f);
+
+  int64 samplePos = 0;
+  int midiEventIndex = 0;
+
+  // Block buffers are reused across blocks; the last one may be shorter
+  AudioBuffer<float> floatBlock(numChannels, renderBlockSize);
+  AudioBuffer<double> doubleBlock(numChannels,
+                                  useDoublePrecision ? renderBlockSize : 0);
+  MidiBuffer midiBuffer;
+
+  while (samplePos < totalSamples) {
+    if (!shouldContinue()) {
+      plugin.setPlayHead(nullptr);
+      return false;
+    }
+
+    TRACE_SCOPE("Render", "processBlock");
+
+    int samplesToProcess = static_cast<int>(
+        jmin((int64)renderBlockSize, totalSamples - samplePos));
+
+    AudioBuffer<float> blockBuffer(floatBlock.getArrayOfWritePointers(),
+                                   numChannels, samplesToProcess);
+    blockBuffer.clear();
+    midiBuffer.clear();
+
+    double blockStartTime = samplePos / sampleRate;
+    double blockEndTime = (samplePos + samplesToProcess) / sampleRate;
+
+    // Add MIDI events that fall within this block
+    while (midiEventIndex < midiSeq.getNumEvents()) {
+      auto *event = midiSeq.getEventPointer(midiEventIndex);
+      double eventTime = event->message.getTimeStamp();
+
+      if (eventTime < blockStartTime) {
+        midiEventIndex++;
+        continue;
+      }
+
+      if (eventTime < blockEndTime) {
+        int sampleOffset =
+            static_cast<int>((eventTime - blockStartTime) * sampleRate);
+        sampleOffset = jlimit(0, samplesToProcess - 1, sampleOffset);
+        midiBuffer.addEvent(event->message, sampleOffset);
+        midiEventIndex++;
+      } else {
+        break;
+      }
+    }
+
+    // Update playhead position for tempo-synced plugins
+    playhead.setPosition(samplePos);
+
+    // Process block through plugin
+    if (useDoublePrecision) {
+      AudioBuffer<double> block(doubleBlock.getArrayOfWritePointers(),
+                                numChannels, samplesToProcess);
+      block.clear();
+      plugin.processBlock(block, midiBuffer);
+
+      for (int ch = 0; ch < numChannels; ++ch) {
+        auto *src = block.getReadPointer(ch);
+        auto *dst = blockBuffer.getWritePointer(ch);
+        for (int i = 0; i < samplesToProcess; ++i)
+          dst[i] = static_cast<float>(src[i]);
+      }
+    } else {
+      plugin.processBlock(blockBuffer, midiBuffer);
+    }
+
+    // Copy to full buffer
+    for (int ch = 0; ch < numChannels; ++ch) {
+      output.copyFrom(ch, static_cast<int>(samplePos), blockBuffer, ch, 0,
+                      samplesToProcess);
+
+      if (channelPeaks != nullptr) {
+        auto &peak = (*channelPeaks)[static_cast<size_t>(ch)];
+        peak = jmax(peak, blockBuffer.getMagnitude(ch, 0, samplesToProcess));
+      }
+    }
+
+    samplePos += samplesToProcess;
+  }
+
+  plugin.setPlayHead(nullptr);
+  return true;
+}
+
+//==============================================================================
+std::shared_ptr<ParallelBatchRenderer::RenderedJob>
+ParallelBatchRenderer::renderSingleJob(const RenderJob &job) {
+  TRACE_SCOPE("Render", "Render job");
+
   try {
-    // 1. Load plugin
+    // 1. Load plugin (measure its footprint for the admission model)
+    const double loadStartMs = Time::getMillisecondCounterHiRes();
+    RenderCostModel::LoadProbe loadProbe;
     String errorMessage;
     ayra::PluginDescriptionAndPreference descPref;
     descPref.pluginDescription = job.pluginDesc;
 
-    auto plugin = pluginsManager.createPluginInstance(
-        descPref, settings.sampleRate, 2048, errorMessage);
+    std::unique_ptr<AudioPluginInstance> plugin;
+    {
+      TRACE_SCOPE("Render", "Plugin load");
+      plugin = pluginsManager.createPluginInstance(
+          descPref, settings.sampleRate, renderBlockSize, errorMessage);
+    }
 
     if (plugin == nullptr) {
       lastError = "Failed to load plugin: " + errorMessage;
-      return false;
+      return nullptr;
     }
 
     // Restore plugin state
     if (job.pluginState.getSize() > 0) {
+      TRACE_SCOPE("Render", "Plugin state restore");
       plugin->setStateInformation(job.pluginState.getData(),
                                   static_cast<int>(job.pluginState.getSize()));
     }
 
-    // Create playhead with job's BPM for tempo-synced plugins (arpeggiators,
-    // etc.)
-    OfflinePlayHead playhead(job.bpm, settings.sampleRate);
-    plugin->setPlayHead(&playhead);
+    // Offline negotiation: many plugins switch to faster or higher-quality
+    // algorithms only when told they are not running in realtime
+    plugin->setNonRealtime(true);
+
+    const bool useDoublePrecision = settings.preferDoublePrecision &&
+                                    plugin->supportsDoublePrecisionProcessing();
+    plugin->setProcessingPrecision(useDoublePrecision
+                                       ? AudioProcessor::doublePrecision
+                                       : AudioProcessor::singlePrecision);
+
+    // Stems need every output bus, so the layout is settled before preparing
+    if (settings.writeStems)
+      for (int i = 1; i < plugin->getBusCount(false); ++i)
+        if (auto *bus = plugin->getBus(false, i))
+          bus->enable(true);
 
     // Prepare plugin
-    plugin->prepareToPlay(settings.sampleRate, 2048);
+    {
+      TRACE_SCOPE("Render", "prepareToPlay");
+      plugin->prepareToPlay(settings.sampleRate, renderBlockSize);
+    }
+
+    // Lookahead plugins delay their output - render that much extra and
+    // discard it from the start so the clip lines up with the MIDI
+    const int latencySamples = jmax(0, plugin->getLatencySamples());
+
+    // Dropped when another job loaded or prepared at the same time
+    const int64 instanceBytes = loadProbe.finish();
+    if (instanceBytes > 0)
+      costModel.recordInstanceBytes(job.pluginDesc, instanceBytes);
+
+    const double renderStartMs = Time::getMillisecondCounterHiRes();
 
     // 2. Load MIDI and apply transformations (use job.bpm, not settings.bpm)
     auto midiSeq = MidiPlayer::loadMidiFile(job.midiFile, job.bpm);
@@ -273,75 +970,47 @@ bool ParallelBatchRenderer::renderSingleJob(const RenderJob &job) {
     // 3. Render through plugin
     int64 totalSamples =
         static_cast<int64>(renderDuration * settings.sampleRate);
+    int64 renderedSamples = totalSamples + latencySamples;
     int numChannels = plugin->getTotalNumOutputChannels();
     if (numChannels < 2)
       numChannels = 2;
 
-    AudioBuffer<float> fullBuffer(numChannels, static_cast<int>(totalSamples));
-    fullBuffer.clear();
-
-    const int blockSize = 2048;
-    int64 samplePos = 0;
-    int midiEventIndex = 0;
-
-    while (samplePos < totalSamples) {
-      if (cancelled.load()) {
-        plugin->releaseResources();
-        return false;
-      }
-
-      int samplesToProcess =
-          static_cast<int>(jmin((int64)blockSize, totalSamples - samplePos));
-
-      // Create temp buffer for this block
-      AudioBuffer<float> blockBuffer(numChannels, samplesToProcess);
-      blockBuffer.clear();
-
-      // Create MIDI buffer for this block
-      MidiBuffer midiBuffer;
-
-      double blockStartTime = samplePos / settings.sampleRate;
-      double blockEndTime =
-          (samplePos + samplesToProcess) / settings.sampleRate;
-
-      // Add MIDI events that fall within this block
-      while (midiEventIndex < midiSeq.getNumEvents()) {
-        auto *event = midiSeq.getEventPointer(midiEventIndex);
-        double eventTime = event->message.getTimeStamp();
-
-        if (eventTime < blockStartTime) {
-          midiEventIndex++;
-          continue;
-        }
-
-        if (eventTime < blockEndTime) {
-          int sampleOffset = static_cast<int>((eventTime - blockStartTime) *
-                                              settings.sampleRate);
-          sampleOffset = jlimit(0, samplesToProcess - 1, sampleOffset);
-          midiBuffer.addEvent(event->message, sampleOffset);
-          midiEventIndex++;
-        } else {
-          break;
-        }
-      }
-
-      // Update playhead position for tempo-synced plugins
-      playhead.setPosition(samplePos);
-
-      // Process block through plugin
-      plugin->processBlock(blockBuffer, midiBuffer);
-
-      // Copy to full buffer
-      for (int ch = 0; ch < numChannels; ++ch) {
-        fullBuffer.copyFrom(ch, static_cast<int>(samplePos), blockBuffer, ch, 0,
-                            samplesToProcess);
-      }
-
-      samplePos += samplesToProcess;
+    // processBlock gets room for the input buses too, if there are more
+    const int bufferChannels =
+        jmax(numChannels, plugin->getTotalNumInputChannels());
+    auto rendered = std::make_shared<RenderedJob>();
+    rendered->job = job;
+    auto &renderBuffer = rendered->buffer;
+    renderBuffer.setSize(bufferChannels, static_cast<int>(renderedSamples));
+    costModel.recordBufferShape(job.pluginDesc, bufferChannels,
+                                latencySamples);
+
+    std::vector<float> channelPeaks;
+    const bool finished = renderSequence(
+        *plugin, midiSeq, settings.sampleRate, job.bpm, useDoublePrecision,
+        renderBuffer, [this] { return !cancelled.load(); }, &channelPeaks);
+
+    if (!finished) {
+      plugin->releaseResources();
+      return nullptr;
     }
 
     plugin->releaseResources();
 
+    costModel.recordRenderTime(
+        job.pluginDesc, renderDuration, (renderStartMs - loadStartMs) / 1000.0,
+        (Time::getMillisecondCounterHiRes() - renderStartMs) / 1000.0);
+
+    // Latency-compensated view: sample 0 is the sample that belongs to MIDI
+    // time 0, so loop and seamless cuts below land on the bar
+    auto &fullBuffer = rendered->audio;
+    fullBuffer.setDataToReferTo(renderBuffer.getArrayOfWritePointers(),
+                                numChannels, latencySamples,
+                                static_cast<int>(totalSamples));
+    if (latencySamples > 0)
+      DBG("Compensated plugin latency: " + String(latencySamples) +
+          " samples");
+
     // 4. Apply combined volume gain (row gain + master gain)
     float rowGainLinear =
         (job.volumeDb > -96.0f) ? Decibels::decibelsToGain(job.volumeDb) : 0.0f;
@@ -379,11 +1048,13 @@ bool ParallelBatchRenderer::renderSingleJob(const RenderJob &job) {
       }
     } else {
       // Normal mode: find silence start and snap to next bar
+      TRACE_SCOPE("Render", "Silence scan");
       float thresholdLinear =
           Decibels::decibelsToGain(settings.silenceThresholdDb);
       int64 silenceStartSample = totalSamples;
 
       // Scan backwards
+      const int blockSize = renderBlockSize;
       for (int64 pos = totalSamples - blockSize; pos >= 0; pos -= blockSize) {
         int samplesToCheck =
             static_cast<int>(jmin((int64)blockSize, totalSamples - pos));
@@ -425,86 +1096,291 @@ bool ParallelBatchRenderer::renderSingleJob(const RenderJob &job) {
 
     finalSamples = jmin(finalSamples, totalSamples - startSampleOffset);
 
-    // 7. Write to file
-    job.outputFile.getParentDirectory().createDirectory();
-    job.outputFile.deleteFile();
+    // 7. Every delivery format is written from this one render by the
+    // writer stage (see writeOutputs)
+    rendered->stems = getStems(*plugin, channelPeaks, numChannels);
+    rendered->startSample = startSampleOffset;
+    rendered->numSamples = finalSamples;
 
-    std::unique_ptr<FileOutputStream> outputStream(
-        job.outputFile.createOutputStream());
-    if (outputStream == nullptr) {
-      lastError = "Failed to create output file";
-      return false;
-    }
+    // 8. Normalization is now done as batch post-processing after all renders
+    // complete (see MainComponent::runBatchNormalization)
 
-    WavAudioFormat wavFormat;
-    std::unique_ptr<AudioFormatWriter> writer(wavFormat.createWriterFor(
-        outputStream.get(), settings.sampleRate,
-        static_cast<unsigned int>(numChannels), settings.bitDepth, {}, 0));
+    return rendered;
+  } catch (const std::exception &e) {
+    lastError = String("Exception: ") + e.what();
+    return nullptr;
+  }
+}
 
-    if (writer == nullptr) {
-      lastError = "Failed to create WAV writer";
-      return false;
+//==============================================================================
+std::vector<ParallelBatchRenderer::Stem>
+ParallelBatchRenderer::getStems(const AudioPluginInstance &plugin,
+                                const std::vector<float> &channelPeaks,
+                                int numChannels) const {
+  const Stem everything{{}, 0, numChannels};
+  if (!settings.writeStems || plugin.getBusCount(false) <= 1)
+    return {everything};
+
+  const float threshold = Decibels::decibelsToGain(settings.silenceThresholdDb);
+  std::vector<Stem> stems;
+
+  for (int i = 0; i < plugin.getBusCount(false); ++i) {
+    auto *bus = plugin.getBus(false, i);
+    if (bus == nullptr || !bus->isEnabled() || bus->getNumberOfChannels() == 0)
+      continue;
+
+    Stem stem;
+    stem.firstChannel = plugin.getChannelIndexInProcessBlockBuffer(false, i, 0);
+    stem.numChannels = bus->getNumberOfChannels();
+    if (i > 0)
+      stem.busName = bus->getName().isNotEmpty() ? bus->getName()
+                                                 : "Bus " + String(i + 1);
+
+    // The main output is always written; silent extra buses can be skipped
+    if (i > 0 && settings.skipEmptyStems) {
+      float peak = 0.0f;
+      for (int ch = 0; ch < stem.numChannels; ++ch)
+        peak = jmax(peak,
+                    channelPeaks[static_cast<size_t>(stem.firstChannel + ch)]);
+
+      if (peak <= threshold) {
+        DBG("Skipping empty stem: " + stem.busName);
+        continue;
+      }
     }
 
-    outputStream.release(); // Writer now owns the stream
+    stems.push_back(stem);
+  }
 
-    writer->writeFromAudioSampleBuffer(fullBuffer,
-                                       static_cast<int>(startSampleOffset),
-                                       static_cast<int>(finalSamples));
+  if (stems.empty() || stems.front().busName.isNotEmpty())
+    stems.insert(stems.begin(), everything); // Main bus disabled
+  return stems;
+}
 
-    // Close writer before normalizing
-    writer.reset();
+// Writer stage. Each file (format x stem) is its own task, so a render's
+// files are encoded in parallel with each other and with other jobs'
+// files, while the render worker moves on to its next job. The last file
+// written completes the job.
+void ParallelBatchRenderer::writeOutputs(
+    std::shared_ptr<RenderedJob> rendered) {
+  // Formats sharing a sample rate share one resampled copy
+  std::map<int, std::vector<size_t>> formatsByRate;
+  for (size_t i = 0; i < settings.outputFormats.size(); ++i)
+    formatsByRate[roundToInt(settings.outputFormats[i].sampleRate)].push_back(
+        i);
+
+  rendered->filesPending.store(
+      static_cast<int>(settings.outputFormats.size() * rendered->stems.size()));
+
+  for (auto &entry : formatsByRate) {
+    const int rate = entry.first;
+    const auto &formatIndices = entry.second;
+
+    if (rate == roundToInt(settings.sampleRate)) {
+      queueFileWrites(rendered, nullptr, formatIndices, rendered->startSample,
+                      rendered->numSamples);
+      continue;
+    }
 
-    // 8. Normalization is now done as batch post-processing after all renders
-    // complete (see MainComponent::runBatchNormalization)
+    writerPool.addJob([this, rendered, rate, formatIndices] {
+      threadPolicy.applyToCurrentThread();
+      ScopedNoDenormals noDenormals;
+      TRACE_SCOPE("Write", "Resample");
+
+      // The whole render is converted, so the filter sees real audio on
+      // both sides of the cut (keeps seamless loop points clean)
+      const auto &audio = rendered->audio;
+      PolyphaseResampler resampler(settings.sampleRate, rate);
+      auto resampled = std::make_shared<const AudioBuffer<float>>(
+          resampler.process(audio, 0, audio.getNumSamples()));
+
+      const double ratio = rate / settings.sampleRate;
+      const int64 start = std::llround(rendered->startSample * ratio);
+      const int64 length =
+          jmin(static_cast<int64>(std::llround(rendered->numSamples * ratio)),
+               resampled->getNumSamples() - start);
+
+      queueFileWrites(rendered, resampled, formatIndices, start, length);
+    });
+  }
+}
 
-    // 9. Validate output file - check for empty or silent files
-    if (job.outputFile.existsAsFile()) {
-      int64 fileSize = job.outputFile.getSize();
-
-      // Check if file is empty or too small (< 1KB is suspicious for audio)
-      if (fileSize < 1024) {
-        ScopedLock sl(problemFilesLock);
-        problematicFiles.add(job.outputFile.getFileName() +
-                             " [EMPTY/CORRUPT - " + String(fileSize) +
-                             " bytes]");
-        DBG("WARNING: File too small: " + job.outputFile.getFileName());
-      } else {
-        // Check for silent audio by reading and checking peak level
-        WavAudioFormat wavFormat;
-        std::unique_ptr<AudioFormatReader> reader(wavFormat.createReaderFor(
-            job.outputFile.createInputStream().release(), true));
-
-        if (reader != nullptr) {
-          // Read a sample of the audio to check levels
-          AudioBuffer<float> checkBuffer(
-              reader->numChannels,
-              jmin((int)reader->lengthInSamples, 44100)); // Check first 1 sec
-          reader->read(&checkBuffer, 0, checkBuffer.getNumSamples(), 0, true,
-                       true);
-
-          float peakLevel =
-              checkBuffer.getMagnitude(0, checkBuffer.getNumSamples());
-
-          // If peak is below -60dB, file is essentially silent
-          if (peakLevel < 0.001f) { // ~-60dB
-            ScopedLock sl(problemFilesLock);
-            problematicFiles.add(
-                job.outputFile.getFileName() + " [SILENT - peak: " +
-                String(20.0f * std::log10(peakLevel + 0.0001f), 1) + " dB]");
-            DBG("WARNING: Silent file: " + job.outputFile.getFileName());
-          }
+void ParallelBatchRenderer::queueFileWrites(
+    std::shared_ptr<RenderedJob> rendered,
+    std::shared_ptr<const AudioBuffer<float>> resampled,
+    const std::vector<size_t> &formatIndices, int64 startSample,
+    int64 numSamples) {
+  for (auto index : formatIndices) {
+    // Every format carries the same clip, so it is checked in one only: the
+    // first written at the synthesis rate. Stems may legitimately be quiet.
+    const bool checkClip =
+        resampled == nullptr && index == formatIndices.front();
+
+    for (auto &stem : rendered->stems) {
+      writerPool.addJob([this, rendered, resampled, index, stem, startSample,
+                         numSamples, checkClip] {
+        threadPolicy.applyToCurrentThread();
+        TRACE_SCOPE("Write", "Write file");
+        const File file = getOutputFile(rendered->job, index, stem.busName);
+        const auto &source =
+            resampled != nullptr ? *resampled : rendered->audio;
+
+        String error;
+        if (!writeAudioFile(file, source, stem, startSample, numSamples,
+                            settings.outputFormats[index], error)) {
+          const ScopedLock sl(rendered->errorLock);
+          rendered->error = error;
+        } else if (checkClip && stem.busName.isEmpty()) {
+          checkOutputFile(file);
         }
-      }
-    } else {
-      ScopedLock sl(problemFilesLock);
-      problematicFiles.add(job.outputFile.getFileName() +
-                           " [FILE NOT CREATED]");
+
+        if (--rendered->filesPending == 0) {
+          if (rendered->error.isNotEmpty() && cancelled.load())
+            onJobCancelled(rendered->job);
+          else
+            onJobCompleted(rendered->job, rendered->error.isEmpty(),
+                           rendered->error);
+          unfinishedJobs--;
+        }
+      });
     }
+  }
+}
 
-    return true;
-  } catch (const std::exception &e) {
-    lastError = String("Exception: ") + e.what();
+bool ParallelBatchRenderer::writeAudioFile(const File &file,
+                                           const AudioBuffer<float> &audio,
+                                           const Stem &stem, int64 startSample,
+                                           int64 numSamples,
+                                           const OutputFormat &format,
+                                           String &error) const {
+  file.getParentDirectory().createDirectory();
+  file.deleteFile();
+
+  std::unique_ptr<FileOutputStream> outputStream(file.createOutputStream());
+  if (outputStream == nullptr) {
+    error = "Failed to create output file";
+    return false;
+  }
+
+  const int numChannels = stem.numChannels;
+  std::unique_ptr<AudioFormat> audioFormat;
+  int qualityOption = 0;
+  switch (format.container) {
+  case OutputFormat::Container::flac:
+    audioFormat = std::make_unique<FlacAudioFormat>();
+    qualityOption = jlimit(0, 8, settings.flacCompression);
+    break;
+  case OutputFormat::Container::aiff:
+    audioFormat = std::make_unique<AiffAudioFormat>();
+    break;
+  case OutputFormat::Container::wav:
+    audioFormat = std::make_unique<WavAudioFormat>();
+    break;
+  }
+
+  std::unique_ptr<AudioFormatWriter> writer(audioFormat->createWriterFor(
+      outputStream.get(), format.sampleRate,
+      static_cast<unsigned int>(numChannels), format.bitDepth, {},
+      qualityOption));
+
+  if (writer == nullptr) {
+    error = "Failed to create " + audioFormat->getFormatName() + " writer";
     return false;
   }
+
+  outputStream.release(); // Writer now owns the stream
+
+  if (writer->isFloatingPoint()) {
+    std::vector<const float *> channels;
+    for (int ch = 0; ch < numChannels; ++ch)
+      channels.push_back(audio.getReadPointer(stem.firstChannel + ch,
+                                              static_cast<int>(startSample)));
+    return writer->writeFromFloatArrays(channels.data(), numChannels,
+                                        static_cast<int>(numSamples));
+  }
+
+  // Integer formats: TPDF dither, then round to the target bit depth. The
+  // samples are passed left-justified in 32 bits, so the writer only drops
+  // bits that are already zero. Seeded by the file name, so re-rendering
+  // gives identical files.
+  Random random(file.getFileName().hashCode64());
+  const double scale = static_cast<double>(1 << (format.bitDepth - 1));
+  const int justify = 1 << (32 - format.bitDepth);
+
+  constexpr int blockSize = 4096;
+  HeapBlock<int> samples(static_cast<size_t>(numChannels) * blockSize);
+  std::vector<const int *> channels(static_cast<size_t>(numChannels) + 1,
+                                    nullptr);
+  for (int ch = 0; ch < numChannels; ++ch)
+    channels[static_cast<size_t>(ch)] = samples + ch * blockSize;
+
+  for (int64 pos = 0; pos < numSamples; pos += blockSize) {
+    const int count =
+        static_cast<int>(jmin<int64>(blockSize, numSamples - pos));
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+      const float *src = audio.getReadPointer(
+          stem.firstChannel + ch, static_cast<int>(startSample + pos));
+      int *dst = samples + ch * blockSize;
+
+      for (int i = 0; i < count; ++i) {
+        const double dither = random.nextDouble() - random.nextDouble();
+        const double level = std::floor(src[i] * scale + dither + 0.5);
+        dst[i] = static_cast<int>(jlimit(-scale, scale - 1.0, level)) * justify;
+      }
+    }
+
+    if (!writer->write(channels.data(), count)) {
+      error = "Failed to write " + file.getFileName();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ParallelBatchRenderer::checkOutputFile(const File &file) {
+  TRACE_SCOPE("Write", "Check file");
+
+  if (!file.existsAsFile()) {
+    ScopedLock sl(problemFilesLock);
+    problematicFiles.add(file.getFileName() + " [FILE NOT CREATED]");
+    return;
+  }
+
+  int64 fileSize = file.getSize();
+
+  // Check if file is empty or too small (< 1KB is suspicious for audio)
+  if (fileSize < 1024) {
+    ScopedLock sl(problemFilesLock);
+    problematicFiles.add(file.getFileName() + " [EMPTY/CORRUPT - " +
+                         String(fileSize) + " bytes]");
+    DBG("WARNING: File too small: " + file.getFileName());
+    return;
+  }
+
+  // Check for silent audio by reading and checking peak level
+  AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+  std::unique_ptr<AudioFormatReader> reader(
+      formatManager.createReaderFor(file));
+
+  if (reader != nullptr) {
+    // Read a sample of the audio to check levels (first second)
+    AudioBuffer<float> checkBuffer(
+        reader->numChannels,
+        jmin((int)reader->lengthInSamples, (int)reader->sampleRate));
+    reader->read(&checkBuffer, 0, checkBuffer.getNumSamples(), 0, true, true);
+
+    float peakLevel = checkBuffer.getMagnitude(0, checkBuffer.getNumSamples());
+
+    // If peak is below -60dB, file is essentially silent
+    if (peakLevel < 0.001f) { // ~-60dB
+      ScopedLock sl(problemFilesLock);
+      problematicFiles.add(
+          file.getFileName() + " [SILENT - peak: " +
+          String(20.0f * std::log10(peakLevel + 0.0001f), 1) + " dB]");
+      DBG("WARNING: Silent file: " + file.getFileName());
+    }
+  }
 }
@@ -7,25 +7,54 @@
     Created: 2024
     Author:  Federico De Biase / Ayra Soft
 
-    Parallel rendering with ayra_rapid_thread_pool.
-    Key constraint: One clip per row at a time (sequential per row, parallel
-  across rows).
+    Parallel rendering with ayra_rapid_thread_pool. Every job loads its own
+    plugin instance, so jobs of one row run side by side too, as many as
+    the plugin's concurrency limit, the workers and the memory budget
+    allow.
 
   ==============================================================================
 */
 
 #pragma once
 
+#include "ConcurrencyController.h"
+#include "RenderCostModel.h"
+#include "RenderManifest.h"
+#include "RenderThreadPolicy.h"
 #include <JuceHeader.h>
 #include <ayra_rapid_thread_pool/ayra_rapid_thread_pool.h>
+#include <deque>
+#include <map>
 
 //==============================================================================
 class ParallelBatchRenderer : public Timer {
 public:
   //==============================================================================
-  struct RenderSettings {
+  struct OutputFormat {
+    // All lossless. FLAC files are roughly half the size of WAV.
+    enum class Container { wav, flac, aiff };
+
     double sampleRate = 44100.0;
+    int bitDepth = 24; // 16 and 24 are dithered, 32 is float (WAV only)
+    Container container = Container::wav;
+
+    // e.g. "48k 24-bit" or "48k 24-bit FLAC", also the subfolder name with
+    // several formats
+    String getName() const;
+    String getFileExtension() const;
+  };
+
+  // Parses "44.1k/16, 48000/24/flac, ..." - the container (wav, flac or
+  // aiff) is optional. Invalid and repeated entries are skipped.
+  static std::vector<OutputFormat> parseOutputFormats(const String &text);
+
+  struct RenderSettings {
+    double sampleRate = 44100.0; // Synthesis rate
     int bitDepth = 24;
+    // Delivery formats, all derived from one synthesis pass at the highest
+    // rate listed (which replaces sampleRate). Empty means a single format
+    // at sampleRate/bitDepth. With several, each gets its own subfolder.
+    std::vector<OutputFormat> outputFormats;
     double bpm = 120.0;
     float silenceThresholdDb = -50.0f;
     float masterGainDb = 0.0f; // Master gain in dB to apply to all renders
@@ -35,6 +64,21 @@ public:
                                // half (includes tail)
     bool normalize = false;    // If true, apply LUFS normalization via FFmpeg
     double normalizationLufs = -12.0; // Target LUFS level
+    int memoryBudgetMB = 0; // Max estimated RAM for jobs in flight (0 = auto)
+    bool preferDoublePrecision =
+        false; // Process in 64-bit when the plugin supports it
+    // One file per output bus ("Stems/<name> [Kick].wav") from the same
+    // render. The main bus keeps the plain file name.
+    bool writeStems = false;
+    bool skipEmptyStems = true; // Drop extra buses that stayed below the
+                                // silence threshold
+    int flacCompression = 5;    // 0 (fastest) to 8 (smallest)
+    int maxWorkers = 0; // Jobs rendering at once (0 = one per core)
+
+    // Worker scheduling (see RenderThreadPolicy)
+    String workerCpuSet; // e.g. "2-7" leaves cores 0-1 to GUI and audio
+    int workerNiceLevel = 0;
+    bool workerLowPriority = false;
   };
 
   struct RenderJob {
@@ -44,11 +88,24 @@ public:
     String variationName;
     PluginDescription pluginDesc;
     MemoryBlock pluginState;
+    uint64 pluginStateHash = 0; // ContentHash of pluginState
     int pitchOffset = 0;
     float velocityMultiplier = 1.0f;
     float volumeDb = 0.0f;
     double bpm = 120.0; // BPM for this specific job (for tempo-synced plugins)
+    // Length from the MIDI library index, so that estimating the job does
+    // not parse the file. 0 = unknown, the file is read instead.
+    double midiLengthBeats = 0.0;
     File outputFile;
+
+    // Filled in by addJob()
+    String pluginKey;
+    double renderSeconds = 0.0; // Length of audio the job will synthesize
+    int64 estimatedBytes = 0;   // Render buffer + plugin instance footprint
+    double predictedSeconds = 0.0; // Wall-clock time from the cost model
+
+    bool isPriority = false; // Set by prioritizeJob()
+    double startMs = 0.0;    // Set when submitted
   };
 
   //==============================================================================
@@ -57,26 +114,73 @@ public:
   ~ParallelBatchRenderer() override;
 
   //==============================================================================
-  // Add a job. Jobs for the same row will be processed sequentially.
+  // Add a job. A row's jobs start longest first.
   void addJob(const RenderJob &job);
 
-  // Start rendering all queued jobs
-  void startRendering();
+  // Start rendering all queued jobs. A batch started paused admits nothing
+  // until resumeRendering().
+  void startRendering(bool startPaused = false);
 
   // Cancel all pending jobs
   void cancelRendering();
 
+  // Hold the queue: jobs in flight finish, the rest wait for resume. Only
+  // prioritized jobs still start while paused.
+  void pauseRendering();
+  void resumeRendering();
+  bool isPaused() const { return paused.load(); }
+
+  // Throttle: jobs rendering at once, from the next job boundary on
+  // (0 = one per core)
+  void setMaxWorkers(int maxWorkers);
+  int getMaxWorkers() const;
+
+  // Make a queued job the next one of its row, and its row the next one
+  // admitted. It starts as soon as a worker is free, even if
+  // the memory budget or its plugin's concurrency limit is used up (one
+  // priority job at a time gets this). The job is identified by its MIDI
+  // file, which stays valid when the library refreshes mid-batch and grid
+  // columns shift. Returns false if the job is not queued (done or in
+  // flight).
+  bool prioritizeJob(int rowIndex, const File &midiFile);
+
   //==============================================================================
   float getProgress() const;
   int getCompletedJobs() const { return completedCount.load(); }
   int getTotalJobs() const { return totalJobs; }
   bool isComplete() const { return completedCount.load() >= totalJobs; }
   bool isRendering() const { return rendering.load(); }
+  int64 getMemoryBudgetBytes() const { return memoryBudgetBytes; }
+
+  // Predicted time to finish the batch (cost model, corrected by the renders
+  // measured so far)
+  double getEstimatedSecondsRemaining() const;
+
+  int getFailedJobs() const { return failedCount.load(); }
+  int getCancelledJobs() const { return cancelledCount.load(); }
+
+  struct RowProgress {
+    int rowIndex = 0;
+    int finishedJobs = 0; // Completed or failed
+    int totalJobs = 0;
+  };
+  std::vector<RowProgress> getRowProgress() const;
+
+  struct FailedJob {
+    int rowIndex = 0;
+    int columnIndex = 0;
+    String error;
+  };
+  // Failures in the order they happened, from the given index on
+  std::vector<FailedJob> getFailedJobsSince(int index) const;
 
   //==============================================================================
   std::function<void()> onComplete;
   std::function<void(const String &error)> onError;
   std::function<void(float progress)> onProgress;
+  // A prioritized job's files are written and it is in the render manifest
+  // on disk, so it can be previewed (message thread)
+  std::function<void(int rowIndex, const File &midiFile)> onPriorityJobDone;
 
   // Warning flags
   bool wasFfmpegMissing() const { return ffmpegMissing.load(); }
@@ -87,44 +191,161 @@ public:
     return problematicFiles;
   }
 
+  //==============================================================================
+  static constexpr int renderBlockSize = 2048;
+  static const char *const stemsFolderName; // Next to each main file
+
+  // Render a sequence (timestamps in seconds) through a prepared plugin,
+  // filling the whole output buffer. shouldContinue is polled between
+  // blocks and may block to yield the CPU; returning false aborts the
+  // render and makes this return false. If channelPeaks is given, it
+  // receives the peak level of every output channel.
+  static bool renderSequence(AudioPluginInstance &plugin,
+                             const MidiMessageSequence &midiSeq,
+                             double sampleRate, double bpm,
+                             bool useDoublePrecision,
+                             AudioBuffer<float> &output,
+                             const std::function<bool()> &shouldContinue,
+                             std::vector<float> *channelPeaks = nullptr);
+
+  // True while any batch render is in progress, so background work can
+  // stay out of its way
+  static bool isAnyRenderActive() { return activeRenderers.load() > 0; }
+
 private:
   //==============================================================================
-  // Queue for each row - jobs are processed sequentially within a row
+  // Queue for each row, longest predicted job first
   struct RowQueue {
     int rowIndex = 0;
-    std::queue<RenderJob> jobs;
-    std::atomic<bool> isProcessing{false};
+    std::deque<RenderJob> jobs;
+
+    double queuedSeconds = 0.0; // Sum of predictedSeconds in jobs
+    // Jobs being synthesized: start time -> predicted seconds
+    std::multimap<double, double> running;
+
+    int numJobs = 0; // Added to this row, for per-row progress
+    int numFinished = 0;
+
+    bool hasPriorityJob() const {
+      return !jobs.empty() && jobs.front().isPriority;
+    }
+  };
+
+  // Channels of the render that go to one file
+  struct Stem {
+    String busName; // Empty for the main output
+    int firstChannel = 0;
+    int numChannels = 0;
+  };
+
+  // A finished render on its way to disk, shared by the writer tasks so the
+  // audio is freed once its last file is written
+  struct RenderedJob {
+    RenderJob job;
+    AudioBuffer<float> buffer; // As rendered, latency included
+    AudioBuffer<float> audio;  // Latency-compensated view into buffer
+    std::vector<Stem> stems;
+    int64 startSample = 0; // Range of audio to write
+    int64 numSamples = 0;
+
+    std::atomic<int> filesPending{0};
+    CriticalSection errorLock;
+    String error;
   };
 
   //==============================================================================
   void timerCallback() override;
-  void processNextJobForRow(int rowIndex);
-  bool renderSingleJob(const RenderJob &job);
-  void onJobCompleted(int rowIndex, bool success, const String &error);
+  void scheduleJobs();
+  RowQueue *pickNextRow();
+  void submitJob(RowQueue &queue);
+  std::shared_ptr<RenderedJob> renderSingleJob(const RenderJob &job);
+  std::vector<Stem> getStems(const AudioPluginInstance &plugin,
+                             const std::vector<float> &channelPeaks,
+                             int numChannels) const;
+  void writeOutputs(std::shared_ptr<RenderedJob> rendered);
+  void queueFileWrites(std::shared_ptr<RenderedJob> rendered,
+                       std::shared_ptr<const AudioBuffer<float>> resampled,
+                       const std::vector<size_t> &formatIndices,
+                       int64 startSample, int64 numSamples);
+  bool writeAudioFile(const File &file, const AudioBuffer<float> &audio,
+                      const Stem &stem, int64 startSample, int64 numSamples,
+                      const OutputFormat &format, String &error) const;
+  void checkOutputFile(const File &file);
+  File getOutputFile(const RenderJob &job, size_t formatIndex,
+                     const String &busName = {}) const;
+  static RenderSettings withOutputFormats(RenderSettings settings);
+  void onJobRendered(const RenderJob &job, bool success);
+  void saveConcurrencyLimits();
+  void onJobCompleted(const RenderJob &job, bool success, const String &error);
+  void onJobCancelled(const RenderJob &job);
+  void releaseJob(const RenderJob &job, bool finished);
+
+  double estimateRenderSeconds(const RenderJob &job);
+  int64 estimateJobBytes(const RenderJob &job) const;
+  bool isLargeJob(const RenderJob &job) const;
+  void setRendering(bool isNowRendering);
+
+  static RenderManifest::JobInputs getManifestInputs(const RenderJob &job);
 
   //==============================================================================
   ayra::PluginsManager &pluginsManager;
   RenderSettings settings;
   File outputDirectory;
+  RenderCostModel costModel; // Declared before the pool: jobs write to it
+  RenderManifest manifest;   // Finished renders, for instant preview
 
+  RenderThreadPolicy threadPolicy; // Applied by every render and write task
+
+  // Disk-writer stage: resamples, encodes and writes each file of a finished
+  // render as its own task, off the render workers
+  ThreadPool writerPool;
   ayra::RapidThreadPool threadPool;
+  std::atomic<int> unfinishedJobs{0}; // Render or write tasks still running
 
-  CriticalSection queueLock;
+  mutable CriticalSection queueLock;
   OwnedArray<RowQueue> rowQueues;
 
+  // Memory admission control (guarded by queueLock)
+  int64 memoryBudgetBytes = 0;
+  int64 inFlightBytes = 0;
+  int inFlightJobs = 0;
+  int largeJobsInFlight = 0;
+  int priorityJobsInFlight = 0;
+  int maxWorkers = 0; // Resolved, never 0
+
+  // Per-plugin concurrency, keyed by RenderCostModel::getPluginKey()
+  // (guarded by queueLock)
+  struct PluginLimit {
+    PluginDescription desc;
+    ConcurrencyController controller;
+    int jobsInFlight = 0;
+    int jobsQueued = 0;
+  };
+  std::map<String, PluginLimit> pluginLimits;
+  std::map<String, double> clipDurationCache; // midi path@bpm -> seconds
+
+  // ETA calibration (guarded by queueLock)
+  double completedPredictedSeconds = 0.0;
+  double completedActualSeconds = 0.0;
+
   std::atomic<int> completedCount{0};
   std::atomic<int> failedCount{0};
+  std::atomic<int> cancelledCount{0}; // Stopped by cancelRendering
   std::atomic<bool> rendering{false};
+  static std::atomic<int> activeRenderers;
   std::atomic<bool> cancelled{false};
+  std::atomic<bool> paused{false};
   std::atomic<bool> ffmpegMissing{
       false}; // Set if normalization requested but FFmpeg not found
 
   int totalJobs = 0;
   String lastError;
 
-  // Track problematic files
+  // Track problematic files and failed jobs
   mutable CriticalSection problemFilesLock;
   StringArray problematicFiles;
+  std::vector<FailedJob> failedJobs;
+  std::vector<std::pair<int, File>> finishedPriorityJobs; // Row, MIDI file
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelBatchRenderer)
 };
@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+#include <numeric>
+
+static constexpr double stopbandAttenuationDb = 120.0;
+static constexpr double passbandEdge = 0.9; // Fraction of the lower Nyquist
+
+// Zeroth-order modified Bessel function of the first kind
+static double besselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 64 && term > sum * 1.0e-12; ++k) {
+    const double half = x / (2.0 * k);
+    term *= half * half;
+    sum += term;
+  }
+  return sum;
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler(double sourceRate, double targetRate) {
+  const int source = roundToInt(sourceRate);
+  const int target = roundToInt(targetRate);
+  jassert(source > 0 && target > 0);
+
+  const int divisor = std::gcd(source, target);
+  upFactor = target / divisor;
+  downFactor = source / divisor;
+  jassert(upFactor <= 4096); // Fine for the usual audio rates
+
+  if (isIdentity())
+    return;
+
+  // Filter at the upsampled rate: cutoff halfway through the transition
+  // band, which runs from the passband edge to the lower Nyquist
+  const int maxFactor = jmax(upFactor, downFactor);
+  const double transition = (1.0 - passbandEdge) * 0.5 / maxFactor;
+  const double cutoff = (1.0 + passbandEdge) * 0.25 / maxFactor;
+
+  // Kaiser's estimates for the window length and shape
+  const double beta = 0.1102 * (stopbandAttenuationDb - 8.7);
+  const double length =
+      (stopbandAttenuationDb - 7.95) / (14.36 * transition);
+
+  tapsPerPhase = static_cast<int>(std::ceil(length / upFactor));
+  tapsPerPhase += tapsPerPhase % 2; // Keeps the filter delay whole
+
+  const int numTaps = tapsPerPhase * upFactor;
+  filterDelay = numTaps / 2;
+
+  coefficients.assign(static_cast<size_t>(numTaps), 0.0f);
+  const double windowNorm = 1.0 / besselI0(beta);
+
+  for (int n = 0; n < numTaps; ++n) {
+    const double x = n - static_cast<double>(filterDelay);
+    const double ratio = x / static_cast<double>(filterDelay);
+    const double window =
+        besselI0(beta * std::sqrt(jmax(0.0, 1.0 - ratio * ratio))) *
+        windowNorm;
+
+    const double arg = MathConstants<double>::twoPi * cutoff * x;
+    const double sinc = x == 0.0 ? 1.0 : std::sin(arg) / arg;
+
+    // Gain of upFactor makes up for the zeros inserted when upsampling
+    const double h = 2.0 * cutoff * sinc * window * upFactor;
+
+    const int phase = n % upFactor;
+    const int tap = n / upFactor;
+    coefficients[static_cast<size_t>(phase * tapsPerPhase +
+                                     (tapsPerPhase - 1 - tap))] =
+        static_cast<float>(h);
+  }
+}
+
+int64 PolyphaseResampler::getOutputLength(int64 numInputSamples) const {
+  return (numInputSamples * upFactor + downFactor - 1) / downFactor;
+}
+
+//==============================================================================
+AudioBuffer<float> PolyphaseResampler::process(const AudioBuffer<float> &input,
+                                               int startSample,
+                                               int numSamples) const {
+  const int numChannels = input.getNumChannels();
+  const int numOutput = static_cast<int>(getOutputLength(numSamples));
+  AudioBuffer<float> output(numChannels, numOutput);
+
+  for (int ch = 0; ch < numChannels; ++ch) {
+    if (isIdentity())
+      output.copyFrom(ch, 0, input, ch, startSample, numSamples);
+    else
+      processChannel(input.getReadPointer(ch, startSample), numSamples,
+                     output.getWritePointer(ch), numOutput);
+  }
+
+  return output;
+}
+
+void PolyphaseResampler::processChannel(const float *input, int numInput,
+                                        float *output, int numOutput) const {
+  // Zero padding on both sides keeps the inner loop free of bounds checks
+  std::vector<float> padded(static_cast<size_t>(numInput + 2 * tapsPerPhase),
+                            0.0f);
+  std::copy(input, input + numInput, padded.begin() + tapsPerPhase);
+
+  for (int m = 0; m < numOutput; ++m) {
+    const int64 position = static_cast<int64>(m) * downFactor + filterDelay;
+    const auto inputIndex = static_cast<size_t>(position / upFactor);
+    const auto phase = static_cast<size_t>(position % upFactor);
+
+    const float *taps = coefficients.data() + phase * tapsPerPhase;
+    const float *samples = padded.data() + inputIndex + 1;
+
+    float sum = 0.0f;
+    for (int k = 0; k < tapsPerPhase; ++k)
+      sum += taps[k] * samples[k];
+    output[m] = sum;
+  }
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Offline sample rate conversion between integer rates with a rational
+    polyphase filter: a Kaiser-windowed sinc designed for 120 dB of
+    stopband rejection, flat to 90% of the lower Nyquist frequency. Output
+    sample 0 lines up with input sample 0 (the filter delay is removed).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+class PolyphaseResampler {
+public:
+  //==============================================================================
+  PolyphaseResampler(double sourceRate, double targetRate);
+
+  bool isIdentity() const { return upFactor == downFactor; }
+  int64 getOutputLength(int64 numInputSamples) const;
+
+  // Resample a range of every channel into a new buffer
+  AudioBuffer<float> process(const AudioBuffer<float> &input, int startSample,
+                             int numSamples) const;
+
+private:
+  //==============================================================================
+  int upFactor = 1;
+  int downFactor = 1;
+  int tapsPerPhase = 0;
+  int64 filterDelay = 0; // In upsampled samples
+
+  // One row of tapsPerPhase per phase, stored in reverse so each output
+  // sample is a dot product over consecutive input samples
+  std::vector<float> coefficients;
+
+  void processChannel(const float *input, int numInput, float *output,
+                      int numOutput) const;
+};
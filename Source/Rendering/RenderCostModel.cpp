@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    RenderCostModel.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "RenderCostModel.h"
+
+#if JUCE_MAC
+#include <mach/mach.h>
+#elif JUCE_LINUX
+#include <unistd.h>
+#endif
+
+static const char *const costModelSettingsKey = "renderCostModel";
+
+// Loads in progress across the process, and a count of loads ever started
+// so a probe can tell whether another one began during its own
+static CriticalSection loadProbeLock;
+static int loadsInFlight = 0;
+static uint32 loadEpoch = 0;
+
+//==============================================================================
+RenderCostModel::RenderCostModel() { load(); }
+
+//==============================================================================
+void RenderCostModel::load() {
+  auto *userSettings = ayra::app_properties->getUserSettings();
+  auto xml = userSettings->getXmlValue(costModelSettingsKey);
+
+  const ScopedLock sl(lock);
+  costs.clear();
+
+  if (xml == nullptr)
+    return;
+
+  for (auto *pluginXml : xml->getChildWithTagNameIterator("Plugin")) {
+    PluginCosts entry;
+    entry.instanceBytes =
+        pluginXml->getStringAttribute("instanceBytes").getLargeIntValue();
+    entry.numMemorySamples = pluginXml->getIntAttribute("memorySamples", 0);
+    entry.secondsPerClipSecond =
+        pluginXml->getDoubleAttribute("secondsPerClipSecond", 0.0);
+    entry.loadSeconds = pluginXml->getDoubleAttribute("loadSeconds", 0.0);
+    entry.numTimeSamples = pluginXml->getIntAttribute("timeSamples", 0);
+    entry.concurrency = pluginXml->getIntAttribute("concurrency", 0);
+    entry.bufferChannels = pluginXml->getIntAttribute("bufferChannels", 0);
+    entry.latencySamples = pluginXml->getIntAttribute("latency", 0);
+    costs[pluginXml->getStringAttribute("id")] = entry;
+  }
+}
+
+void RenderCostModel::save() const {
+  XmlElement xml("RenderCostModel");
+
+  {
+    const ScopedLock sl(lock);
+    for (auto &[key, entry] : costs) {
+      auto *pluginXml = xml.createNewChildElement("Plugin");
+      pluginXml->setAttribute("id", key);
+      pluginXml->setAttribute("instanceBytes", String(entry.instanceBytes));
+      pluginXml->setAttribute("memorySamples", entry.numMemorySamples);
+      pluginXml->setAttribute("secondsPerClipSecond",
+                              entry.secondsPerClipSecond);
+      pluginXml->setAttribute("loadSeconds", entry.loadSeconds);
+      pluginXml->setAttribute("timeSamples", entry.numTimeSamples);
+      if (entry.concurrency > 0)
+        pluginXml->setAttribute("concurrency", entry.concurrency);
+      if (entry.bufferChannels > 0) {
+        pluginXml->setAttribute("bufferChannels", entry.bufferChannels);
+        pluginXml->setAttribute("latency", entry.latencySamples);
+      }
+    }
+  }
+
+  ayra::app_properties->getUserSettings()->setValue(costModelSettingsKey, &xml);
+  ayra::app_properties->getUserSettings()->saveIfNeeded();
+}
+
+//==============================================================================
+int64 RenderCostModel::getInstanceBytes(const PluginDescription &desc) const {
+  const ScopedLock sl(lock);
+
+  auto it = costs.find(getPluginKey(desc));
+  if (it == costs.end() || it->second.numMemorySamples == 0)
+    return defaultInstanceBytes;
+
+  return it->second.instanceBytes;
+}
+
+void RenderCostModel::recordInstanceBytes(const PluginDescription &desc,
+                                          int64 bytes) {
+  if (bytes <= 0)
+    return;
+
+  const ScopedLock sl(lock);
+  auto &entry = costs[getPluginKey(desc)];
+
+  // Samples come from loads that ran alone (see LoadProbe), but render
+  // buffers allocated meanwhile still add noise, so they are smoothed
+  if (entry.numMemorySamples == 0)
+    entry.instanceBytes = bytes;
+  else
+    entry.instanceBytes = (entry.instanceBytes * 3 + bytes) / 4;
+
+  entry.numMemorySamples++;
+}
+
+//==============================================================================
+double RenderCostModel::predictJobSeconds(const PluginDescription &desc,
+                                          double clipSeconds) const {
+  const ScopedLock sl(lock);
+
+  auto it = costs.find(getPluginKey(desc));
+  if (it == costs.end() || it->second.numTimeSamples == 0)
+    return defaultLoadSeconds + clipSeconds * defaultSecondsPerClipSecond;
+
+  return it->second.loadSeconds +
+         clipSeconds * it->second.secondsPerClipSecond;
+}
+
+void RenderCostModel::recordRenderTime(const PluginDescription &desc,
+                                       double clipSeconds, double loadSeconds,
+                                       double renderSeconds) {
+  if (clipSeconds <= 0.0)
+    return;
+
+  const ScopedLock sl(lock);
+  auto &entry = costs[getPluginKey(desc)];
+
+  const double factor = renderSeconds / clipSeconds;
+
+  if (entry.numTimeSamples == 0) {
+    entry.secondsPerClipSecond = factor;
+    entry.loadSeconds = loadSeconds;
+  } else {
+    entry.secondsPerClipSecond =
+        entry.secondsPerClipSecond * 0.8 + factor * 0.2;
+    entry.loadSeconds = entry.loadSeconds * 0.8 + loadSeconds * 0.2;
+  }
+
+  entry.numTimeSamples++;
+}
+
+//==============================================================================
+int RenderCostModel::getBufferChannels(const PluginDescription &desc) const {
+  const ScopedLock sl(lock);
+
+  auto it = costs.find(getPluginKey(desc));
+  return it != costs.end() ? it->second.bufferChannels : 0;
+}
+
+int RenderCostModel::getLatencySamples(const PluginDescription &desc) const {
+  const ScopedLock sl(lock);
+
+  auto it = costs.find(getPluginKey(desc));
+  return it != costs.end() ? it->second.latencySamples : 0;
+}
+
+void RenderCostModel::recordBufferShape(const PluginDescription &desc,
+                                        int channels, int latencySamples) {
+  if (channels <= 0)
+    return;
+
+  const ScopedLock sl(lock);
+  auto &entry = costs[getPluginKey(desc)];
+  entry.bufferChannels = channels;
+  entry.latencySamples = jmax(0, latencySamples);
+}
+
+//==============================================================================
+int RenderCostModel::getConcurrency(const PluginDescription &desc) const {
+  const ScopedLock sl(lock);
+
+  auto it = costs.find(getPluginKey(desc));
+  return it != costs.end() ? it->second.concurrency : 0;
+}
+
+void RenderCostModel::recordConcurrency(const PluginDescription &desc,
+                                        int jobs) {
+  if (jobs <= 0)
+    return;
+
+  const ScopedLock sl(lock);
+  costs[getPluginKey(desc)].concurrency = jobs;
+}
+
+//==============================================================================
+String RenderCostModel::getPluginKey(const PluginDescription &desc) {
+  return desc.createIdentifierString();
+}
+
+RenderCostModel::LoadProbe::LoadProbe() {
+  {
+    const ScopedLock sl(loadProbeLock);
+    alone = loadsInFlight++ == 0;
+    startEpoch = ++loadEpoch;
+  }
+
+  residentBefore = getProcessResidentBytes();
+}
+
+RenderCostModel::LoadProbe::~LoadProbe() { finish(); }
+
+int64 RenderCostModel::LoadProbe::finish() {
+  if (finished)
+    return -1;
+  finished = true;
+
+  const int64 residentAfter = getProcessResidentBytes();
+
+  const ScopedLock sl(loadProbeLock);
+  loadsInFlight--;
+  if (!alone || loadEpoch != startEpoch || residentBefore <= 0 ||
+      residentAfter <= 0)
+    return -1;
+
+  return residentAfter - residentBefore;
+}
+
+int64 RenderCostModel::getProcessResidentBytes() {
+#if JUCE_MAC
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+    return static_cast<int64>(info.resident_size);
+  return 0;
+#elif JUCE_LINUX
+  // statm: size resident shared text lib data dt (in pages)
+  auto fields = StringArray::fromTokens(
+      File("/proc/self/statm").loadFileAsString(), " ", "");
+  if (fields.size() < 2)
+    return 0;
+  return fields[1].getLargeIntValue() *
+         static_cast<int64>(sysconf(_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
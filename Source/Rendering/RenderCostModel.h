@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    RenderCostModel.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Persistent per-plugin cost database used by the render scheduler.
+    Costs are learned from measured renders and stored in the user settings
+    so later batches can plan before anything has been rendered.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class RenderCostModel {
+public:
+  //==============================================================================
+  RenderCostModel();
+  ~RenderCostModel() = default;
+
+  //==============================================================================
+  void load();
+  void save() const;
+
+  //==============================================================================
+  // Estimated resident memory of one live instance of the plugin. Returns
+  // the default estimate until a measurement has been recorded.
+  int64 getInstanceBytes(const PluginDescription &desc) const;
+  void recordInstanceBytes(const PluginDescription &desc, int64 bytes);
+
+  //==============================================================================
+  // Predicted wall-clock time to render a clip of the given length: plugin
+  // load time plus render time normalized by clip duration.
+  double predictJobSeconds(const PluginDescription &desc,
+                           double clipSeconds) const;
+  void recordRenderTime(const PluginDescription &desc, double clipSeconds,
+                        double loadSeconds, double renderSeconds);
+
+  //==============================================================================
+  // Render buffer of the plugin's last job: channels (outputs, or inputs if
+  // there are more) and latency in samples. 0 until it has been rendered.
+  int getBufferChannels(const PluginDescription &desc) const;
+  int getLatencySamples(const PluginDescription &desc) const;
+  void recordBufferShape(const PluginDescription &desc, int channels,
+                         int latencySamples);
+
+  //==============================================================================
+  // Number of the plugin's jobs that rendered fastest side by side in past
+  // batches (see ConcurrencyController), or 0 if never measured
+  int getConcurrency(const PluginDescription &desc) const;
+  void recordConcurrency(const PluginDescription &desc, int jobs);
+
+  //==============================================================================
+  static String getPluginKey(const PluginDescription &desc);
+
+  // Resident set size of this process in bytes (0 if unavailable)
+  static int64 getProcessResidentBytes();
+
+  // Brackets one plugin load (and prepare) to measure the memory it adds.
+  // The RSS is process-wide, so a load that overlaps another one - on a
+  // render worker or in the preview pool - would count the other's
+  // allocations; such samples are discarded rather than smoothed.
+  class LoadProbe {
+  public:
+    LoadProbe();
+    ~LoadProbe();
+
+    // Ends the load: bytes added since construction, or -1 if another
+    // load overlapped or the RSS is unavailable. A probe destroyed without
+    // finishing (a failed load) is simply discarded.
+    int64 finish();
+
+  private:
+    int64 residentBefore = 0;
+    uint32 startEpoch = 0;
+    bool alone = false;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE(LoadProbe)
+  };
+
+  static constexpr int64 defaultInstanceBytes = 256ll * 1024 * 1024;
+  static constexpr double defaultSecondsPerClipSecond = 0.1;
+  static constexpr double defaultLoadSeconds = 1.0;
+
+private:
+  //==============================================================================
+  struct PluginCosts {
+    int64 instanceBytes = 0;
+    int numMemorySamples = 0;
+
+    double secondsPerClipSecond = 0.0; // Render time / clip duration
+    double loadSeconds = 0.0;
+    int numTimeSamples = 0;
+
+    int concurrency = 0;
+
+    int bufferChannels = 0;
+    int latencySamples = 0;
+  };
+
+  mutable CriticalSection lock;
+  std::map<String, PluginCosts> costs;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderCostModel)
+};
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    RenderManifest.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "RenderManifest.h"
+#include "ContentHash.h"
+
+const char *const RenderManifest::manifestFileName = ".fpc_renders.xml";
+
+//==============================================================================
+String RenderManifest::computeKey(const JobInputs &inputs) {
+  ContentHash hash;
+  hash.add(inputs.pluginDesc.createIdentifierString())
+      .add(static_cast<int64>(inputs.pluginStateHash))
+      // The MIDI file is identified by path and a stat, not its contents:
+      // editing it in place changes the date and invalidates the render
+      .add(inputs.midiFile.getFullPathName())
+      .add(inputs.midiFile.getLastModificationTime().toMilliseconds())
+      .add(inputs.midiFile.getSize())
+      .add(inputs.pitchOffset)
+      .add(inputs.velocityMultiplier)
+      .add(inputs.volumeDb)
+      .add(inputs.bpm);
+  return hash.toString();
+}
+
+//==============================================================================
+RenderManifest::RenderManifest(const File &outputDir) { load(outputDir); }
+
+void RenderManifest::load(const File &outputDir) {
+  const ScopedLock sl(lock);
+  outputDirectory = outputDir;
+  renders.clear();
+
+  auto xml = parseXML(outputDirectory.getChildFile(manifestFileName));
+  if (xml == nullptr || !xml->hasTagName("RenderManifest"))
+    return;
+
+  for (auto *renderXml : xml->getChildWithTagNameIterator("Render"))
+    renders[renderXml->getStringAttribute("key")] =
+        renderXml->getStringAttribute("file");
+}
+
+void RenderManifest::save() const {
+  XmlElement xml("RenderManifest");
+
+  {
+    const ScopedLock sl(lock);
+    if (!outputDirectory.isDirectory() || renders.empty())
+      return;
+
+    for (auto &[key, relativePath] : renders) {
+      auto *renderXml = xml.createNewChildElement("Render");
+      renderXml->setAttribute("key", key);
+      renderXml->setAttribute("file", relativePath);
+    }
+  }
+
+  auto manifestFile = outputDirectory.getChildFile(manifestFileName);
+  if (!xml.writeTo(manifestFile))
+    DBG("Failed to save render manifest: " + manifestFile.getFullPathName());
+}
+
+//==============================================================================
+void RenderManifest::add(const String &key, const File &renderedFile) {
+  const ScopedLock sl(lock);
+  renders[key] = renderedFile.getRelativePathFrom(outputDirectory);
+}
+
+File RenderManifest::find(const String &key) const {
+  const ScopedLock sl(lock);
+
+  auto it = renders.find(key);
+  if (it == renders.end())
+    return {};
+
+  auto file = outputDirectory.getChildFile(it->second);
+  return file.existsAsFile() ? file : File();
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    RenderManifest.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Records which rendered file belongs to which set of job inputs, so a
+    cell can be auditioned from its render instead of the live plugin.
+    Stored as an XML file in the render output folder.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class RenderManifest {
+public:
+  //==============================================================================
+  // Everything that determines the musical content of a cell. Output
+  // settings (master gain, sample rate, loop trimming, normalization) are
+  // left out on purpose: any render of the same content can be auditioned.
+  struct JobInputs {
+    PluginDescription pluginDesc;
+    // Only needed to render the cell: the key uses pluginStateHash, so a
+    // state is hashed once per version rather than once per cell
+    MemoryBlock pluginState;
+    uint64 pluginStateHash = 0; // ContentHash of pluginState
+    File midiFile;
+    int pitchOffset = 0;
+    float velocityMultiplier = 1.0f;
+    float volumeDb = 0.0f;
+    double bpm = 120.0;
+  };
+
+  static String computeKey(const JobInputs &inputs);
+
+  //==============================================================================
+  RenderManifest() = default;
+  explicit RenderManifest(const File &outputDir);
+
+  void load(const File &outputDir);
+  void save() const;
+
+  void add(const String &key, const File &renderedFile);
+  // Rendered file for the key, or File() if unknown or deleted since
+  File find(const String &key) const;
+
+  const File &getOutputDirectory() const { return outputDirectory; }
+
+  static const char *const manifestFileName;
+
+private:
+  //==============================================================================
+  File outputDirectory;
+
+  mutable CriticalSection lock;
+  std::map<String, String> renders; // Key -> path relative to the folder
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderManifest)
+};
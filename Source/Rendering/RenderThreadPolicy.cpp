@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    RenderThreadPolicy.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "RenderThreadPolicy.h"
+
+#if JUCE_MAC
+#include <pthread.h>
+#elif JUCE_LINUX
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic<int> RenderThreadPolicy::nextGeneration{1};
+
+//==============================================================================
+RenderThreadPolicy::RenderThreadPolicy(const String &cpuSet, int nice,
+                                       bool lowPriorityClass)
+    : cpus(parseCpuSet(cpuSet)), niceLevel(jlimit(0, 19, nice)),
+      lowPriority(lowPriorityClass), generation(nextGeneration++) {}
+
+std::vector<int> RenderThreadPolicy::parseCpuSet(const String &text) {
+  const int numCpus = SystemStats::getNumCpus();
+  std::vector<int> result;
+
+  for (auto &range : StringArray::fromTokens(text, ",", {})) {
+    const String first = range.upToFirstOccurrenceOf("-", false, false).trim();
+    const String last = range.fromFirstOccurrenceOf("-", false, false).trim();
+    if (!first.containsOnly("0123456789") || first.isEmpty() ||
+        !last.containsOnly("0123456789"))
+      continue;
+
+    const int start = first.getIntValue();
+    const int end = last.isNotEmpty() ? last.getIntValue() : start;
+    for (int cpu = start; cpu <= jmin(end, numCpus - 1); ++cpu)
+      if (std::find(result.begin(), result.end(), cpu) == result.end())
+        result.push_back(cpu);
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+//==============================================================================
+void RenderThreadPolicy::applyToCurrentThread() const {
+  thread_local int appliedGeneration = 0;
+  if (generation == 0 || appliedGeneration == generation)
+    return;
+  appliedGeneration = generation;
+
+#if JUCE_LINUX
+  // On Linux each of these affects only the thread whose id is given
+  const auto tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+  if (!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus)
+      CPU_SET(cpu, &set);
+    if (sched_setaffinity(tid, sizeof(set), &set) != 0)
+      DBG("Render thread: could not set CPU affinity");
+  }
+
+  if (lowPriority) {
+    sched_param param{};
+    if (sched_setscheduler(tid, SCHED_BATCH, &param) != 0)
+      DBG("Render thread: could not switch to SCHED_BATCH");
+  }
+
+  // Raising the nice level needs no privileges; it is never lowered here
+  if (niceLevel > 0 && setpriority(PRIO_PROCESS, static_cast<id_t>(tid),
+                                   niceLevel) != 0)
+    DBG("Render thread: could not set nice level");
+#else
+  if (!cpus.empty()) {
+    // JUCE takes a 32-bit mask; no effect on macOS
+    uint32 mask = 0;
+    for (auto cpu : cpus)
+      if (cpu < 32)
+        mask |= 1u << cpu;
+    if (mask != 0)
+      Thread::setCurrentThreadAffinityMask(mask);
+  }
+
+#if JUCE_MAC
+  if (lowPriority)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#endif
+#endif
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    RenderThreadPolicy.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Scheduling of the threads that render and write a batch: which cores
+    they may run on and how they rank against the GUI and the audio
+    device. The pools' threads are not ours to create, so every job applies
+    the policy on entry; it only takes effect the first time a thread runs
+    a job under a given policy.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+class RenderThreadPolicy {
+public:
+  //==============================================================================
+  RenderThreadPolicy() = default;
+
+  // cpuSet: cores the workers may use, e.g. "2-7,10" (empty = any).
+  // niceLevel: 0-19, applied on Linux. lowPriority: SCHED_BATCH on Linux,
+  // the utility QoS class on macOS.
+  RenderThreadPolicy(const String &cpuSet, int niceLevel, bool lowPriority);
+
+  void applyToCurrentThread() const;
+
+  // Parses "0-3,6" into core indices; cores this machine lacks are dropped
+  static std::vector<int> parseCpuSet(const String &text);
+
+private:
+  //==============================================================================
+  std::vector<int> cpus;
+  int niceLevel = 0;
+  bool lowPriority = false;
+  int generation = 0; // Tells threads that a new policy is in use
+
+  static std::atomic<int> nextGeneration;
+};
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+#include <vector>
+
+static constexpr uint64 eventsPerThread = 1 << 16; // Power of two
+static constexpr int maxRetiredBuffers = 16;
+
+//==============================================================================
+struct TraceRecorder::Event {
+  const char *category = nullptr;
+  const char *name = nullptr;
+  int64 startTicks = 0;
+  int64 endTicks = 0;
+};
+
+// Written by its thread only. Once full, the oldest events are overwritten.
+struct TraceRecorder::ThreadBuffer {
+  int threadId = 0;
+  String threadName;
+  std::vector<Event> events = std::vector<Event>(eventsPerThread);
+  std::atomic<uint64> numWritten{0};
+  std::atomic<bool> retired{false}; // Its thread has exited
+};
+
+struct TraceRecorder::Registry {
+  CriticalSection lock;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  int nextThreadId = 1;
+};
+
+std::atomic<bool> TraceRecorder::enabled{false};
+std::atomic<int64> TraceRecorder::recordingStartTicks{0};
+
+//==============================================================================
+void TraceRecorder::setEnabled(bool shouldRecord) {
+  if (shouldRecord && !enabled.load())
+    recordingStartTicks.store(Time::getHighResolutionTicks());
+
+  enabled.store(shouldRecord);
+}
+
+TraceRecorder::Registry &TraceRecorder::getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+void TraceRecorder::record(const char *category, const char *name,
+                           int64 startTicks, int64 endTicks) {
+  // Zones that began before the current recording are left out
+  if (startTicks < recordingStartTicks.load(std::memory_order_relaxed))
+    return;
+
+  auto *buffer = getThreadBuffer(category);
+  const auto index = buffer->numWritten.load(std::memory_order_relaxed);
+  buffer->events[index & (eventsPerThread - 1)] = {category, name, startTicks,
+                                                   endTicks};
+  buffer->numWritten.store(index + 1, std::memory_order_release);
+}
+
+TraceRecorder::ThreadBuffer *
+TraceRecorder::getThreadBuffer(const char *category) {
+  // Marks the buffer retired when its thread exits, so the events stay
+  // exportable and the buffer can later go to a new thread
+  struct Owner {
+    ThreadBuffer *buffer = nullptr;
+    ~Owner() {
+      if (buffer != nullptr)
+        buffer->retired.store(true);
+    }
+  };
+  thread_local Owner owner;
+
+  if (owner.buffer != nullptr)
+    return owner.buffer;
+
+  auto &registry = getRegistry();
+  const ScopedLock sl(registry.lock);
+
+  // Short-lived threads (FFmpeg workers) come and go: past a few retired
+  // buffers, the oldest is reused instead of growing the registry
+  ThreadBuffer *buffer = nullptr;
+  int numRetired = 0;
+  for (auto &candidate : registry.buffers) {
+    if (candidate->retired.load()) {
+      if (buffer == nullptr)
+        buffer = candidate.get();
+      numRetired++;
+    }
+  }
+
+  if (buffer == nullptr || numRetired < maxRetiredBuffers) {
+    registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = registry.buffers.back().get();
+  }
+
+  buffer->threadId = registry.nextThreadId++;
+  buffer->numWritten.store(0);
+  buffer->retired.store(false);
+
+  // Threads not started by JUCE (the audio device, FFmpeg workers) are
+  // named after the first zone they record
+  if (auto *thread = Thread::getCurrentThread())
+    buffer->threadName = thread->getThreadName();
+  else if (MessageManager::existsAndIsCurrentThread())
+    buffer->threadName = "Message Thread";
+  else
+    buffer->threadName = String(category) + " Thread";
+
+  owner.buffer = buffer;
+  return buffer;
+}
+
+//==============================================================================
+bool TraceRecorder::exportChromeTrace(const File &file) {
+  FileOutputStream out(file);
+  if (!out.openedOk())
+    return false;
+
+  out.setPosition(0);
+  out.truncate();
+
+  const int64 originTicks = recordingStartTicks.load();
+  auto toMicroseconds = [](int64 ticks) {
+    return String(Time::highResolutionTicksToSeconds(ticks) * 1.0e6, 3);
+  };
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":"
+         "{\"name\":\"Fast Pack Creator\"}}";
+
+  auto &registry = getRegistry();
+  const ScopedLock sl(registry.lock);
+
+  std::vector<Event> events;
+  for (auto &buffer : registry.buffers) {
+    const String tid(buffer->threadId);
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+        << ",\"args\":{\"name\":" << JSON::toString(buffer->threadName)
+        << "}}";
+
+    const uint64 end = buffer->numWritten.load(std::memory_order_acquire);
+    const uint64 begin = end > eventsPerThread ? end - eventsPerThread : 0;
+    events.clear();
+    for (uint64 i = begin; i < end; ++i)
+      events.push_back(buffer->events[i & (eventsPerThread - 1)]);
+
+    // The thread keeps recording while this copies; events it may have
+    // overwritten meanwhile are dropped
+    const uint64 after = buffer->numWritten.load(std::memory_order_acquire);
+    const uint64 firstIntact =
+        after >= eventsPerThread ? after - eventsPerThread + 1 : 0;
+
+    for (uint64 i = jmax(begin, firstIntact); i < end; ++i) {
+      const auto &event = events[static_cast<size_t>(i - begin)];
+      if (event.startTicks < originTicks)
+        continue;
+
+      out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\""
+          << event.category << "\",\"ph\":\"X\",\"ts\":"
+          << toMicroseconds(event.startTicks - originTicks)
+          << ",\"dur\":" << toMicroseconds(event.endTicks - event.startTicks)
+          << ",\"pid\":1,\"tid\":" << tid << "}";
+    }
+  }
+
+  out << "\n]}\n";
+  out.flush();
+  return out.getStatus().wasOk();
+}
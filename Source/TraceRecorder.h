@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+    Fast Pack Creator - MIDI Batch Renderer
+
+    Created: 2024
+    Author:  Federico De Biase / Ayra Soft
+
+    Timeline of where render, preview and I/O time goes. TRACE_SCOPE marks
+    a zone; while recording, each zone becomes one event in a buffer owned
+    by the calling thread, so recording takes no locks and allocates only
+    the first time a thread records. The recording is exported as Chrome
+    trace JSON (chrome://tracing, ui.perfetto.dev).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class TraceRecorder {
+public:
+  //==============================================================================
+  // Turning recording on starts a new timeline
+  static void setEnabled(bool shouldRecord);
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  // Events recorded since recording was last turned on. Each thread keeps
+  // its most recent events only.
+  static bool exportChromeTrace(const File &file);
+
+  //==============================================================================
+  // Both strings must be literals: only the pointers are stored
+  class Scope {
+  public:
+    Scope(const char *categoryName, const char *zoneName) noexcept
+        : category(categoryName), name(zoneName),
+          startTicks(isEnabled() ? Time::getHighResolutionTicks() : 0) {}
+
+    ~Scope() {
+      if (startTicks != 0)
+        record(category, name, startTicks, Time::getHighResolutionTicks());
+    }
+
+  private:
+    const char *category;
+    const char *name;
+    int64 startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE(Scope)
+  };
+
+private:
+  //==============================================================================
+  struct Event;
+  struct ThreadBuffer;
+  struct Registry;
+
+  static std::atomic<bool> enabled;
+  static std::atomic<int64> recordingStartTicks;
+
+  static void record(const char *category, const char *name, int64 startTicks,
+                     int64 endTicks);
+  static ThreadBuffer *getThreadBuffer(const char *category);
+  static Registry &getRegistry();
+};
+
+#define TRACE_SCOPE(category, name)                                            \
+  TraceRecorder::Scope JUCE_JOIN_MACRO(traceScope_, __LINE__)(category, name)